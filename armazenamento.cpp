@@ -0,0 +1,494 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "armazenamento.hpp"
+#include "limites.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+[[noreturn]] void lanca_erro(const char* operacao, const std::string& caminho, int erro) {
+    throw fs::filesystem_error(operacao, caminho, std::error_code(erro, std::generic_category()));
+}
+
+/**
+ * @brief Diferenca entre o relogio de file_time_type e o system_clock.
+ * @details Em C++17 nao ha file_clock::from_sys; a diferenca entre as duas epocas e
+ * um numero inteiro de segundos, entao a medida arredondada e exata.
+ */
+std::chrono::seconds diferenca_de_epoca() {
+    static const std::chrono::seconds diferenca = [] {
+        auto arquivo = fs::file_time_type::clock::now().time_since_epoch();
+        auto sistema = std::chrono::system_clock::now().time_since_epoch();
+        auto nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(arquivo - sistema).count();
+        return std::chrono::seconds(std::llround(static_cast<double>(nanos) / 1e9));
+    }();
+    return diferenca;
+}
+
+fs::file_time_type data_de(const struct timespec& ts) {
+    return data_de_nanos(static_cast<std::int64_t>(ts.tv_sec) * 1000000000 + ts.tv_nsec);
+}
+
+class LeitorPosix : public LeitorArquivo {
+ public:
+    LeitorPosix(int fd, std::string caminho) : fd_(fd), caminho_(std::move(caminho)) {}
+    ~LeitorPosix() override { ::close(fd_); }
+
+    std::size_t le(char* buffer, std::size_t tamanho) override {
+        for (;;) {
+            ssize_t lidos = ::read(fd_, buffer, tamanho);
+            if (lidos >= 0) {
+                limita_leitura(static_cast<std::size_t>(lidos));
+                return static_cast<std::size_t>(lidos);
+            }
+            if (errno != EINTR) {
+                lanca_erro("le", caminho_, errno);
+            }
+        }
+    }
+
+ private:
+    int fd_;
+    std::string caminho_;
+};
+
+class EscritorPosix : public EscritorArquivo {
+ public:
+    EscritorPosix(int fd, std::string caminho) : fd_(fd), caminho_(std::move(caminho)) {}
+    ~EscritorPosix() override {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+
+    void escreve(const char* dados, std::size_t tamanho) override {
+        while (tamanho > 0) {
+            ssize_t escritos = ::write(fd_, dados, tamanho);
+            if (escritos < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                lanca_erro("escreve", caminho_, errno);
+            }
+            limita_escrita(static_cast<std::size_t>(escritos));
+            dados += escritos;
+            tamanho -= static_cast<std::size_t>(escritos);
+        }
+    }
+
+    void fecha() override {
+        int fd = fd_;
+        fd_ = -1;
+        if (::close(fd) != 0) {
+            lanca_erro("fecha", caminho_, errno);
+        }
+    }
+
+ private:
+    int fd_;
+    std::string caminho_;
+};
+
+/**
+ * @brief Forma canonica de um caminho no armazenamento em memoria.
+ * @details Remove "./", barras repetidas e a barra final; ".." nao e interpretado.
+ */
+std::string normaliza(const std::string& caminho) {
+    std::string resultado;
+    resultado.reserve(caminho.size());
+    std::size_t i = 0;
+    while (i < caminho.size()) {
+        std::size_t fim = caminho.find('/', i);
+        if (fim == std::string::npos) {
+            fim = caminho.size();
+        }
+        if (fim > i && !(fim - i == 1 && caminho[i] == '.')) {
+            if (!resultado.empty() || caminho[0] == '/') {
+                resultado += '/';
+            }
+            resultado.append(caminho, i, fim - i);
+        }
+        i = fim + 1;
+    }
+    return resultado;
+}
+
+std::string pai_de(const std::string& normalizado) {
+    std::string::size_type barra = normalizado.rfind('/');
+    return (barra == std::string::npos) ? std::string() : normalizado.substr(0, barra);
+}
+
+}  // namespace
+
+// ==============================================================================
+// INTERFACE
+// ==============================================================================
+
+std::int64_t nanos_desde_epoca(fs::file_time_type data) {
+    auto desde_epoca = data.time_since_epoch() - diferenca_de_epoca();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(desde_epoca).count();
+}
+
+fs::file_time_type data_de_nanos(std::int64_t nanos) {
+    auto desde_epoca = std::chrono::nanoseconds(nanos) + diferenca_de_epoca();
+    return fs::file_time_type(std::chrono::duration_cast<fs::file_time_type::duration>(desde_epoca));
+}
+
+fs::file_time_type Armazenamento::data_modificacao(const std::string& caminho) {
+    EstadoArquivo estado = consulta(caminho);
+    if (!estado.existe) {
+        lanca_erro("data_modificacao", caminho, ENOENT);
+    }
+    return estado.modificacao;
+}
+
+// ==============================================================================
+// DISCO LOCAL (POSIX)
+// ==============================================================================
+
+EstadoArquivo ArmazenamentoPosix::consulta(const std::string& caminho) {
+    // Um unico stat fornece existencia, tipo, tamanho e data
+    limita_metadados();
+    struct stat st;
+    EstadoArquivo estado;
+    if (::stat(caminho.c_str(), &st) != 0) {
+        if (errno == ENOENT || errno == ENOTDIR) {
+            return estado;
+        }
+        lanca_erro("consulta", caminho, errno);
+    }
+    estado.existe = true;
+    estado.diretorio = S_ISDIR(st.st_mode);
+    estado.tamanho = static_cast<std::uintmax_t>(st.st_size);
+    estado.modificacao = data_de(st.st_mtim);
+    estado.dispositivo = static_cast<std::uint64_t>(st.st_dev);
+    estado.inode = static_cast<std::uint64_t>(st.st_ino);
+    estado.vinculos = static_cast<std::uint64_t>(st.st_nlink);
+    return estado;
+}
+
+std::unique_ptr<LeitorArquivo> ArmazenamentoPosix::abre_leitura(const std::string& caminho) {
+    limita_metadados();
+    int fd = ::open(caminho.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        lanca_erro("abre_leitura", caminho, errno);
+    }
+    ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+    return std::make_unique<LeitorPosix>(fd, caminho);
+}
+
+std::unique_ptr<EscritorArquivo> ArmazenamentoPosix::abre_escrita(const std::string& caminho) {
+    limita_metadados();
+    int fd = ::open(caminho.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        lanca_erro("abre_escrita", caminho, errno);
+    }
+    return std::make_unique<EscritorPosix>(fd, caminho);
+}
+
+void ArmazenamentoPosix::cria_diretorios(const std::string& caminho) {
+    limita_metadados();
+    fs::create_directories(caminho);
+}
+
+void ArmazenamentoPosix::renomeia(const std::string& de, const std::string& para) {
+    limita_metadados();
+    fs::rename(de, para);
+}
+
+void ArmazenamentoPosix::define_data(const std::string& caminho, fs::file_time_type data) {
+    limita_metadados();
+    fs::last_write_time(caminho, data);
+}
+
+ArmazenamentoPosix& armazenamento_posix() {
+    static ArmazenamentoPosix instancia;
+    return instancia;
+}
+
+// ==============================================================================
+// ARMAZENAMENTO EM MEMORIA
+// ==============================================================================
+
+struct ArmazenamentoMemoria::No {
+    bool diretorio = false;
+    std::uintmax_t tamanho = 0;
+    std::shared_ptr<const std::string> dados;  // nullptr: arquivo virtual (zeros)
+    fs::file_time_type modificacao{};
+};
+
+/** @brief Le de uma copia imutavel do conteudo; escritas concorrentes nao a afetam. */
+class LeitorMemoria : public LeitorArquivo {
+ public:
+    LeitorMemoria(ArmazenamentoMemoria& dono, std::shared_ptr<const std::string> dados, std::uintmax_t tamanho)
+        : dono_(dono), dados_(std::move(dados)), tamanho_(tamanho) {}
+
+    std::size_t le(char* buffer, std::size_t tamanho) override {
+        std::size_t n = static_cast<std::size_t>(std::min<std::uintmax_t>(tamanho, tamanho_ - posicao_));
+        if (dados_) {
+            std::memcpy(buffer, dados_->data() + posicao_, n);
+        } else {
+            std::memset(buffer, 0, n);
+        }
+        posicao_ += n;
+        dono_.cobra_bytes(n);
+        return n;
+    }
+
+ private:
+    ArmazenamentoMemoria& dono_;
+    std::shared_ptr<const std::string> dados_;
+    std::uintmax_t tamanho_;
+    std::uintmax_t posicao_ = 0;
+};
+
+/** @brief Acumula os dados e publica o arquivo completo no fechamento. */
+class EscritorMemoria : public EscritorArquivo {
+ public:
+    EscritorMemoria(ArmazenamentoMemoria& dono, std::string normalizado, bool descarta)
+        : dono_(dono), normalizado_(std::move(normalizado)), descarta_(descarta) {}
+
+    void escreve(const char* dados, std::size_t tamanho) override {
+        if (!descarta_) {
+            dados_.append(dados, tamanho);
+        }
+        tamanho_ += tamanho;
+        dono_.cobra_bytes(tamanho);
+    }
+
+    void fecha() override {
+        dono_.cobra(dono_.perfil_.latencia);
+        auto no = std::make_shared<ArmazenamentoMemoria::No>();
+        no->tamanho = tamanho_;
+        if (!descarta_) {
+            no->dados = std::make_shared<const std::string>(std::move(dados_));
+        }
+        no->modificacao = fs::file_time_type::clock::now();
+        dono_.publica(normalizado_, std::move(no));
+    }
+
+ private:
+    ArmazenamentoMemoria& dono_;
+    std::string normalizado_;
+    bool descarta_;
+    std::string dados_;
+    std::uintmax_t tamanho_ = 0;
+};
+
+ArmazenamentoMemoria::ArmazenamentoMemoria(const PerfilDispositivo& perfil) : perfil_(perfil) {}
+
+void ArmazenamentoMemoria::cobra(std::chrono::nanoseconds custo) {
+    if (custo.count() <= 0) {
+        return;
+    }
+    tempo_simulado_ns_.fetch_add(custo.count(), std::memory_order_relaxed);
+    if (perfil_.espera_real) {
+        // Fila unica: threads concorrentes esperam uma depois da outra, como no dispositivo
+        std::lock_guard<std::mutex> fila(fila_);
+        std::this_thread::sleep_for(custo);
+    }
+}
+
+void ArmazenamentoMemoria::cobra_bytes(std::size_t bytes) {
+    if (perfil_.bytes_por_segundo > 0) {
+        cobra(std::chrono::nanoseconds(static_cast<std::int64_t>(
+            static_cast<double>(bytes) * 1e9 / static_cast<double>(perfil_.bytes_por_segundo))));
+    }
+}
+
+void ArmazenamentoMemoria::cria_ancestrais(const char* operacao, const std::string& normalizado) {
+    // Chamado com o mutex travado. Primeiro procura o ancestral mais proximo que existe:
+    // se for um arquivo, falha como no POSIX (ENOTDIR) sem ter criado nada
+    std::vector<std::string> ausentes;
+    for (std::string pai = pai_de(normalizado); !pai.empty(); pai = pai_de(pai)) {
+        auto it = nos_.find(pai);
+        if (it != nos_.end()) {
+            if (!it->second->diretorio) {
+                lanca_erro(operacao, pai, ENOTDIR);
+            }
+            break;  // Os ancestrais de um diretorio existente ja existem
+        }
+        ausentes.push_back(pai);
+    }
+    for (const auto& pai : ausentes) {
+        auto no = std::make_shared<No>();
+        no->diretorio = true;
+        no->modificacao = fs::file_time_type::clock::now();
+        nos_[pai] = std::move(no);
+    }
+}
+
+void ArmazenamentoMemoria::publica(const std::string& normalizado, std::shared_ptr<No> no) {
+    std::lock_guard<std::mutex> trava(mutex_);
+    nos_[normalizado] = std::move(no);
+}
+
+EstadoArquivo ArmazenamentoMemoria::consulta(const std::string& caminho) {
+    cobra(perfil_.latencia);
+    const std::string normalizado = normaliza(caminho);
+    EstadoArquivo estado;
+    std::lock_guard<std::mutex> trava(mutex_);
+    auto it = nos_.find(normalizado);
+    if (it != nos_.end()) {
+        estado.existe = true;
+        estado.diretorio = it->second->diretorio;
+        estado.tamanho = it->second->tamanho;
+        estado.modificacao = it->second->modificacao;
+    } else if (normalizado.empty() || normalizado == "/") {
+        estado.existe = true;
+        estado.diretorio = true;
+    }
+    return estado;
+}
+
+std::unique_ptr<LeitorArquivo> ArmazenamentoMemoria::abre_leitura(const std::string& caminho) {
+    cobra(perfil_.latencia);
+    const std::string normalizado = normaliza(caminho);
+    std::lock_guard<std::mutex> trava(mutex_);
+    auto it = nos_.find(normalizado);
+    if (it == nos_.end()) {
+        lanca_erro("abre_leitura", caminho, ENOENT);
+    }
+    if (it->second->diretorio) {
+        lanca_erro("abre_leitura", caminho, EISDIR);
+    }
+    return std::make_unique<LeitorMemoria>(*this, it->second->dados, it->second->tamanho);
+}
+
+std::unique_ptr<EscritorArquivo> ArmazenamentoMemoria::abre_escrita(const std::string& caminho) {
+    cobra(perfil_.latencia);
+    std::string normalizado = normaliza(caminho);
+    std::lock_guard<std::mutex> trava(mutex_);
+    const std::string pai = pai_de(normalizado);
+    auto it_pai = nos_.find(pai);
+    if (!pai.empty() && (it_pai == nos_.end() || !it_pai->second->diretorio)) {
+        lanca_erro("abre_escrita", caminho, ENOENT);
+    }
+    auto it = nos_.find(normalizado);
+    if (it != nos_.end() && it->second->diretorio) {
+        lanca_erro("abre_escrita", caminho, EISDIR);
+    }
+    return std::make_unique<EscritorMemoria>(*this, std::move(normalizado), descarta_.load());
+}
+
+void ArmazenamentoMemoria::cria_diretorios(const std::string& caminho) {
+    cobra(perfil_.latencia);
+    const std::string normalizado = normaliza(caminho);
+    if (normalizado.empty()) {
+        return;
+    }
+    std::lock_guard<std::mutex> trava(mutex_);
+    auto it = nos_.find(normalizado);
+    if (it != nos_.end()) {
+        if (!it->second->diretorio) {
+            lanca_erro("cria_diretorios", caminho, EEXIST);
+        }
+        return;
+    }
+    cria_ancestrais("cria_diretorios", normalizado);
+    auto no = std::make_shared<No>();
+    no->diretorio = true;
+    no->modificacao = fs::file_time_type::clock::now();
+    nos_[normalizado] = std::move(no);
+}
+
+void ArmazenamentoMemoria::renomeia(const std::string& de, const std::string& para) {
+    cobra(perfil_.latencia);
+    const std::string origem = normaliza(de);
+    const std::string destino = normaliza(para);
+    std::lock_guard<std::mutex> trava(mutex_);
+    auto it = nos_.find(origem);
+    if (it == nos_.end()) {
+        lanca_erro("renomeia", de, ENOENT);
+    }
+    cria_ancestrais("renomeia", destino);
+    it = nos_.find(origem);  // cria_ancestrais pode ter reorganizado a tabela
+    std::shared_ptr<No> no = std::move(it->second);
+    nos_.erase(it);
+    if (no->diretorio) {
+        // Diretorios: move tambem todos os descendentes
+        const std::string prefixo = origem + "/";
+        std::vector<std::pair<std::string, std::shared_ptr<No>>> movidos;
+        for (auto d = nos_.begin(); d != nos_.end();) {
+            if (d->first.compare(0, prefixo.size(), prefixo) == 0) {
+                movidos.emplace_back(destino + "/" + d->first.substr(prefixo.size()), std::move(d->second));
+                d = nos_.erase(d);
+            } else {
+                ++d;
+            }
+        }
+        for (auto& [caminho, descendente] : movidos) {
+            nos_[caminho] = std::move(descendente);
+        }
+    }
+    nos_[destino] = std::move(no);
+}
+
+void ArmazenamentoMemoria::define_data(const std::string& caminho, fs::file_time_type data) {
+    cobra(perfil_.latencia);
+    const std::string normalizado = normaliza(caminho);
+    std::lock_guard<std::mutex> trava(mutex_);
+    auto it = nos_.find(normalizado);
+    if (it == nos_.end()) {
+        lanca_erro("define_data", caminho, ENOENT);
+    }
+    it->second->modificacao = data;
+}
+
+void ArmazenamentoMemoria::cria_arquivo(const std::string& caminho, const std::string& conteudo,
+                                        fs::file_time_type data) {
+    auto no = std::make_shared<No>();
+    no->tamanho = conteudo.size();
+    no->dados = std::make_shared<const std::string>(conteudo);
+    no->modificacao = data;
+    const std::string normalizado = normaliza(caminho);
+    std::lock_guard<std::mutex> trava(mutex_);
+    cria_ancestrais("cria_arquivo", normalizado);
+    nos_[normalizado] = std::move(no);
+}
+
+void ArmazenamentoMemoria::cria_arquivo_virtual(const std::string& caminho, std::uintmax_t tamanho,
+                                                fs::file_time_type data) {
+    auto no = std::make_shared<No>();
+    no->tamanho = tamanho;
+    no->modificacao = data;
+    const std::string normalizado = normaliza(caminho);
+    std::lock_guard<std::mutex> trava(mutex_);
+    cria_ancestrais("cria_arquivo_virtual", normalizado);
+    nos_[normalizado] = std::move(no);
+}
+
+void ArmazenamentoMemoria::descarta_conteudo(bool descarta) {
+    descarta_.store(descarta);
+}
+
+std::string ArmazenamentoMemoria::conteudo(const std::string& caminho) const {
+    std::lock_guard<std::mutex> trava(mutex_);
+    auto it = nos_.find(normaliza(caminho));
+    return (it != nos_.end() && it->second->dados) ? *it->second->dados : std::string();
+}
+
+std::size_t ArmazenamentoMemoria::total_arquivos() const {
+    std::lock_guard<std::mutex> trava(mutex_);
+    std::size_t total = 0;
+    for (const auto& [caminho, no] : nos_) {
+        total += no->diretorio ? 0 : 1;
+    }
+    return total;
+}
+
+std::chrono::nanoseconds ArmazenamentoMemoria::tempo_simulado() const {
+    return std::chrono::nanoseconds(tempo_simulado_ns_.load(std::memory_order_relaxed));
+}
@@ -0,0 +1,171 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef ARMAZENAMENTO_HPP
+#define ARMAZENAMENTO_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/** @brief Nanossegundos desde 1970-01-01 UTC (formato usado fora do processo). */
+std::int64_t nanos_desde_epoca(std::filesystem::file_time_type data);
+std::filesystem::file_time_type data_de_nanos(std::int64_t nanos);
+
+/**
+ * @brief Resultado de uma consulta de metadados (stat).
+ */
+struct EstadoArquivo {
+    bool existe = false;
+    bool diretorio = false;
+    std::uintmax_t tamanho = 0;
+    std::filesystem::file_time_type modificacao{};
+    std::uint64_t dispositivo = 0;  ///< st_dev (0 em armazenamentos sem inodes).
+    std::uint64_t inode = 0;        ///< st_ino (0 em armazenamentos sem inodes).
+    std::uint64_t vinculos = 1;     ///< st_nlink: nomes do mesmo arquivo (hardlinks).
+};
+
+/** @brief Leitura sequencial de um arquivo aberto por um Armazenamento. */
+class LeitorArquivo {
+ public:
+    virtual ~LeitorArquivo() = default;
+    /** @return Bytes lidos (0 no fim do arquivo). */
+    virtual std::size_t le(char* buffer, std::size_t tamanho) = 0;
+};
+
+/** @brief Escrita sequencial de um arquivo criado (ou truncado) por um Armazenamento. */
+class EscritorArquivo {
+ public:
+    virtual ~EscritorArquivo() = default;
+    virtual void escreve(const char* dados, std::size_t tamanho) = 0;
+    /** @brief Conclui a escrita; erros adiados pelo dispositivo aparecem aqui. */
+    virtual void fecha() = 0;
+    /**
+     * @brief Informa, antes de fecha(), a data de modificacao que o arquivo deve ter.
+     * @return false se o armazenamento so aceita a data depois (Armazenamento::define_data).
+     */
+    virtual bool define_data(std::filesystem::file_time_type data) {
+        (void)data;
+        return false;
+    }
+};
+
+/**
+ * @brief Interface de armazenamento usada pela tabela de decisao e pelo motor de copia.
+ * @details Espelha as operacoes de std::filesystem de que o backup precisa (stat,
+ * open, read, write, mkdir, rename, set_times). Como em std::filesystem, as falhas
+ * sao lancadas como std::filesystem::filesystem_error; consultar um caminho
+ * inexistente nao e falha (EstadoArquivo::existe == false).
+ */
+class Armazenamento {
+ public:
+    virtual ~Armazenamento() = default;
+
+    virtual EstadoArquivo consulta(const std::string& caminho) = 0;
+    virtual std::unique_ptr<LeitorArquivo> abre_leitura(const std::string& caminho) = 0;
+    virtual std::unique_ptr<EscritorArquivo> abre_escrita(const std::string& caminho) = 0;
+    /** @brief Cria o diretorio e os ancestrais que faltarem. */
+    virtual void cria_diretorios(const std::string& caminho) = 0;
+    virtual void renomeia(const std::string& de, const std::string& para) = 0;
+    virtual void define_data(const std::string& caminho, std::filesystem::file_time_type data) = 0;
+
+    /**
+     * @brief Aviso de que os caminhos serao consultados em seguida.
+     * @details Armazenamentos remotos respondem ao lote inteiro em uma ida e volta; as
+     * falhas sao ignoradas aqui e reaparecem na consulta individual.
+     */
+    virtual void antecipa_consultas(const std::vector<std::string>& caminhos) { (void)caminhos; }
+
+    bool existe(const std::string& caminho) { return consulta(caminho).existe; }
+    /** @throw std::filesystem::filesystem_error se o arquivo nao existe. */
+    std::filesystem::file_time_type data_modificacao(const std::string& caminho);
+};
+
+/**
+ * @brief Disco local (std::filesystem e chamadas POSIX).
+ * @details O motor de copia reconhece esta implementacao e usa o caminho rapido de
+ * copia_arquivo (fadvise, futimens, permissoes da origem).
+ */
+class ArmazenamentoPosix : public Armazenamento {
+ public:
+    EstadoArquivo consulta(const std::string& caminho) override;
+    std::unique_ptr<LeitorArquivo> abre_leitura(const std::string& caminho) override;
+    std::unique_ptr<EscritorArquivo> abre_escrita(const std::string& caminho) override;
+    void cria_diretorios(const std::string& caminho) override;
+    void renomeia(const std::string& de, const std::string& para) override;
+    void define_data(const std::string& caminho, std::filesystem::file_time_type data) override;
+};
+
+/** @brief Instancia unica do disco local, usada pelas funcoes sem Armazenamento explicito. */
+ArmazenamentoPosix& armazenamento_posix();
+
+/**
+ * @brief Custo simulado de um dispositivo (ex: pen-drive USB lento).
+ */
+struct PerfilDispositivo {
+    std::chrono::nanoseconds latencia{0};  ///< Por operacao de metadados, abertura ou fechamento.
+    std::uint64_t bytes_por_segundo = 0;   ///< Banda de leitura/escrita (0 = ilimitada).
+    bool espera_real = false;              ///< Alem de contabilizar, dorme pelo tempo simulado.
+};
+
+/**
+ * @brief Sistema de arquivos em memoria com injecao de latencia e banda.
+ * @details Cada operacao soma o seu custo (PerfilDispositivo) a um relogio simulado,
+ * como em um dispositivo de fila unica: o tempo simulado e deterministico e nao
+ * depende da maquina. Com espera_real as threads tambem dormem em fila, uma por vez.
+ * Arquivos "virtuais" tem apenas tamanho (leem zeros) e, com descarta_conteudo, as
+ * escritas guardam so o tamanho; assim milhoes de arquivos cabem na memoria. Seguro
+ * para varias threads.
+ */
+class ArmazenamentoMemoria : public Armazenamento {
+ public:
+    explicit ArmazenamentoMemoria(const PerfilDispositivo& perfil = PerfilDispositivo());
+
+    EstadoArquivo consulta(const std::string& caminho) override;
+    std::unique_ptr<LeitorArquivo> abre_leitura(const std::string& caminho) override;
+    std::unique_ptr<EscritorArquivo> abre_escrita(const std::string& caminho) override;
+    void cria_diretorios(const std::string& caminho) override;
+    void renomeia(const std::string& de, const std::string& para) override;
+    void define_data(const std::string& caminho, std::filesystem::file_time_type data) override;
+
+    /** @brief Cria (ou substitui) um arquivo sem custo simulado; os ancestrais sao criados. */
+    void cria_arquivo(const std::string& caminho, const std::string& conteudo,
+                      std::filesystem::file_time_type data);
+    /** @brief Cria um arquivo de 'tamanho' zeros sem guardar o conteudo. */
+    void cria_arquivo_virtual(const std::string& caminho, std::uintmax_t tamanho,
+                              std::filesystem::file_time_type data);
+    /** @brief Faz as escritas seguintes guardarem apenas o tamanho. */
+    void descarta_conteudo(bool descarta);
+
+    /** @return Conteudo do arquivo ("" se nao existe ou se e virtual). */
+    std::string conteudo(const std::string& caminho) const;
+    std::size_t total_arquivos() const;
+    /** @brief Tempo que o dispositivo simulado passou ocupado. */
+    std::chrono::nanoseconds tempo_simulado() const;
+
+    struct No;
+
+ private:
+    friend class EscritorMemoria;
+    friend class LeitorMemoria;
+
+    void cobra(std::chrono::nanoseconds custo);
+    void cobra_bytes(std::size_t bytes);
+    void cria_ancestrais(const char* operacao, const std::string& normalizado);
+    void publica(const std::string& normalizado, std::shared_ptr<No> no);
+
+    PerfilDispositivo perfil_;
+    std::atomic<bool> descarta_{false};
+    std::atomic<std::int64_t> tempo_simulado_ns_{0};
+    mutable std::mutex mutex_;
+    std::mutex fila_;  ///< Serializa as esperas reais (espera_real).
+    std::unordered_map<std::string, std::shared_ptr<No>> nos_;
+};
+
+#endif  // ARMAZENAMENTO_HPP
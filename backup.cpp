@@ -1,6 +1,11 @@
 // Copyright 2025 Guilherme Nonato
 
 #include "backup.hpp"
+#include "diario.hpp"
+#include "estatisticas.hpp"
+#include "verificacao.hpp"
+#include "vinculos.hpp"
+#include <algorithm>
 #include <fstream>
 #include <iostream>
 #include <cassert>
@@ -9,6 +14,10 @@
 
 namespace fs = std::filesystem;
 
+// Arquivos por lote de consultas antecipadas (Armazenamento::antecipa_consultas):
+// uma ida e volta de um armazenamento remoto e dividida entre todos eles
+static const std::size_t LOTE_CONSULTAS = 256;
+
 auto get_file_time(const std::string& path) {
     return fs::last_write_time(path);
 }
@@ -30,6 +39,7 @@ ResultadoBackup le_arquivo_parametros(const std::string& nome_arquivo_parm,
                                       std::vector<std::string>& arquivos_para_processar) {
     // Assertiva de entrada
     assert(!nome_arquivo_parm.empty() && "O nome do arquivo de parametros nao pode ser vazio.");
+    MEDE_FASE(FASE_PARAMETROS);
 
     // Implementacao para o Caso de Decisao 1 (ERRO: Backup.parm ausente)
     if (!fs::exists(nome_arquivo_parm)) {
@@ -62,42 +72,128 @@ ResultadoBackup le_arquivo_parametros(const std::string& nome_arquivo_parm,
     return ERRO_GERAL;
 }
 
-ResultadoBackup faz_backup_arquivo(const std::string& origem, const std::string& destino, Operacao operacao) {
+/**
+ * @brief Copia da tabela de decisao; recria como hardlink outro nome de um inode ja copiado.
+ * @details Dentro de uma SessaoVinculos, a primeira ocorrencia de uma origem com varios
+ * nomes (st_nlink > 1) e copiada e as seguintes viram hardlinks para essa copia, herdando
+ * checksum e tamanho. Se a primeira copia falhou, o destino nao e o disco local ou o
+ * sistema de arquivos nao tem hardlinks, copia normalmente.
+ */
+static void copia_ou_vincula(Armazenamento& arm_origem, const std::string& origem, const EstadoArquivo& estado_origem,
+                             Armazenamento& arm_destino, const std::string& destino, InfoCopia& info) {
+    MapaInodes* mapa = mapa_inodes_ativo();
+    if (mapa == nullptr || estado_origem.vinculos < 2 || estado_origem.inode == 0 ||
+        &arm_destino != &armazenamento_posix()) {
+        copia_entre(arm_origem, origem, arm_destino, destino, info);
+        return;
+    }
+
+    const IdentidadeInode id{estado_origem.dispositivo, estado_origem.inode};
+    std::shared_future<PrimeiraOcorrencia> anterior;
+    if (mapa->reserva(id, anterior)) {
+        PrimeiraOcorrencia primeira;
+        try {
+            copia_entre(arm_origem, origem, arm_destino, destino, info);
+        } catch (...) {
+            mapa->publica(id, primeira);  // As demais ocorrencias copiam por conta propria
+            throw;
+        }
+        primeira.valida = true;
+        primeira.caminho = destino;
+        primeira.info = info;
+        mapa->publica(id, std::move(primeira));
+        return;
+    }
+
+    const PrimeiraOcorrencia& primeira = anterior.get();
+    if (primeira.valida) {
+        MEDE_FASE_DE(FASE_HARDLINK, destino.c_str());
+        if (vincula_copia(primeira.caminho, destino)) {
+            info = primeira.info;
+            conta_vinculo_recriado();
+            return;
+        }
+    }
+    copia_entre(arm_origem, origem, arm_destino, destino, info);
+}
+
+ResultadoBackup faz_backup_arquivo(const std::string& origem, const std::string& destino, Operacao operacao,
+                                   InfoCopia* info) {
+    return faz_backup_arquivo(armazenamento_posix(), origem, armazenamento_posix(), destino, operacao, info);
+}
+
+ResultadoBackup copia_arquivo_decidido(const std::string& origem, const std::string& destino, InfoCopia* info) {
+    assert(!origem.empty() && !destino.empty());
+    MEDE_FASE_DE(FASE_ARQUIVO, origem.c_str());
+    InfoCopia info_local;
+    InfoCopia& info_copia = (info != nullptr) ? *info : info_local;
+    Armazenamento& posix = armazenamento_posix();
+    try {
+        EstadoArquivo estado_origem;
+        {
+            MEDE_FASE(FASE_METADADOS);
+            estado_origem = posix.consulta(origem);
+        }
+        copia_ou_vincula(posix, origem, estado_origem, posix, destino, info_copia);
+        return SUCESSO;
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Erro de copia: " << e.what() << std::endl;
+        return ERRO_GERAL;
+    }
+}
+
+ResultadoBackup faz_backup_arquivo(Armazenamento& arm_origem, const std::string& origem,
+                                   Armazenamento& arm_destino, const std::string& destino,
+                                   Operacao operacao, InfoCopia* info) {
     // Assertiva de entrada minima
     assert(!origem.empty() && "A string de origem nao pode ser vazia.");
     assert(!destino.empty() && "A string de destino nao pode ser vazia.");
+    MEDE_FASE_DE(FASE_ARQUIVO, origem.c_str());
 
     // Suprime o warning 'unused parameter'
     (void)operacao;
 
+    // O motor de copia sempre calcula o checksum; so o repassa se o chamador pediu
+    InfoCopia info_local;
+    InfoCopia& info_copia = (info != nullptr) ? *info : info_local;
+
     // ==============================================================================
     // A. LOGICA DE BACKUP (HD -> PD) - OPERACAO: BACKUP (Casos 2, 3, 4, 5)
     // ==============================================================================
     if (operacao == BACKUP) {
-        bool origem_existe = fs::exists(origem);
-        bool destino_existe = fs::exists(destino);
+        EstadoArquivo estado_origem;
+        bool origem_existe, destino_existe;
+        {
+            MEDE_FASE(FASE_METADADOS);
+            estado_origem = arm_origem.consulta(origem);
+            origem_existe = estado_origem.existe;
+            destino_existe = arm_destino.existe(destino);
+        }
 
         // Caso 1 e 6 (Backup): ORIGEM NAO EXISTE.
         if (!origem_existe) {
             // CASO DE DECISÃO 7: HD ausente (F), PD existe (V) -> ACAO: IGNORAR (Faz Nada)
             if (destino_existe) {
+                CONTA_CASO(7);
                 // Assertiva de Saída: Garante que o arquivo no destino nao foi alterado.
-                assert(fs::exists(destino) && "Arquivo de destino deveria existir.");
+                assert(arm_destino.existe(destino) && "Arquivo de destino deveria existir.");
                 return IGNORAR;
             } else { 
             // CASO DE DECISÃO 6: HD ausente (F), PD ausente (F) -> ACAO: IGNORAR (Faz Nada, caso nao listado, mas faz sentido)
+                CONTA_CASO(6);
                 return IGNORAR;
             }
         }
 
         // CASO DE DECISAO 2: HD existe (sim), PD nao existe (nao) -> ACAO: COPIAR
         if (!destino_existe) {
+            CONTA_CASO(2);
             try {
-                // fs::copy ira criar o arquivo e sobrescrever se ja existir (o que nao e o caso aqui)
-                fs::copy(origem, destino, fs::copy_options::overwrite_existing);
+                // copia_entre ira criar o arquivo e sobrescrever se ja existir (o que nao e o caso aqui)
+                copia_ou_vincula(arm_origem, origem, estado_origem, arm_destino, destino, info_copia);
 
                 // Assertiva de saida: Verifica se o arquivo foi criado (requisito do teste)
-                assert(fs::exists(destino) && "O arquivo de destino nao foi criado.");
+                assert(arm_destino.existe(destino) && "O arquivo de destino nao foi criado.");
                 return SUCESSO;
             } catch (const fs::filesystem_error& e) {
                 std::cerr << "Erro de copia: " << e.what() << std::endl;
@@ -108,25 +204,32 @@ ResultadoBackup faz_backup_arquivo(const std::string& origem, const std::string&
         // CASO DE DECISÃO 3: PD existe, PD < HD -> ACAO: COPIAR
         if (destino_existe) {
             try {
-                auto tempo_origem = get_file_time(origem);
-                auto tempo_destino = get_file_time(destino);
+                fs::file_time_type tempo_origem, tempo_destino;
+                {
+                    MEDE_FASE(FASE_METADADOS);
+                    tempo_origem = arm_origem.data_modificacao(origem);
+                    tempo_destino = arm_destino.data_modificacao(destino);
+                }
 
                 // Verifica se o arquivo do Pen-drive (destino) e mais antigo que o HD (origem)
                 if (tempo_destino < tempo_origem) {
+                    CONTA_CASO(3);
                     // Se o PD e mais antigo, copia e sobrescreve (Atualizacao)
-                    fs::copy(origem, destino, fs::copy_options::overwrite_existing);
+                    copia_ou_vincula(arm_origem, origem, estado_origem, arm_destino, destino, info_copia);
 
                     // Assertiva de saida: A data do destino deve ser igual ou superior a origem
-                    assert(get_file_time(destino) >= tempo_origem && "A data de destino nao foi atualizada.");
+                    assert(arm_destino.data_modificacao(destino) >= tempo_origem && "A data de destino nao foi atualizada.");
 
                     return SUCESSO;
                 } else if (tempo_destino == tempo_origem) { 
                 // CASO DE DECISÃO 4: PD == HD -> ACAO: IGNORAR (Datas Iguais)
+                    CONTA_CASO(4);
                     return IGNORAR;
                 }
 
                 // CASO DE DECISÃO 5: PD > HD -> ACAO: ERRO
                 else { // tempo_destino > tempo_origem
+                    CONTA_CASO(5);
                     return ERRO_ARQUIVO_DESTINO_MAIS_NOVO;
                 }
 
@@ -154,8 +257,14 @@ ResultadoBackup faz_backup_arquivo(const std::string& origem, const std::string&
     // ==============================================================================
     if (operacao == RESTAURACAO) {
 
-        bool origem_existe = fs::exists(origem); // PD
-        bool destino_existe = fs::exists(destino); // HD
+        EstadoArquivo estado_origem;
+        bool origem_existe, destino_existe;
+        {
+            MEDE_FASE(FASE_METADADOS);
+            estado_origem = arm_origem.consulta(origem); // PD
+            origem_existe = estado_origem.existe;
+            destino_existe = arm_destino.existe(destino); // HD
+        }
 
         (void)origem_existe;
 
@@ -164,15 +273,17 @@ ResultadoBackup faz_backup_arquivo(const std::string& origem, const std::string&
             // CASO 13: PD e HD ausentes OU CASO 12: PD ausente, HD presente
             // Em ambos, a ORIGEM nao existe, o que e um erro critico para a Restauracao.
             // A Tabela exige ERRO para o Caso 12 e o Caso 13
-            assert((!destino_existe || get_file_time(destino) == get_file_time(destino)) && "Integridade do destino perdida.");
+            CONTA_CASO(destino_existe ? 12 : 13);
+            assert((!destino_existe || arm_destino.data_modificacao(destino) == arm_destino.data_modificacao(destino)) && "Integridade do destino perdida.");
             return ERRO_ARQUIVO_ORIGEM_NAO_EXISTE;
         }
 
         // CASO DE DECISÃO 11: PD existe, HD NAO existe -> ACAO: COPIAR (Restauração Simples)
         if (!destino_existe) {
+            CONTA_CASO(11);
             try {
-                fs::copy(origem, destino, fs::copy_options::overwrite_existing);
-                assert(fs::exists(destino) && "Arquivo de destino (HD) nao foi criado na restauracao simples.");
+                copia_ou_vincula(arm_origem, origem, estado_origem, arm_destino, destino, info_copia);
+                assert(arm_destino.existe(destino) && "Arquivo de destino (HD) nao foi criado na restauracao simples.");
                 return SUCESSO;
             } catch (const fs::filesystem_error& e) {
                 std::cerr << "Erro de copia (Caso 11): " << e.what() << std::endl;
@@ -183,30 +294,37 @@ ResultadoBackup faz_backup_arquivo(const std::string& origem, const std::string&
         // Logica para Restauraçao (PD -> HD):
         if (destino_existe) {
             try {
-                auto tempo_origem = get_file_time(origem); // PD
-                auto tempo_destino = get_file_time(destino); // HD
+                fs::file_time_type tempo_origem, tempo_destino;
+                {
+                    MEDE_FASE(FASE_METADADOS);
+                    tempo_origem = arm_origem.data_modificacao(origem); // PD
+                    tempo_destino = arm_destino.data_modificacao(destino); // HD
+                }
 
                 // CASO DE DECISÃO 8: PD < HD -> ACAO: ERRO (PD mais antigo que HD)
                 if (tempo_origem < tempo_destino) {
+                    CONTA_CASO(8);
                     // O arquivo de origem (PD) é mais antigo, o destino (HD) é mais novo.
-                    assert(fs::exists(destino) && "HD nao deve ter sido removido.");
-                    assert(get_file_time(destino) == tempo_destino && "Data do HD nao deve ser alterada.");
+                    assert(arm_destino.existe(destino) && "HD nao deve ter sido removido.");
+                    assert(arm_destino.data_modificacao(destino) == tempo_destino && "Data do HD nao deve ser alterada.");
 
                     return ERRO_ARQUIVO_ORIGEM_MAIS_ANTIGO;
                 }
 
                 // CASO DE DECISÃO 9: HD existe, PD existe, PD > HD -> ACAO: COPIAR (Restauracao)
                 else if (tempo_origem > tempo_destino) {
-                    fs::copy(origem, destino, fs::copy_options::overwrite_existing);
+                    CONTA_CASO(9);
+                    copia_ou_vincula(arm_origem, origem, estado_origem, arm_destino, destino, info_copia);
 
                     // Assertiva de saida
-                    assert(get_file_time(destino) >= tempo_origem && "A data do HD nao foi atualizada na restauracao.");
+                    assert(arm_destino.data_modificacao(destino) >= tempo_origem && "A data do HD nao foi atualizada na restauracao.");
 
                     return SUCESSO;
                 }
 
                 // CASO DE DECISÃO 10: PD == HD -> ACAO: IGNORAR
                 else if (tempo_origem == tempo_destino) {
+                    CONTA_CASO(10);
                     return IGNORAR;
                 }
 
@@ -230,12 +348,24 @@ ResultadoBackup executa_backup_restauracao(const std::string& nome_arquivo_parm,
                                             const std::string& caminho_origem_base,
                                             const std::string& caminho_destino_base,
                                             Operacao operacao) {
+    return executa_backup_restauracao(nome_arquivo_parm, caminho_origem_base, caminho_destino_base, operacao,
+                                      armazenamento_posix(), armazenamento_posix());
+}
+
+ResultadoBackup executa_backup_restauracao(const std::string& nome_arquivo_parm,
+                                            const std::string& caminho_origem_base,
+                                            const std::string& caminho_destino_base,
+                                            Operacao operacao,
+                                            Armazenamento& arm_origem,
+                                            Armazenamento& arm_destino,
+                                            bool retomar) {
     // Assertiva de entrada
     assert(!nome_arquivo_parm.empty());
     assert(!caminho_origem_base.empty());
     assert(!caminho_destino_base.empty());
 
     std::vector<std::string> arquivos_a_processar;
+    SessaoVinculos vinculos;  // Nomes do mesmo inode viram hardlinks no destino
 
     // 1. LEITURA DO ARQUIVO DE PARAMETROS (Trata o Caso 1 - IMPOSSIVEL)
     ResultadoBackup leitura_resultado = le_arquivo_parametros(nome_arquivo_parm, arquivos_a_processar);
@@ -244,38 +374,113 @@ ResultadoBackup executa_backup_restauracao(const std::string& nome_arquivo_parm,
         return leitura_resultado; // Retorna ERRO_ARQUIVO_PARAMETROS_AUSENTE (Caso 1)
     }
 
+    // No backup, o manifesto de checksums do destino e atualizado a cada copia
+    const std::string caminho_manifesto = caminho_destino_base + "/" + NOME_MANIFESTO;
+    Manifesto manifesto;
+    bool manifesto_alterado = false;
+    if (operacao == BACKUP) {
+        MEDE_FASE(FASE_MANIFESTO);
+        le_manifesto(arm_destino, caminho_manifesto, manifesto);  // Ausente no primeiro backup
+    }
+
+    // Diario de progresso: na retomada, as entradas ja concluidas sao puladas e as copias
+    // registradas voltam ao manifesto (a execucao anterior pode ter morrido antes de grava-lo)
+    DiarioExecucao diario(caminho_diario(nome_arquivo_parm, caminho_origem_base, caminho_destino_base, operacao),
+                          identifica_trabalho(nome_arquivo_parm, caminho_origem_base, caminho_destino_base, operacao),
+                          arquivos_a_processar.size(), retomar);
+    if (diario.concluidos_anteriores() > 0) {
+        std::cout << "Retomada: " << diario.concluidos_anteriores() << " de " << arquivos_a_processar.size()
+                  << " entradas ja concluidas" << std::endl;
+        if (operacao == BACKUP) {
+            for (const EntradaDiario& copia : diario.copias_anteriores()) {
+                manifesto[arquivos_a_processar[copia.indice]] = EntradaManifesto{copia.checksum, copia.bytes};
+                manifesto_alterado = true;
+            }
+        }
+    }
+
+    ResultadoBackup resultado_final = SUCESSO;
+
     // 2. ORQUESTRAÇÃO E EXECUÇÃO
-    for (const auto& arquivo : arquivos_a_processar) {
-        // Constrói os caminhos absolutos
-        std::string origem_path = caminho_origem_base + "/" + arquivo;
-        std::string destino_path = caminho_destino_base + "/" + arquivo;
+    std::vector<std::string> origens, destinos;
+    std::size_t inicio_lote = 0;
+    std::size_t fim_lote = 0;
+    for (std::size_t i = 0; i < arquivos_a_processar.size(); ++i) {
+        if (diario.concluido(i)) {
+            continue;  // Retomada: concluida na execucao anterior
+        }
+        const std::string& arquivo = arquivos_a_processar[i];
+        if (i >= fim_lote) {
+            // Constrói os caminhos absolutos do proximo lote; armazenamentos remotos
+            // respondem as consultas do lote inteiro de uma vez
+            origens.clear();
+            destinos.clear();
+            inicio_lote = i;
+            fim_lote = std::min(i + LOTE_CONSULTAS, arquivos_a_processar.size());
+            for (std::size_t j = i; j < fim_lote; ++j) {
+                origens.push_back(caminho_origem_base + "/" + arquivos_a_processar[j]);
+                destinos.push_back(caminho_destino_base + "/" + arquivos_a_processar[j]);
+            }
+            MEDE_FASE(FASE_METADADOS);
+            arm_origem.antecipa_consultas(origens);
+            arm_destino.antecipa_consultas(destinos);
+        }
+        const std::string& origem_path = origens[i - inicio_lote];
+        const std::string& destino_path = destinos[i - inicio_lote];
 
         // --- CORREÇÃO: CRIAÇÃO DE SUBPASTAS RECURSIVAS ---
         try {
+            MEDE_FASE(FASE_DIRETORIOS);
             // Extrai o caminho do diretório de destino (ex: test_case_destino/documentos)
-            fs::path destino_dir = fs::path(destino_path).parent_path();
+            const std::string destino_dir = fs::path(destino_path).parent_path().string();
             // Cria os diretórios recursivamente no destino, se não existirem
-            if (!fs::exists(destino_dir)) {
-                fs::create_directories(destino_dir);
+            if (!arm_destino.existe(destino_dir)) {
+                arm_destino.cria_diretorios(destino_dir);
             }
         } catch (const fs::filesystem_error& e) {
             std::cerr << "Erro ao criar diretorios: " << e.what() << std::endl;
-            return ERRO_GERAL; // Retorna um erro critico se nao conseguir criar o diretorio
+            resultado_final = ERRO_GERAL; // Erro critico se nao conseguir criar o diretorio
+            break;
         }
 
         // Chama a funcao de decisao e copia para cada arquivo
-        ResultadoBackup item_resultado = faz_backup_arquivo(origem_path, destino_path, operacao);
+        InfoCopia info;
+        ResultadoBackup item_resultado = faz_backup_arquivo(arm_origem, origem_path, arm_destino, destino_path,
+                                                          operacao, &info);
+        diario.registra(i, item_resultado, info);
+
+        if (item_resultado == SUCESSO && operacao == BACKUP) {
+            manifesto[arquivo] = EntradaManifesto{info.checksum, info.bytes};
+            manifesto_alterado = true;
+        }
 
         // Se um erro critico (diferente de IGNORAR ou SUCESSO) ocorrer, o sistema deve parar.
         if (item_resultado != SUCESSO && item_resultado != IGNORAR) {
-            return item_resultado;
+            resultado_final = item_resultado;
+            break;
         }
     }
 
+    // As copias precisam ser duraveis antes de o manifesto (e o fim do diario) registra-las
+    if (!confirma_copias() && resultado_final == SUCESSO) {
+        resultado_final = ERRO_GERAL;
+    }
+
+    // Mesmo em caso de erro, registra os checksums do que ja foi copiado
+    if (manifesto_alterado) {
+        MEDE_FASE(FASE_MANIFESTO);
+        ResultadoBackup gravacao = grava_manifesto(arm_destino, caminho_manifesto, manifesto);
+        if (resultado_final == SUCESSO) {
+            resultado_final = gravacao;
+        }
+    }
+
+    diario.encerra(resultado_final == SUCESSO);
+
     // 3. Assertiva de Saida
     assert(leitura_resultado == SUCESSO);
     
-    return SUCESSO;
+    return resultado_final;
 }
 
 std::string resultado_para_string(ResultadoBackup codigo) {
@@ -286,7 +491,9 @@ std::string resultado_para_string(ResultadoBackup codigo) {
         {ERRO_ARQUIVO_ORIGEM_NAO_EXISTE, "ERRO_ARQUIVO_ORIGEM_NAO_EXISTE"},
         {ERRO_ARQUIVO_DESTINO_MAIS_NOVO, "ERRO_ARQUIVO_DESTINO_MAIS_NOVO"},
         {ERRO_ARQUIVO_ORIGEM_MAIS_ANTIGO, "ERRO_ARQUIVO_ORIGEM_MAIS_ANTIGO"},
-        {ERRO_ARQUIVO_PARAMETROS_AUSENTE, "ERRO_ARQUIVO_PARAMETROS_AUSENTE"}
+        {ERRO_ARQUIVO_PARAMETROS_AUSENTE, "ERRO_ARQUIVO_PARAMETROS_AUSENTE"},
+        {ERRO_CHECKSUM_DIVERGENTE, "ERRO_CHECKSUM_DIVERGENTE"},
+        {ERRO_MANIFESTO_AUSENTE, "ERRO_MANIFESTO_AUSENTE"}
     };
     
     auto it = resultados.find(codigo);
@@ -8,6 +8,8 @@
 #include <cassert>
 #include <fstream>
 #include <vector>
+#include "armazenamento.hpp"
+#include "copia.hpp"
 
 enum ResultadoBackup {
     SUCESSO = 0,
@@ -16,7 +18,9 @@ enum ResultadoBackup {
     ERRO_ARQUIVO_ORIGEM_NAO_EXISTE = -2,
     ERRO_ARQUIVO_DESTINO_MAIS_NOVO = -3,
     ERRO_ARQUIVO_ORIGEM_MAIS_ANTIGO = -4,
-    ERRO_ARQUIVO_PARAMETROS_AUSENTE = -5
+    ERRO_ARQUIVO_PARAMETROS_AUSENTE = -5,
+    ERRO_CHECKSUM_DIVERGENTE = -6,
+    ERRO_MANIFESTO_AUSENTE = -7
 };
 
 enum Operacao {
@@ -30,7 +34,33 @@ enum Operacao {
 
 // Funções de arquivo (deve ser mantida)
 auto get_file_time(const std::string& path); 
-ResultadoBackup faz_backup_arquivo(const std::string& origem, const std::string& destino, Operacao operacao);
+
+/**
+ * @brief Aplica a tabela de decisao a um unico arquivo e copia quando necessario.
+ * @param info Opcional: recebe checksum e tamanho quando o retorno e SUCESSO (houve copia).
+ */
+ResultadoBackup faz_backup_arquivo(const std::string& origem, const std::string& destino, Operacao operacao,
+                                   InfoCopia* info = nullptr);
+
+/**
+ * @brief Tabela de decisao sobre armazenamentos arbitrarios.
+ * @param arm_origem Armazenamento onde esta 'origem' (o HD no BACKUP, o PD na RESTAURACAO).
+ * @param arm_destino Armazenamento onde esta 'destino'.
+ */
+ResultadoBackup faz_backup_arquivo(Armazenamento& arm_origem, const std::string& origem,
+                                   Armazenamento& arm_destino, const std::string& destino,
+                                   Operacao operacao, InfoCopia* info = nullptr);
+
+/**
+ * @brief Copia 'origem' para 'destino' sem aplicar a tabela de decisao.
+ * @details Para quem ja decidiu e contou o caso (CONTA_CASO), como o modo snapshot, que
+ * compara com o snapshot anterior e grava sempre em um caminho novo: por
+ * faz_backup_arquivo toda copia contaria como Caso 2. Mantem a medicao de FASE_ARQUIVO e
+ * os hardlinks da SessaoVinculos.
+ * @return SUCESSO ou ERRO_GERAL (erro de copia, ja informado em std::cerr).
+ */
+ResultadoBackup copia_arquivo_decidido(const std::string& origem, const std::string& destino,
+                                       InfoCopia* info = nullptr);
 ResultadoBackup le_arquivo_parametros(const std::string& nome_arquivo_parm,
                                      std::vector<std::string>& arquivos_para_processar);
 
@@ -38,6 +68,8 @@ ResultadoBackup le_arquivo_parametros(const std::string& nome_arquivo_parm,
 /**
  * @brief Orquestra o processo de backup/restauracao lendo o arquivo de parametros e
  * chamando faz_backup_arquivo para cada arquivo listado.
+ * @details No BACKUP, o checksum de cada arquivo copiado e registrado no manifesto
+ * (Backup.manifest) na raiz do destino.
  * @param nome_arquivo_parm Nome e caminho do arquivo de parametros (ex: "Backup.parm").
  * @param caminho_origem_base Caminho base de onde os arquivos listados serao copiados.
  * @param caminho_destino_base Caminho base para onde os arquivos serao copiados.
@@ -51,10 +83,23 @@ ResultadoBackup executa_backup_restauracao(const std::string& nome_arquivo_parm,
                                             const std::string& caminho_destino_base,
                                             Operacao operacao);
 
-ResultadoBackup faz_backup_arquivo(const std::string& origem, const std::string& destino, Operacao operacao);
-
-ResultadoBackup le_arquivo_parametros(const std::string& nome_arquivo_parm,
-                                     std::vector<std::string>& arquivos_para_processar);
+/**
+ * @brief Mesmo fluxo de executa_backup_restauracao sobre armazenamentos arbitrarios.
+ * @details O Backup.parm e sempre lido do disco local; o manifesto fica no
+ * armazenamento de destino. O resultado de cada entrada vai para o diario de progresso
+ * "<Backup.parm>.<hash>.progresso" (DiarioExecucao, ver caminho_diario), removido ao final
+ * de uma execucao bem sucedida.
+ * @param retomar Pula as entradas que uma execucao anterior interrompida (erro ou
+ * processo morto) do mesmo trabalho ja concluiu, sem repetir as consultas de metadados;
+ * as copias registradas no diario voltam ao manifesto.
+ */
+ResultadoBackup executa_backup_restauracao(const std::string& nome_arquivo_parm,
+                                            const std::string& caminho_origem_base,
+                                            const std::string& caminho_destino_base,
+                                            Operacao operacao,
+                                            Armazenamento& arm_origem,
+                                            Armazenamento& arm_destino,
+                                            bool retomar = false);
 
 std::string resultado_para_string(ResultadoBackup codigo);
 
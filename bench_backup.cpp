@@ -0,0 +1,600 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "backup.hpp"
+#include "gerador.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// ==============================================================================
+// BENCHMARK DE PONTA A PONTA (make bench / make perfcheck)
+// ==============================================================================
+
+namespace {
+
+const char* const OPERACOES[] = {"backup", "incremental", "restauracao"};
+constexpr int TOTAL_OPERACOES = 3;
+
+// Tolerancias gravadas por --grava-linha-base (editaveis no JSON)
+constexpr double TOLERANCIA_ARQUIVOS_POR_S = 0.25;
+constexpr double TOLERANCIA_MB_POR_S = 0.30;
+
+// Medicoes mais curtas que isso sao dominadas pelo ruido e ficam fora da linha de base
+constexpr double DURACAO_MINIMA_BASE = 0.01;
+
+// Codigo de saida quando alguma metrica ficou abaixo da linha de base
+constexpr int SAIDA_REGRESSAO = 2;
+
+/** @brief Amostras de uma operacao em um perfil. */
+struct ResultadoBench {
+    std::string perfil;
+    std::string operacao;  // "backup", "incremental" (nada mudou) ou "restauracao"
+    std::uint64_t arquivos = 0;
+    std::uint64_t bytes = 0;  // Bytes que a operacao precisa mover (0 no incremental)
+    std::vector<double> segundos;
+
+    double mediana() const {
+        std::vector<double> ordenado(segundos);
+        std::sort(ordenado.begin(), ordenado.end());
+        std::size_t n = ordenado.size();
+        return n == 0 ? 0.0 : (n % 2 ? ordenado[n / 2] : (ordenado[n / 2 - 1] + ordenado[n / 2]) / 2);
+    }
+    /** @brief Desvio absoluto mediano relativo a mediana (dispersao robusta a outliers). */
+    double dispersao() const {
+        double m = mediana();
+        if (m <= 0) {
+            return 0.0;
+        }
+        ResultadoBench desvios{perfil, operacao, arquivos, bytes, {}};
+        for (double s : segundos) {
+            desvios.segundos.push_back(std::fabs(s - m));
+        }
+        return desvios.mediana() / m;
+    }
+    double arquivos_por_s() const {
+        double m = mediana();
+        return m > 0 ? static_cast<double>(arquivos) / m : 0.0;
+    }
+    double mb_por_s() const {
+        double m = mediana();
+        return m > 0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / m : 0.0;
+    }
+    double metrica(const std::string& nome) const {
+        return nome == "mb_por_s" ? mb_por_s() : arquivos_por_s();
+    }
+};
+
+/** @brief Uma metrica da linha de base: o valor minimo aceitavel e valor * (1 - tolerancia). */
+struct MetricaBase {
+    std::string perfil;
+    std::string operacao;
+    std::string metrica;
+    double valor = 0.0;
+    double tolerancia = 0.0;
+};
+
+struct Configuracao {
+    std::vector<PerfilArvore> perfis;
+    double escala = 1.0;
+    unsigned repeticoes = 1;
+    std::string pasta = "/tmp/sysbackup_bench";
+    std::string arquivo_saida = "bench.json";
+    std::string rotulo;
+    std::string linha_base;
+    std::string grava_linha_base;
+    std::vector<ModoDurabilidade> modos;  // --durabilidade: um conjunto de medidas por modo
+    std::vector<ModoPipeline> pipelines;  // --pipeline: idem, por modo de pipeline
+    bool residencia = false;              // --residencia: cache de paginas apos o backup
+};
+
+void imprime_uso(const char* programa) {
+    std::cerr << "Uso: " << programa << " [--perfis p1,p2,...] [--escala F] [--repeticoes N] [--dir PASTA]"
+              << " [--saida ARQUIVO.json] [--rotulo TEXTO]" << std::endl;
+    std::cerr << "     [--durabilidade m1,m2,...]      compara modos (nenhuma, arquivo, lote); o perfil"
+              << " vira perfil:modo" << std::endl;
+    std::cerr << "     [--pipeline m1,m2,...]          idem para a copia em pipeline (nunca, auto, sempre)" << std::endl;
+    std::cerr << "     [--residencia]                  mede o cache de paginas apos o backup, com e sem"
+              << " --sem-cache" << std::endl;
+    std::cerr << "     [--linha-base BASE.json]        compara e sai com " << SAIDA_REGRESSAO
+              << " se houver regressao" << std::endl;
+    std::cerr << "     [--grava-linha-base BASE.json]  grava as medianas como nova linha de base" << std::endl;
+}
+
+/** @brief Grava no disco e tira do cache todos os arquivos de uma arvore. */
+void descarta_do_cache(const std::string& raiz) {
+    ::sync();
+    std::error_code erro;
+    for (auto it = fs::recursive_directory_iterator(raiz, erro); !erro && it != fs::recursive_directory_iterator();
+         it.increment(erro)) {
+        int fd = ::open(it->path().c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd >= 0) {
+            ::posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+            ::close(fd);
+        }
+    }
+}
+
+double cronometra(const std::string& parm, const std::string& origem, const std::string& destino,
+                  Operacao operacao, bool& ok) {
+    auto inicio = std::chrono::steady_clock::now();
+    ok = executa_backup_restauracao(parm, origem, destino, operacao) == SUCESSO;
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+}
+
+/**
+ * @brief Gera a arvore do perfil uma vez e mede 'repeticoes' ciclos backup/incremental/restauracao.
+ * @details As amostras sao acrescentadas em 'resultados' (chave perfil/operacao), o que
+ * permite repetir um perfil e somar as novas amostras as anteriores. Com --durabilidade
+ * o perfil e medido em cada modo ('variante' e o nome do modo), e cada operacao comeca
+ * com o cache sujo ja gravado (sync), para que um modo nao pague pelas escritas do outro.
+ * Com --pipeline, a arvore lida pelo backup e pela restauracao tambem sai do cache antes,
+ * para que a leitura venha do dispositivo, que e o que o pipeline sobrepoe a escrita.
+ */
+bool mede_perfil(PerfilArvore perfil, const Configuracao& config, unsigned repeticoes,
+                 std::map<std::string, ResultadoBench>& resultados, const std::string& variante = "") {
+    const std::string nome = variante.empty() ? std::string(nome_perfil(perfil))
+                                              : std::string(nome_perfil(perfil)) + ":" + variante;
+    const std::string origem = config.pasta + "/" + nome + "_origem";
+    const std::string destino = config.pasta + "/" + nome + "_destino";
+    const std::string restaurado = config.pasta + "/" + nome + "_restaurado";
+
+    ArvoreGerada arvore;
+    if (gera_arvore(perfil, origem, config.escala, arvore) != SUCESSO) {
+        return false;
+    }
+
+    bool ok = true;
+    std::error_code erro;
+    for (unsigned r = 0; ok && r < repeticoes; ++r) {
+        fs::remove_all(destino, erro);
+        fs::remove_all(restaurado, erro);
+        double s[TOTAL_OPERACOES];
+        const bool limpa_cache = !variante.empty();
+        const bool le_do_disco = !config.pipelines.empty();
+        if (le_do_disco) {
+            descarta_do_cache(origem);
+        } else if (limpa_cache) {
+            ::sync();
+        }
+        s[0] = cronometra(arvore.arquivo_parm, origem, destino, BACKUP, ok);
+        if (limpa_cache) {
+            ::sync();
+        }
+        s[1] = ok ? cronometra(arvore.arquivo_parm, origem, destino, BACKUP, ok) : 0.0;
+        if (le_do_disco) {
+            descarta_do_cache(destino);
+        } else if (limpa_cache) {
+            ::sync();
+        }
+        s[2] = ok ? cronometra(arvore.arquivo_parm, destino, restaurado, RESTAURACAO, ok) : 0.0;
+        for (int op = 0; ok && op < TOTAL_OPERACOES; ++op) {
+            ResultadoBench& r_op = resultados[nome + "/" + OPERACOES[op]];
+            r_op.perfil = nome;
+            r_op.operacao = OPERACOES[op];
+            r_op.arquivos = arvore.arquivos;
+            // So os bytes de dados: os buracos dos arquivos esparsos nao sao lidos nem gravados
+            r_op.bytes = (op == 1) ? 0 : arvore.bytes_dados;
+            r_op.segundos.push_back(s[op]);
+        }
+    }
+    if (!ok) {
+        std::cerr << "ERRO: Operacao falhou no perfil " << nome << std::endl;
+    }
+
+    // Libera o espaco antes do proximo perfil
+    fs::remove_all(origem, erro);
+    fs::remove_all(destino, erro);
+    fs::remove_all(restaurado, erro);
+    return ok;
+}
+
+void imprime_tabela(const std::map<std::string, ResultadoBench>& resultados) {
+    std::cout << std::left << std::setw(18) << "Perfil" << std::setw(13) << "Operacao" << std::right
+              << std::setw(10) << "Arquivos" << std::setw(10) << "Segundos" << std::setw(8) << "+-%"
+              << std::setw(12) << "Arquivos/s" << std::setw(10) << "MB/s" << std::endl;
+    for (const auto& [chave, r] : resultados) {
+        std::cout << std::left << std::setw(18) << r.perfil << std::setw(13) << r.operacao << std::right
+                  << std::setw(10) << r.arquivos << std::fixed << std::setprecision(3)
+                  << std::setw(10) << r.mediana() << std::setprecision(1) << std::setw(8) << 100 * r.dispersao()
+                  << std::setprecision(0) << std::setw(12) << r.arquivos_por_s()
+                  << std::setprecision(1) << std::setw(10) << r.mb_por_s() << std::endl;
+    }
+    std::cout.unsetf(std::ios::fixed);
+}
+
+void grava_json(const Configuracao& config, const std::map<std::string, ResultadoBench>& resultados) {
+    std::ofstream saida(config.arquivo_saida, std::ios::trunc);
+    saida << std::setprecision(6);
+    saida << "{\"ferramenta\":\"bench_backup\",\"rotulo\":\"" << config.rotulo << "\",\"escala\":" << config.escala
+          << ",\"repeticoes\":" << config.repeticoes << ",\"resultados\":[";
+    bool primeiro = true;
+    for (const auto& [chave, r] : resultados) {
+        saida << (primeiro ? "\n" : ",\n") << "{\"perfil\":\"" << r.perfil << "\",\"operacao\":\""
+              << r.operacao << "\",\"arquivos\":" << r.arquivos << ",\"bytes\":" << r.bytes
+              << ",\"segundos\":" << r.mediana() << ",\"dispersao\":" << r.dispersao()
+              << ",\"arquivos_por_s\":" << r.arquivos_por_s() << ",\"mb_por_s\":" << r.mb_por_s()
+              << ",\"amostras\":[";
+        for (std::size_t i = 0; i < r.segundos.size(); ++i) {
+            saida << (i ? "," : "") << r.segundos[i];
+        }
+        saida << "]}";
+        primeiro = false;
+    }
+    saida << "\n]}\n";
+}
+
+// ==============================================================================
+// LINHA DE BASE (make perfcheck)
+// ==============================================================================
+
+// O formato e o gravado por grava_linha_base: uma metrica por linha
+bool extrai_campo(const std::string& linha, const std::string& campo, std::string& valor) {
+    const std::string chave = "\"" + campo + "\":";
+    std::string::size_type pos = linha.find(chave);
+    if (pos == std::string::npos) {
+        return false;
+    }
+    pos += chave.size();
+    if (linha[pos] == '"') {
+        std::string::size_type fim = linha.find('"', pos + 1);
+        valor = linha.substr(pos + 1, fim - pos - 1);
+    } else {
+        std::string::size_type fim = linha.find_first_of(",}", pos);
+        valor = linha.substr(pos, fim - pos);
+    }
+    return true;
+}
+
+bool le_linha_base(const std::string& caminho, double& escala, std::vector<MetricaBase>& metricas) {
+    std::ifstream entrada(caminho);
+    if (!entrada.is_open()) {
+        std::cerr << "ERRO: Linha de base ausente: " << caminho << std::endl;
+        return false;
+    }
+    std::string linha, valor;
+    while (std::getline(entrada, linha)) {
+        if (extrai_campo(linha, "escala", valor)) {
+            escala = std::strtod(valor.c_str(), nullptr);
+        }
+        MetricaBase m;
+        if (extrai_campo(linha, "perfil", m.perfil) && extrai_campo(linha, "operacao", m.operacao) &&
+            extrai_campo(linha, "metrica", m.metrica) && extrai_campo(linha, "valor", valor)) {
+            m.valor = std::strtod(valor.c_str(), nullptr);
+            m.tolerancia = extrai_campo(linha, "tolerancia", valor) ? std::strtod(valor.c_str(), nullptr) : 0.25;
+            metricas.push_back(m);
+        }
+    }
+    return !metricas.empty();
+}
+
+void grava_linha_base(const Configuracao& config, const std::map<std::string, ResultadoBench>& resultados) {
+    std::ofstream saida(config.grava_linha_base, std::ios::trunc);
+    saida << std::setprecision(6);
+    saida << "{\"escala\":" << config.escala << ",\"repeticoes\":" << config.repeticoes
+          << ",\"rotulo\":\"" << config.rotulo << "\",\"metricas\":[";
+    bool primeiro = true;
+    for (const auto& [chave, r] : resultados) {
+        if (r.mediana() < DURACAO_MINIMA_BASE) {
+            continue;
+        }
+        // Incremental e arquivos pequenos: o que importa e arquivos/s; copias de arquivos grandes, MB/s
+        const bool por_bytes = r.bytes > 0 && r.bytes / r.arquivos >= 1024 * 1024;
+        saida << (primeiro ? "\n" : ",\n") << "{\"perfil\":\"" << r.perfil << "\",\"operacao\":\"" << r.operacao
+              << "\",\"metrica\":\"" << (por_bytes ? "mb_por_s" : "arquivos_por_s")
+              << "\",\"valor\":" << (por_bytes ? r.mb_por_s() : r.arquivos_por_s())
+              << ",\"tolerancia\":" << (por_bytes ? TOLERANCIA_MB_POR_S : TOLERANCIA_ARQUIVOS_POR_S) << "}";
+        primeiro = false;
+    }
+    saida << "\n]}\n";
+}
+
+/** @brief Metricas abaixo do minimo aceitavel (valor * (1 - tolerancia)). */
+std::vector<const MetricaBase*> regressoes(const std::vector<MetricaBase>& metricas,
+                                          const std::map<std::string, ResultadoBench>& resultados,
+                                          bool imprime) {
+    std::vector<const MetricaBase*> lentas;
+    for (const MetricaBase& m : metricas) {
+        auto r = resultados.find(m.perfil + "/" + m.operacao);
+        if (r == resultados.end()) {
+            continue;
+        }
+        double atual = r->second.metrica(m.metrica);
+        double minimo = m.valor * (1.0 - m.tolerancia);
+        bool lenta = atual < minimo;
+        if (lenta) {
+            lentas.push_back(&m);
+        }
+        if (imprime) {
+            std::cout << (lenta ? "REGRESSAO " : "ok        ") << std::left << std::setw(10) << m.perfil
+                      << std::setw(13) << m.operacao << std::setw(16) << m.metrica << std::right << std::fixed
+                      << std::setprecision(1) << std::setw(12) << atual << " (base " << m.valor
+                      << ", minimo " << minimo << ", " << std::showpos << 100 * (atual / m.valor - 1)
+                      << std::noshowpos << "%)" << std::endl;
+            std::cout.unsetf(std::ios::fixed);
+        }
+    }
+    return lentas;
+}
+
+// ==============================================================================
+// RESIDENCIA NO CACHE DE PAGINAS (make benchcache)
+// ==============================================================================
+
+// Arquivo que faz o papel do conjunto de trabalho de outro processo (ex: banco de dados)
+constexpr std::size_t TAMANHO_CONJUNTO_TRABALHO = 64 * 1024 * 1024;
+
+/** @brief Bytes em cache e bytes alocados (sem os buracos) dos arquivos de uma arvore. */
+void residencia_da_arvore(const std::string& raiz, std::uintmax_t& em_cache, std::uintmax_t& total) {
+    em_cache = 0;
+    total = 0;
+    std::error_code erro;
+    for (auto it = fs::recursive_directory_iterator(raiz, erro); !erro && it != fs::recursive_directory_iterator();
+         it.increment(erro)) {
+        struct stat st;
+        if (it->is_regular_file(erro) && ::stat(it->path().c_str(), &st) == 0) {
+            em_cache += bytes_em_cache(it->path().string());
+            total += std::min<std::uintmax_t>(static_cast<std::uintmax_t>(st.st_blocks) * 512,
+                                              static_cast<std::uintmax_t>(st.st_size));
+        }
+    }
+}
+
+/** @brief Le o arquivo inteiro, trazendo-o para o cache. */
+void aquece(const std::string& caminho) {
+    std::ifstream entrada(caminho, std::ios::binary);
+    std::vector<char> buffer(1 << 20);
+    while (entrada.read(buffer.data(), static_cast<std::streamsize>(buffer.size())) || entrada.gcount() > 0) {
+    }
+}
+
+double percentual(std::uintmax_t parte, std::uintmax_t total) {
+    return total > 0 ? 100.0 * static_cast<double>(parte) / static_cast<double>(total) : 0.0;
+}
+
+/**
+ * @brief Mede quanto da origem, do destino e de um conjunto de trabalho alheio fica no
+ * cache de paginas depois de um backup, com e sem --sem-cache.
+ * @details Antes de cada backup a origem e o destino saem do cache e o conjunto de
+ * trabalho e lido para dentro dele, como o de um banco de dados em producao.
+ */
+bool mede_residencia(PerfilArvore perfil, const Configuracao& config) {
+    const std::string nome = nome_perfil(perfil);
+    const std::string origem = config.pasta + "/" + nome + "_origem";
+    const std::string destino = config.pasta + "/" + nome + "_destino";
+    const std::string trabalho = config.pasta + "/conjunto_de_trabalho.bin";
+
+    ArvoreGerada arvore;
+    if (gera_arvore(perfil, origem, config.escala, arvore) != SUCESSO) {
+        return false;
+    }
+    {
+        std::ofstream saida(trabalho, std::ios::binary | std::ios::trunc);
+        std::string bloco(1 << 20, 't');
+        for (std::size_t i = 0; i < TAMANHO_CONJUNTO_TRABALHO; i += bloco.size()) {
+            saida.write(bloco.data(), static_cast<std::streamsize>(bloco.size()));
+        }
+    }
+
+    bool ok = true;
+    std::error_code erro;
+    for (bool sem_cache : {false, true}) {
+        fs::remove_all(destino, erro);
+        descarta_do_cache(origem);
+        aquece(trabalho);
+        const std::uintmax_t trabalho_antes = bytes_em_cache(trabalho);
+
+        define_preserva_cache(sem_cache);
+        ok = cronometra(arvore.arquivo_parm, origem, destino, BACKUP, ok) >= 0.0 && ok;
+        define_preserva_cache(false);
+        if (!ok) {
+            break;
+        }
+
+        std::uintmax_t origem_cache, origem_total, destino_cache, destino_total;
+        residencia_da_arvore(origem, origem_cache, origem_total);
+        residencia_da_arvore(destino, destino_cache, destino_total);
+        std::cout << std::left << std::setw(10) << nome << std::setw(12) << (sem_cache ? "sem-cache" : "normal")
+                  << std::right << std::fixed << std::setprecision(1)
+                  << std::setw(11) << percentual(origem_cache, origem_total) << "%"
+                  << std::setw(11) << percentual(destino_cache, destino_total) << "%"
+                  << std::setw(13) << percentual(trabalho_antes, TAMANHO_CONJUNTO_TRABALHO) << "%"
+                  << std::setw(13) << percentual(bytes_em_cache(trabalho), TAMANHO_CONJUNTO_TRABALHO) << "%"
+                  << std::endl;
+        std::cout.unsetf(std::ios::fixed);
+    }
+    if (!ok) {
+        std::cerr << "ERRO: Operacao falhou no perfil " << nome << std::endl;
+    }
+
+    fs::remove_all(origem, erro);
+    fs::remove_all(destino, erro);
+    fs::remove(trabalho, erro);
+    return ok;
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+    Configuracao config;
+    bool escala_informada = false;
+
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--perfis" && i + 1 < argc) {
+            std::stringstream lista(argv[++i]);
+            std::string nome;
+            while (std::getline(lista, nome, ',')) {
+                PerfilArvore perfil;
+                if (!interpreta_perfil(nome, perfil)) {
+                    std::cerr << "ERRO: Perfil desconhecido: " << nome << std::endl;
+                    return EXIT_FAILURE;
+                }
+                config.perfis.push_back(perfil);
+            }
+        } else if (arg == "--escala" && i + 1 < argc) {
+            config.escala = std::strtod(argv[++i], nullptr);
+            escala_informada = true;
+        } else if (arg == "--repeticoes" && i + 1 < argc) {
+            config.repeticoes = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--dir" && i + 1 < argc) {
+            config.pasta = argv[++i];
+        } else if (arg == "--saida" && i + 1 < argc) {
+            config.arquivo_saida = argv[++i];
+        } else if (arg == "--rotulo" && i + 1 < argc) {
+            config.rotulo = argv[++i];
+        } else if (arg == "--durabilidade" && i + 1 < argc) {
+            std::stringstream lista(argv[++i]);
+            std::string nome;
+            while (std::getline(lista, nome, ',')) {
+                ModoDurabilidade modo;
+                if (!interpreta_durabilidade(nome, modo)) {
+                    std::cerr << "ERRO: Modo de durabilidade desconhecido: " << nome << std::endl;
+                    return EXIT_FAILURE;
+                }
+                config.modos.push_back(modo);
+            }
+        } else if (arg == "--pipeline" && i + 1 < argc) {
+            std::stringstream lista(argv[++i]);
+            std::string nome;
+            while (std::getline(lista, nome, ',')) {
+                ModoPipeline modo;
+                if (!interpreta_pipeline(nome, modo)) {
+                    std::cerr << "ERRO: Modo de pipeline desconhecido: " << nome << std::endl;
+                    return EXIT_FAILURE;
+                }
+                config.pipelines.push_back(modo);
+            }
+        } else if (arg == "--residencia") {
+            config.residencia = true;
+        } else if (arg == "--linha-base" && i + 1 < argc) {
+            config.linha_base = argv[++i];
+        } else if (arg == "--grava-linha-base" && i + 1 < argc) {
+            config.grava_linha_base = argv[++i];
+        } else {
+            imprime_uso(argv[0]);
+            return EXIT_FAILURE;
+        }
+    }
+
+    // Na comparacao, a escala e os perfis vem da linha de base (mesma carga de trabalho)
+    std::vector<MetricaBase> metricas;
+    if (!config.linha_base.empty()) {
+        double escala_base = config.escala;
+        if (!le_linha_base(config.linha_base, escala_base, metricas)) {
+            return EXIT_FAILURE;
+        }
+        if (!escala_informada) {
+            config.escala = escala_base;
+        }
+        if (config.perfis.empty()) {
+            std::set<std::string> nomes;
+            for (const MetricaBase& m : metricas) {
+                PerfilArvore perfil;
+                if (nomes.insert(m.perfil).second && interpreta_perfil(m.perfil, perfil)) {
+                    config.perfis.push_back(perfil);
+                }
+            }
+        }
+    }
+    if (config.escala <= 0.0 || config.repeticoes == 0) {
+        std::cerr << "ERRO: Escala ou numero de repeticoes invalido." << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (config.perfis.empty()) {
+        for (int p = 0; p < TOTAL_PERFIS; ++p) {
+            config.perfis.push_back(static_cast<PerfilArvore>(p));
+        }
+    }
+
+    if ((!config.modos.empty() || !config.pipelines.empty()) &&
+        (!config.linha_base.empty() || !config.grava_linha_base.empty())) {
+        std::cerr << "ERRO: --durabilidade e --pipeline nao se combinam com a linha de base." << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (!config.modos.empty() && !config.pipelines.empty()) {
+        std::cerr << "ERRO: --durabilidade e --pipeline sao comparacoes separadas." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (config.residencia) {
+        std::cout << std::left << std::setw(10) << "Perfil" << std::setw(12) << "Modo" << std::right
+                  << std::setw(12) << "Origem" << std::setw(12) << "Destino" << std::setw(14) << "Trab. antes"
+                  << std::setw(14) << "Trab. depois" << std::endl;
+        for (PerfilArvore perfil : config.perfis) {
+            if (!mede_residencia(perfil, config)) {
+                return EXIT_FAILURE;
+            }
+        }
+        return EXIT_SUCCESS;
+    }
+
+    std::map<std::string, ResultadoBench> resultados;
+    for (PerfilArvore perfil : config.perfis) {
+        if (config.modos.empty() && config.pipelines.empty()) {
+            if (!mede_perfil(perfil, config, config.repeticoes, resultados)) {
+                return EXIT_FAILURE;
+            }
+            continue;
+        }
+        for (ModoDurabilidade modo : config.modos) {
+            define_durabilidade(modo);
+            if (!mede_perfil(perfil, config, config.repeticoes, resultados, nome_durabilidade(modo))) {
+                return EXIT_FAILURE;
+            }
+        }
+        for (ModoPipeline modo : config.pipelines) {
+            define_pipeline(modo);
+            if (!mede_perfil(perfil, config, config.repeticoes, resultados, nome_pipeline(modo))) {
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    int codigo_saida = EXIT_SUCCESS;
+    if (!metricas.empty()) {
+        // Confirmacao: um perfil abaixo do minimo e medido de novo com o mesmo numero de
+        // repeticoes e so e reprovado se a mediana de todas as amostras continuar abaixo
+        std::set<std::string> suspeitos;
+        for (const MetricaBase* m : regressoes(metricas, resultados, false)) {
+            suspeitos.insert(m->perfil);
+        }
+        for (const std::string& nome : suspeitos) {
+            PerfilArvore perfil;
+            interpreta_perfil(nome, perfil);
+            std::cout << "Confirmando perfil " << nome << "..." << std::endl;
+            if (!mede_perfil(perfil, config, config.repeticoes, resultados)) {
+                return EXIT_FAILURE;
+            }
+        }
+        if (!regressoes(metricas, resultados, true).empty()) {
+            codigo_saida = SAIDA_REGRESSAO;
+        }
+    }
+
+    imprime_tabela(resultados);
+    grava_json(config, resultados);
+    std::cout << "Resultados: " << config.arquivo_saida << std::endl;
+    if (!config.grava_linha_base.empty()) {
+        grava_linha_base(config, resultados);
+        std::cout << "Linha de base: " << config.grava_linha_base << std::endl;
+    }
+    if (codigo_saida != EXIT_SUCCESS) {
+        std::cerr << "ERRO: Desempenho abaixo da linha de base." << std::endl;
+    }
+    return codigo_saida;
+}
@@ -0,0 +1,197 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "catch_amalgamated.hpp"
+#include "backup.hpp"
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+// ==============================================================================
+// MICRO-BENCHMARKS DO CAMINHO DE DECISAO (make microbench)
+// ==============================================================================
+//
+// Medem o custo por arquivo da tabela de decisao em uma arvore em memoria (tmpfs),
+// separando regressoes do codigo do ruido do disco. Os casos com copia (2, 3, 9 e
+// 11) preparam um destino novo para cada execucao fora da medicao.
+
+namespace {
+
+const std::string CONTEUDO(4096, 'x');
+
+std::string pasta_em_memoria() {
+    std::error_code erro;
+    fs::path base = fs::is_directory("/dev/shm", erro) ? fs::path("/dev/shm") : fs::temp_directory_path();
+    return (base / "sysbackup_microbench").string();
+}
+
+void cria_arquivo(const std::string& caminho, const fs::file_time_type& data) {
+    std::ofstream arquivo(caminho, std::ios::trunc);
+    arquivo << CONTEUDO;
+    arquivo.close();
+    fs::last_write_time(caminho, data);
+}
+
+/**
+ * @brief Arvore minima com um arquivo em cada situacao da tabela de decisao.
+ */
+struct ArvoreDecisao {
+    std::string raiz = pasta_em_memoria();
+    std::string hd = raiz + "/hd";
+    std::string pd = raiz + "/pd";
+    std::string novos = raiz + "/novos";
+    fs::file_time_type agora = fs::file_time_type::clock::now();
+    fs::file_time_type antes = agora - std::chrono::hours(1);
+
+    ArvoreDecisao() {
+        fs::remove_all(raiz);
+        fs::create_directories(hd);
+        fs::create_directories(pd);
+        cria_arquivo(hd + "/igual", agora);
+        cria_arquivo(pd + "/igual", agora);
+        cria_arquivo(hd + "/hd_novo", agora);
+        cria_arquivo(pd + "/hd_novo", antes);
+        cria_arquivo(hd + "/pd_novo", antes);
+        cria_arquivo(pd + "/pd_novo", agora);
+        cria_arquivo(hd + "/so_hd", agora);
+        cria_arquivo(pd + "/so_pd", agora);
+    }
+    ~ArvoreDecisao() {
+        std::error_code erro;
+        fs::remove_all(raiz, erro);
+    }
+
+    /** @brief Recria a pasta de destinos descartaveis, com 'runs' copias opcionais de um arquivo. */
+    std::vector<std::string> destinos(int runs, const fs::file_time_type* data_existente) {
+        fs::remove_all(novos);
+        fs::create_directories(novos);
+        std::vector<std::string> caminhos;
+        for (int i = 0; i < runs; ++i) {
+            caminhos.push_back(novos + "/" + std::to_string(i));
+            if (data_existente != nullptr) {
+                cria_arquivo(caminhos.back(), *data_existente);
+            }
+        }
+        return caminhos;
+    }
+};
+
+void cria_parm(const std::string& caminho, std::size_t linhas) {
+    std::ofstream arquivo(caminho, std::ios::trunc);
+    for (std::size_t i = 0; i < linhas; ++i) {
+        arquivo << "pasta" << i % 100 << "/arquivo" << i << ".txt\n";
+    }
+}
+
+}  // namespace
+
+TEST_CASE("Custo por arquivo da tabela de decisao de BACKUP", "[microbench][backup]") {
+    ArvoreDecisao t;
+
+    BENCHMARK_ADVANCED("Caso 2: copia (PD ausente)")(Catch::Benchmark::Chronometer meter) {
+        std::vector<std::string> destinos = t.destinos(meter.runs(), nullptr);
+        meter.measure([&](int i) { return faz_backup_arquivo(t.hd + "/so_hd", destinos[i], BACKUP); });
+    };
+    BENCHMARK_ADVANCED("Caso 3: copia (PD mais antigo)")(Catch::Benchmark::Chronometer meter) {
+        std::vector<std::string> destinos = t.destinos(meter.runs(), &t.antes);
+        meter.measure([&](int i) { return faz_backup_arquivo(t.hd + "/so_hd", destinos[i], BACKUP); });
+    };
+    BENCHMARK("Caso 4: ignora (datas iguais)") {
+        return faz_backup_arquivo(t.hd + "/igual", t.pd + "/igual", BACKUP);
+    };
+    BENCHMARK("Caso 5: erro (PD mais novo)") {
+        return faz_backup_arquivo(t.hd + "/pd_novo", t.pd + "/pd_novo", BACKUP);
+    };
+    BENCHMARK("Caso 6: ignora (ausente nos dois)") {
+        return faz_backup_arquivo(t.hd + "/nenhum", t.pd + "/nenhum", BACKUP);
+    };
+    BENCHMARK("Caso 7: ignora (HD ausente)") {
+        return faz_backup_arquivo(t.hd + "/so_pd", t.pd + "/so_pd", BACKUP);
+    };
+}
+
+TEST_CASE("Custo por arquivo da tabela de decisao de RESTAURACAO", "[microbench][restauracao]") {
+    ArvoreDecisao t;
+
+    BENCHMARK("Caso 8: erro (HD mais novo)") {
+        return faz_backup_arquivo(t.pd + "/hd_novo", t.hd + "/hd_novo", RESTAURACAO);
+    };
+    BENCHMARK_ADVANCED("Caso 9: copia (PD mais novo)")(Catch::Benchmark::Chronometer meter) {
+        std::vector<std::string> destinos = t.destinos(meter.runs(), &t.antes);
+        meter.measure([&](int i) { return faz_backup_arquivo(t.pd + "/pd_novo", destinos[i], RESTAURACAO); });
+    };
+    BENCHMARK("Caso 10: ignora (datas iguais)") {
+        return faz_backup_arquivo(t.pd + "/igual", t.hd + "/igual", RESTAURACAO);
+    };
+    BENCHMARK_ADVANCED("Caso 11: copia (HD ausente)")(Catch::Benchmark::Chronometer meter) {
+        std::vector<std::string> destinos = t.destinos(meter.runs(), nullptr);
+        meter.measure([&](int i) { return faz_backup_arquivo(t.pd + "/so_pd", destinos[i], RESTAURACAO); });
+    };
+    BENCHMARK("Caso 12: erro (PD ausente, HD existe)") {
+        return faz_backup_arquivo(t.pd + "/so_hd", t.hd + "/so_hd", RESTAURACAO);
+    };
+    BENCHMARK("Caso 13: erro (ausente nos dois)") {
+        return faz_backup_arquivo(t.pd + "/nenhum", t.hd + "/nenhum", RESTAURACAO);
+    };
+}
+
+TEST_CASE("Leitura do Backup.parm por tamanho da lista", "[microbench][parametros]") {
+    const std::string raiz = pasta_em_memoria();
+    fs::remove_all(raiz);
+    fs::create_directories(raiz);
+
+    for (std::size_t linhas : {10u, 1000u, 100000u}) {
+        const std::string parm = raiz + "/Backup_" + std::to_string(linhas) + ".parm";
+        cria_parm(parm, linhas);
+        BENCHMARK("le_arquivo_parametros com " + std::to_string(linhas) + " linhas") {
+            std::vector<std::string> arquivos;
+            le_arquivo_parametros(parm, arquivos);
+            return arquivos.size();
+        };
+    }
+    fs::remove_all(raiz);
+}
+
+TEST_CASE("Orquestracao sobre armazenamento em memoria", "[microbench][armazenamento]") {
+    // Arquivos virtuais (so tamanho) isolam o custo da orquestracao do custo do disco
+    const std::string raiz = pasta_em_memoria();
+    fs::remove_all(raiz);
+    fs::create_directories(raiz);
+    const std::size_t linhas = 10000;
+    const std::string parm = raiz + "/Backup.parm";
+    cria_parm(parm, linhas);
+
+    std::vector<std::string> arquivos;
+    le_arquivo_parametros(parm, arquivos);
+    const auto data = fs::file_time_type::clock::now();
+    ArmazenamentoMemoria hd;
+    for (const auto& arquivo : arquivos) {
+        hd.cria_arquivo_virtual("hd/" + arquivo, 4096, data);
+    }
+    ArmazenamentoMemoria pd;
+    pd.descarta_conteudo(true);
+    executa_backup_restauracao(parm, "hd", "pd", BACKUP, hd, pd);
+
+    BENCHMARK("executa_backup_restauracao incremental com " + std::to_string(linhas) + " arquivos virtuais") {
+        return executa_backup_restauracao(parm, "hd", "pd", BACKUP, hd, pd);
+    };
+    fs::remove_all(raiz);
+}
+
+TEST_CASE("Conversao de codigos de resultado", "[microbench]") {
+    const ResultadoBackup codigos[] = {
+        SUCESSO, IGNORAR, ERRO_ARQUIVO_PARAMETROS_AUSENTE, ERRO_ARQUIVO_DESTINO_MAIS_NOVO,
+        ERRO_ARQUIVO_ORIGEM_NAO_EXISTE, ERRO_ARQUIVO_ORIGEM_MAIS_ANTIGO, ERRO_GERAL,
+        ERRO_CHECKSUM_DIVERGENTE, ERRO_MANIFESTO_AUSENTE,
+    };
+    BENCHMARK("resultado_para_string (todos os codigos)") {
+        std::size_t total = 0;
+        for (ResultadoBackup codigo : codigos) {
+            total += resultado_para_string(codigo).size();
+        }
+        return total;
+    };
+}
@@ -0,0 +1,180 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "buffers.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+const std::size_t TAMANHO_PAGINA_ENORME = 2 * 1024 * 1024;
+const std::uint64_t MASCARA_INDICE = 0xFFFFFFFFu;
+
+std::size_t arredonda(std::size_t valor, std::size_t multiplo) {
+    return (valor + multiplo - 1) / multiplo * multiplo;
+}
+
+std::size_t tamanho_pagina() {
+    static const std::size_t pagina = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return pagina;
+}
+
+/**
+ * @brief Mapeia memoria anonima ja com as paginas presentes.
+ * @details Com paginas enormes tenta primeiro as reservadas (MAP_HUGETLB) e, sem elas, pede
+ * transparent huge pages ao kernel. nullptr se nao houver memoria.
+ */
+void* mapeia(std::size_t tamanho, bool paginas_enormes) {
+    const int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE;
+    void* p = MAP_FAILED;
+    if (paginas_enormes) {
+        p = ::mmap(nullptr, tamanho, PROT_READ | PROT_WRITE, flags | MAP_HUGETLB, -1, 0);
+    }
+    if (p == MAP_FAILED) {
+        p = ::mmap(nullptr, tamanho, PROT_READ | PROT_WRITE, flags, -1, 0);
+        if (p != MAP_FAILED && paginas_enormes) {
+            ::madvise(p, tamanho, MADV_HUGEPAGE);
+        }
+    }
+    return p == MAP_FAILED ? nullptr : p;
+}
+
+}  // namespace
+
+// ==============================================================================
+// EMPRESTIMO
+// ==============================================================================
+
+PoolBuffers::Emprestimo& PoolBuffers::Emprestimo::operator=(Emprestimo&& outro) noexcept {
+    if (this != &outro) {
+        devolve();
+        pool_ = outro.pool_;
+        indice_ = outro.indice_;
+        dados_ = outro.dados_;
+        outro.pool_ = nullptr;
+        outro.dados_ = nullptr;
+    }
+    return *this;
+}
+
+void PoolBuffers::Emprestimo::devolve() {
+    if (pool_ != nullptr) {
+        pool_->devolve(indice_, dados_);
+        pool_ = nullptr;
+        dados_ = nullptr;
+    }
+}
+
+// ==============================================================================
+// POOL
+// ==============================================================================
+
+PoolBuffers::PoolBuffers(std::size_t tamanho, std::size_t capacidade)
+    : tamanho_(tamanho),
+      capacidade_(std::min<std::size_t>(capacidade, MASCARA_INDICE - 1)),
+      buffers_(new char*[capacidade_]()),
+      proximo_(new std::atomic<std::uint32_t>[capacidade_]) {
+    assert(tamanho > 0);
+}
+
+PoolBuffers::~PoolBuffers() {
+    assert(em_uso() == 0);
+    for (const auto& mapeamento : mapeamentos_) {
+        ::munmap(mapeamento.first, mapeamento.second);
+    }
+}
+
+std::uint32_t PoolBuffers::retira_livre() {
+    std::uint64_t topo = topo_.load(std::memory_order_acquire);
+    for (;;) {
+        const std::uint32_t indice = static_cast<std::uint32_t>(topo & MASCARA_INDICE);
+        if (indice == 0) {
+            return SEM_INDICE;
+        }
+        // Se outra thread retirar e devolver o mesmo topo no meio, a geracao mudou e o CAS falha
+        const std::uint64_t novo =
+            (((topo >> 32) + 1) << 32) | proximo_[indice - 1].load(std::memory_order_relaxed);
+        if (topo_.compare_exchange_weak(topo, novo, std::memory_order_acq_rel, std::memory_order_acquire)) {
+            return indice - 1;
+        }
+    }
+}
+
+void PoolBuffers::insere_livre(std::uint32_t indice) {
+    std::uint64_t topo = topo_.load(std::memory_order_relaxed);
+    std::uint64_t novo;
+    do {
+        proximo_[indice].store(static_cast<std::uint32_t>(topo & MASCARA_INDICE), std::memory_order_relaxed);
+        novo = (((topo >> 32) + 1) << 32) | (indice + 1);
+    } while (!topo_.compare_exchange_weak(topo, novo, std::memory_order_release, std::memory_order_relaxed));
+}
+
+std::uint32_t PoolBuffers::cria_buffers() {
+    std::lock_guard<std::mutex> trava(mutex_crescimento_);
+    // Outra thread pode ter criado buffers enquanto esta esperava a trava
+    std::uint32_t indice = retira_livre();
+    if (indice != SEM_INDICE) {
+        return indice;
+    }
+    const std::size_t criados = criados_.load(std::memory_order_relaxed);
+    if (criados >= capacidade_) {
+        return SEM_INDICE;
+    }
+
+    // Com paginas enormes, um mapeamento de 2 MiB (ou mais) e recortado em varios buffers
+    const bool enormes = paginas_enormes();
+    const std::size_t passo = arredonda(tamanho_, tamanho_pagina());
+    const std::size_t mapeado = enormes ? arredonda(passo, TAMANHO_PAGINA_ENORME) : passo;
+    const std::size_t quantidade = std::min(mapeado / passo, capacidade_ - criados);
+    char* base = static_cast<char*>(mapeia(mapeado, enormes));
+    if (base == nullptr) {
+        throw std::bad_alloc();
+    }
+    mapeamentos_.emplace_back(base, mapeado);
+
+    for (std::size_t i = 0; i < quantidade; ++i) {
+        buffers_[criados + i] = base + i * passo;
+    }
+    criados_.store(criados + quantidade, std::memory_order_release);
+    for (std::size_t i = 1; i < quantidade; ++i) {
+        insere_livre(static_cast<std::uint32_t>(criados + i));
+    }
+    return static_cast<std::uint32_t>(criados);
+}
+
+PoolBuffers::Emprestimo PoolBuffers::empresta() {
+    std::uint32_t indice = retira_livre();
+    if (indice == SEM_INDICE) {
+        indice = cria_buffers();
+    }
+    em_uso_.fetch_add(1, std::memory_order_relaxed);
+    if (indice != SEM_INDICE) {
+        return Emprestimo(this, indice, buffers_[indice]);
+    }
+
+    // Pool esgotado: buffer avulso, liberado na devolucao
+    char* avulso = static_cast<char*>(std::aligned_alloc(tamanho_pagina(), arredonda(tamanho_, tamanho_pagina())));
+    if (avulso == nullptr) {
+        em_uso_.fetch_sub(1, std::memory_order_relaxed);
+        throw std::bad_alloc();
+    }
+    avulsos_.fetch_add(1, std::memory_order_relaxed);
+    return Emprestimo(this, SEM_INDICE, avulso);
+}
+
+void PoolBuffers::devolve(std::uint32_t indice, char* dados) {
+    if (indice == SEM_INDICE) {
+        std::free(dados);
+    } else {
+        insere_livre(indice);
+    }
+    em_uso_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+PoolBuffers& pool_blocos() {
+    static PoolBuffers pool(TAMANHO_BUFFER_POOL, CAPACIDADE_POOL_PADRAO);
+    return pool;
+}
@@ -0,0 +1,112 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef BUFFERS_HPP
+#define BUFFERS_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/** Tamanho dos buffers de pool_blocos (bloco do motor de copia, da verificacao, do tar e da rede). */
+const std::size_t TAMANHO_BUFFER_POOL = 1 << 20;
+/** Quantidade maxima de buffers de pool_blocos; alem disso os emprestimos viram alocacoes avulsas. */
+const std::size_t CAPACIDADE_POOL_PADRAO = 1024;
+
+/**
+ * @brief Pool de buffers de tamanho fixo, alinhados a pagina, compartilhado pelas threads de copia.
+ * @details Os buffers sao criados sob demanda (mmap) e nunca devolvidos ao sistema enquanto o
+ * pool existe: emprestar e devolver so movem um indice numa lista livre sem trava (pilha de
+ * Treiber com contador de geracao contra o problema ABA). Assim, em regime, os emprestimos nao
+ * fazem nenhuma alocacao (nem heap, nem mmap) e a memoria fica limitada ao maior numero de
+ * buffers emprestados ao mesmo tempo (um ou dois por thread de copia, mais o anel do
+ * pipeline), qualquer que seja o numero de arquivos. Com paginas
+ * enormes, os buffers sao recortados de blocos de 2 MiB (MAP_HUGETLB, ou transparent huge
+ * pages quando nao ha paginas reservadas).
+ */
+class PoolBuffers {
+ public:
+    /**
+     * @brief Buffer emprestado; volta para o pool ao sair de escopo.
+     */
+    class Emprestimo {
+     public:
+        Emprestimo() = default;
+        ~Emprestimo() { devolve(); }
+        Emprestimo(Emprestimo&& outro) noexcept { *this = std::move(outro); }
+        Emprestimo& operator=(Emprestimo&& outro) noexcept;
+        Emprestimo(const Emprestimo&) = delete;
+        Emprestimo& operator=(const Emprestimo&) = delete;
+
+        char* get() const { return dados_; }
+        std::size_t tamanho() const { return pool_ != nullptr ? pool_->tamanho() : 0; }
+        void devolve();
+
+     private:
+        friend class PoolBuffers;
+        Emprestimo(PoolBuffers* pool, std::uint32_t indice, char* dados)
+            : pool_(pool), indice_(indice), dados_(dados) {}
+
+        PoolBuffers* pool_ = nullptr;
+        std::uint32_t indice_ = 0;
+        char* dados_ = nullptr;
+    };
+
+    /**
+     * @param tamanho Bytes de cada buffer (arredondado para a pagina no mapeamento).
+     * @param capacidade Quantidade maxima de buffers do pool.
+     */
+    PoolBuffers(std::size_t tamanho, std::size_t capacidade);
+    ~PoolBuffers();
+    PoolBuffers(const PoolBuffers&) = delete;
+    PoolBuffers& operator=(const PoolBuffers&) = delete;
+
+    /**
+     * @brief Empresta um buffer livre, criando um novo se nao houver.
+     * @details Com o pool na capacidade maxima, o buffer e alocado avulso e liberado na
+     * devolucao (so acontece com mais emprestimos simultaneos do que a capacidade).
+     * @throw std::bad_alloc se nao houver memoria.
+     */
+    Emprestimo empresta();
+
+    /** @brief Buffers criados a partir de agora usam paginas enormes (--paginas-enormes). */
+    void define_paginas_enormes(bool ativo) { paginas_enormes_.store(ativo, std::memory_order_relaxed); }
+    bool paginas_enormes() const { return paginas_enormes_.load(std::memory_order_relaxed); }
+
+    std::size_t tamanho() const { return tamanho_; }
+    /** @brief Buffers criados pelo pool (memoria ocupada = buffers_criados() * tamanho()). */
+    std::size_t buffers_criados() const { return criados_.load(std::memory_order_acquire); }
+    /** @brief Buffers emprestados neste momento (inclusive os avulsos). */
+    std::size_t em_uso() const { return em_uso_.load(std::memory_order_relaxed); }
+    /** @brief Emprestimos que nao couberam no pool e foram alocados avulsos. */
+    std::uint64_t avulsos() const { return avulsos_.load(std::memory_order_relaxed); }
+
+ private:
+    static const std::uint32_t SEM_INDICE = 0xFFFFFFFFu;
+
+    std::uint32_t retira_livre();
+    void insere_livre(std::uint32_t indice);
+    std::uint32_t cria_buffers();
+    void devolve(std::uint32_t indice, char* dados);
+
+    std::size_t tamanho_;
+    std::size_t capacidade_;
+    std::unique_ptr<char*[]> buffers_;                    ///< Buffer de cada indice.
+    std::unique_ptr<std::atomic<std::uint32_t>[]> proximo_;  ///< Encadeamento da lista livre (indice + 1).
+    std::atomic<std::uint64_t> topo_{0};                  ///< Geracao (32 bits altos) e indice + 1 do topo.
+    std::atomic<std::size_t> criados_{0};
+    std::atomic<std::size_t> em_uso_{0};
+    std::atomic<std::uint64_t> avulsos_{0};
+    std::atomic<bool> paginas_enormes_{false};
+
+    std::mutex mutex_crescimento_;  ///< So na criacao de buffers, nunca no emprestimo em regime.
+    std::vector<std::pair<void*, std::size_t>> mapeamentos_;
+};
+
+/** @brief Pool de buffers de TAMANHO_BUFFER_POOL bytes do processo. */
+PoolBuffers& pool_blocos();
+
+#endif  // BUFFERS_HPP
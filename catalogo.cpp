@@ -0,0 +1,395 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "catalogo.hpp"
+#include "snapshot.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <tuple>
+#include <utility>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+const char* const NOME_CATALOGO = "Backup.catalogo";
+
+namespace {
+
+// Formato do segmento (little-endian):
+//   cabecalho: MAGICO[8] | quantidade u64 | reservado u64
+//   registros: quantidade x REGISTRO (tamanho fixo, ordenados por caminho e versao)
+//   strings:   caminhos e nomes de snapshot referenciados pelos registros
+const char MAGICO[8] = {'S', 'B', 'C', 'A', 'T', '0', '1', '\n'};
+constexpr std::size_t TAM_CABECALHO = 24;
+constexpr std::size_t TAM_REGISTRO = 48;
+
+struct Registro {
+    std::uint64_t off_caminho;
+    std::uint32_t tam_caminho;
+    std::uint32_t tam_snapshot;
+    std::uint64_t off_snapshot;
+    std::int64_t versao;
+    std::uint64_t checksum;
+    std::uint64_t bytes;
+};
+
+void serializa(const Registro& r, char* p) {
+    std::memcpy(p, &r.off_caminho, 8);
+    std::memcpy(p + 8, &r.tam_caminho, 4);
+    std::memcpy(p + 12, &r.tam_snapshot, 4);
+    std::memcpy(p + 16, &r.off_snapshot, 8);
+    std::memcpy(p + 24, &r.versao, 8);
+    std::memcpy(p + 32, &r.checksum, 8);
+    std::memcpy(p + 40, &r.bytes, 8);
+}
+
+bool le_exato(int fd, void* destino, std::size_t tamanho, std::uint64_t offset) {
+    char* p = static_cast<char*>(destino);
+    while (tamanho > 0) {
+        ssize_t n = ::pread(fd, p, tamanho, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) {
+            continue;  // Sinal (ex.: SIGHUP) durante a leitura
+        }
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        offset += static_cast<std::uint64_t>(n);
+        tamanho -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+bool le_registro(int fd, std::uint64_t indice, Registro& r) {
+    char bruto[TAM_REGISTRO];
+    if (!le_exato(fd, bruto, TAM_REGISTRO, TAM_CABECALHO + indice * TAM_REGISTRO)) {
+        return false;
+    }
+    std::memcpy(&r.off_caminho, bruto, 8);
+    std::memcpy(&r.tam_caminho, bruto + 8, 4);
+    std::memcpy(&r.tam_snapshot, bruto + 12, 4);
+    std::memcpy(&r.off_snapshot, bruto + 16, 8);
+    std::memcpy(&r.versao, bruto + 24, 8);
+    std::memcpy(&r.checksum, bruto + 32, 8);
+    std::memcpy(&r.bytes, bruto + 40, 8);
+    return true;
+}
+
+std::string le_string(int fd, std::uint64_t offset, std::uint32_t tamanho) {
+    std::string s(tamanho, '\0');
+    if (tamanho > 0 && !le_exato(fd, &s[0], tamanho, offset)) {
+        return std::string();
+    }
+    return s;
+}
+
+bool menor_chave(const VersaoCatalogo& a, const VersaoCatalogo& b) {
+    return std::tie(a.caminho, a.versao) < std::tie(b.caminho, b.versao);
+}
+
+}  // namespace
+
+// ==============================================================================
+// VERSOES E INSTANTES
+// ==============================================================================
+
+std::int64_t versao_do_snapshot(const std::string& nome_snapshot) {
+    if (!eh_nome_snapshot(nome_snapshot)) {
+        return -1;
+    }
+    std::tm partes{};
+    partes.tm_year = std::stoi(nome_snapshot.substr(0, 4)) - 1900;
+    partes.tm_mon = std::stoi(nome_snapshot.substr(5, 2)) - 1;
+    partes.tm_mday = std::stoi(nome_snapshot.substr(8, 2));
+    partes.tm_hour = std::stoi(nome_snapshot.substr(11, 2));
+    partes.tm_min = std::stoi(nome_snapshot.substr(13, 2));
+    partes.tm_sec = std::stoi(nome_snapshot.substr(15, 2));
+    std::int64_t sufixo = nome_snapshot.size() > 17 ? std::stoll(nome_snapshot.substr(18)) : 0;
+    return static_cast<std::int64_t>(timegm(&partes)) * 1000 + std::min<std::int64_t>(sufixo, 999);
+}
+
+std::int64_t versao_limite(std::time_t instante) {
+    return static_cast<std::int64_t>(instante) * 1000 + 999;
+}
+
+bool interpreta_instante(const std::string& texto, std::time_t& instante) {
+    std::tm partes{};
+    int ano = 0, mes = 0, dia = 0, hora = 23, minuto = 59, segundo = 59;
+    char resto = '\0';
+    if (std::sscanf(texto.c_str(), "%4d-%2d-%2d_%2d%2d%2d%c", &ano, &mes, &dia, &hora, &minuto, &segundo,
+                    &resto) == 6 ||
+        std::sscanf(texto.c_str(), "%4d-%2d-%2d %2d:%2d:%2d%c", &ano, &mes, &dia, &hora, &minuto, &segundo,
+                    &resto) == 6) {
+        // Instante exato
+    } else if (texto.size() == 10 && std::sscanf(texto.c_str(), "%4d-%2d-%2d", &ano, &mes, &dia) == 3) {
+        hora = 23;  // Apenas a data: vale o estado ao fim do dia
+        minuto = 59;
+        segundo = 59;
+    } else {
+        return false;
+    }
+    if (mes < 1 || mes > 12 || dia < 1 || dia > 31 || hora > 23 || minuto > 59 || segundo > 60) {
+        return false;
+    }
+    partes.tm_year = ano - 1900;
+    partes.tm_mon = mes - 1;
+    partes.tm_mday = dia;
+    partes.tm_hour = hora;
+    partes.tm_min = minuto;
+    partes.tm_sec = segundo;
+    instante = timegm(&partes);
+    return true;
+}
+
+// ==============================================================================
+// CATALOGO (SEGMENTOS ORDENADOS + COMPACTACAO)
+// ==============================================================================
+
+Catalogo::Catalogo(const std::string& caminho_destino_base)
+    : diretorio_(caminho_destino_base + "/" + NOME_CATALOGO) {
+    abre_segmentos();
+}
+
+Catalogo::~Catalogo() {
+    fecha_segmentos();
+}
+
+void Catalogo::fecha_segmentos() {
+    for (auto& segmento : segmentos_) {
+        ::close(segmento.fd);
+    }
+    segmentos_.clear();
+}
+
+void Catalogo::abre_segmentos() {
+    fecha_segmentos();
+
+    std::vector<std::string> nomes;
+    std::error_code erro;
+    for (fs::directory_iterator it(diretorio_, erro), fim; !erro && it != fim; it.increment(erro)) {
+        if (it->path().extension() == ".seg") {
+            nomes.push_back(it->path().string());
+        }
+    }
+    std::sort(nomes.begin(), nomes.end());  // Numeros com zeros a esquerda: ordem cronologica
+
+    for (const auto& nome : nomes) {
+        int fd = ::open(nome.c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        // Segmento vazio: numero reservado por uma gravacao em andamento (ou interrompida)
+        struct stat info {};
+        if (::fstat(fd, &info) == 0 && info.st_size == 0) {
+            ::close(fd);
+            continue;
+        }
+        char cabecalho[TAM_CABECALHO];
+        std::uint64_t quantidade = 0;
+        if (!le_exato(fd, cabecalho, TAM_CABECALHO, 0) || std::memcmp(cabecalho, MAGICO, 8) != 0) {
+            std::cerr << "Segmento de catalogo invalido ignorado: " << nome << std::endl;
+            ::close(fd);
+            continue;
+        }
+        std::memcpy(&quantidade, cabecalho + 8, 8);
+        segmentos_.push_back(Segmento{nome, fd, quantidade});
+    }
+}
+
+unsigned Catalogo::proximo_numero() const {
+    if (segmentos_.empty()) {
+        return 1;
+    }
+    return static_cast<unsigned>(std::stoul(fs::path(segmentos_.back().caminho).stem().string())) + 1;
+}
+
+ResultadoBackup Catalogo::grava_segmento(std::vector<VersaoCatalogo>& versoes, unsigned numero) {
+    std::sort(versoes.begin(), versoes.end(), menor_chave);
+
+    // Os nomes de snapshot se repetem muito: cada um e gravado uma unica vez
+    std::uint64_t inicio_strings = TAM_CABECALHO + versoes.size() * TAM_REGISTRO;
+    std::string strings;
+    std::map<std::string, std::uint64_t> snapshots;
+    std::string registros(versoes.size() * TAM_REGISTRO, '\0');
+
+    for (std::size_t i = 0; i < versoes.size(); ++i) {
+        const VersaoCatalogo& v = versoes[i];
+        Registro r{};
+        r.off_caminho = inicio_strings + strings.size();
+        r.tam_caminho = static_cast<std::uint32_t>(v.caminho.size());
+        strings += v.caminho;
+
+        auto existente = snapshots.find(v.snapshot);
+        if (existente == snapshots.end()) {
+            existente = snapshots.emplace(v.snapshot, inicio_strings + strings.size()).first;
+            strings += v.snapshot;
+        }
+        r.off_snapshot = existente->second;
+        r.tam_snapshot = static_cast<std::uint32_t>(v.snapshot.size());
+        r.versao = v.versao;
+        r.checksum = v.checksum;
+        r.bytes = v.bytes;
+        serializa(r, &registros[i * TAM_REGISTRO]);
+    }
+
+    char cabecalho[TAM_CABECALHO] = {};
+    std::memcpy(cabecalho, MAGICO, 8);
+    std::uint64_t quantidade = versoes.size();
+    std::memcpy(cabecalho + 8, &quantidade, 8);
+
+    std::error_code erro;
+    fs::create_directories(diretorio_, erro);
+
+    // Reserva o numero criando o segmento vazio com O_EXCL: duas execucoes concorrentes
+    // nunca gravam o mesmo numero (nem o mesmo temporario); a perdedora tenta o seguinte
+    std::string caminho;
+    for (;; ++numero) {
+        char nome[32];
+        std::snprintf(nome, sizeof(nome), "%08u.seg", numero);
+        caminho = diretorio_ + "/" + nome;
+        int fd = ::open(caminho.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (fd >= 0) {
+            ::close(fd);
+            break;
+        }
+        if (errno != EEXIST) {
+            std::cerr << "Erro ao gravar segmento do catalogo: " << caminho << ": " << std::strerror(errno)
+                      << std::endl;
+            return ERRO_GERAL;
+        }
+    }
+    const std::string temporario = caminho + ".tmp";
+    {
+        std::ofstream arquivo(temporario, std::ios::binary | std::ios::trunc);
+        arquivo.write(cabecalho, TAM_CABECALHO);
+        arquivo.write(registros.data(), static_cast<std::streamsize>(registros.size()));
+        arquivo.write(strings.data(), static_cast<std::streamsize>(strings.size()));
+        arquivo.flush();
+        if (!arquivo) {
+            std::cerr << "Erro ao gravar segmento do catalogo: " << temporario << std::endl;
+            fs::remove(temporario, erro);
+            fs::remove(caminho, erro);
+            return ERRO_GERAL;
+        }
+    }
+    // O rename substitui a reserva vazia: leitores nunca veem um segmento pela metade
+    fs::rename(temporario, caminho, erro);
+    if (erro) {
+        std::cerr << "Erro ao gravar segmento do catalogo: " << erro.message() << std::endl;
+        return ERRO_GERAL;
+    }
+    return SUCESSO;
+}
+
+ResultadoBackup Catalogo::adiciona(std::vector<VersaoCatalogo> versoes) {
+    if (versoes.empty()) {
+        return SUCESSO;
+    }
+    ResultadoBackup resultado = grava_segmento(versoes, proximo_numero());
+    if (resultado != SUCESSO) {
+        return resultado;
+    }
+    abre_segmentos();
+
+    // Compactacao: muitos segmentos pequenos viram um so
+    if (segmentos_.size() > LIMITE_SEGMENTOS) {
+        return reescreve(todas_as_versoes());
+    }
+    return SUCESSO;
+}
+
+ResultadoBackup Catalogo::reescreve(std::vector<VersaoCatalogo> versoes) {
+    std::vector<std::string> antigos;
+    for (const auto& segmento : segmentos_) {
+        antigos.push_back(segmento.caminho);
+    }
+
+    ResultadoBackup resultado = grava_segmento(versoes, proximo_numero());
+    if (resultado != SUCESSO) {
+        return resultado;
+    }
+    // O segmento novo ja contem tudo; uma queda aqui deixa apenas registros duplicados
+    fecha_segmentos();
+    for (const auto& antigo : antigos) {
+        std::error_code erro;
+        fs::remove(antigo, erro);
+    }
+    abre_segmentos();
+    return SUCESSO;
+}
+
+bool Catalogo::busca(const std::string& caminho, std::int64_t versao_maxima, VersaoCatalogo& encontrada) const {
+    bool achou = false;
+
+    for (const auto& segmento : segmentos_) {
+        // Pesquisa binaria pelo primeiro registro com chave > (caminho, versao_maxima)
+        std::uint64_t inicio = 0, fim = segmento.quantidade;
+        Registro r{};
+        while (inicio < fim) {
+            std::uint64_t meio = inicio + (fim - inicio) / 2;
+            if (!le_registro(segmento.fd, meio, r)) {
+                return false;
+            }
+            std::string chave = le_string(segmento.fd, r.off_caminho, r.tam_caminho);
+            int comparacao = chave.compare(caminho);
+            if (comparacao < 0 || (comparacao == 0 && r.versao <= versao_maxima)) {
+                inicio = meio + 1;
+            } else {
+                fim = meio;
+            }
+        }
+        if (inicio == 0 || !le_registro(segmento.fd, inicio - 1, r)) {
+            continue;
+        }
+        if (le_string(segmento.fd, r.off_caminho, r.tam_caminho) != caminho) {
+            continue;
+        }
+        // Segmentos mais novos prevalecem em caso de empate
+        if (!achou || r.versao >= encontrada.versao) {
+            encontrada.caminho = caminho;
+            encontrada.versao = r.versao;
+            encontrada.snapshot = le_string(segmento.fd, r.off_snapshot, r.tam_snapshot);
+            encontrada.checksum = r.checksum;
+            encontrada.bytes = r.bytes;
+            achou = true;
+        }
+    }
+
+    // Assertiva de saida
+    assert(!achou || encontrada.versao <= versao_maxima);
+    return achou;
+}
+
+std::vector<VersaoCatalogo> Catalogo::todas_as_versoes() const {
+    std::map<std::pair<std::string, std::int64_t>, VersaoCatalogo> mescladas;
+    for (const auto& segmento : segmentos_) {
+        for (std::uint64_t i = 0; i < segmento.quantidade; ++i) {
+            Registro r{};
+            if (!le_registro(segmento.fd, i, r)) {
+                break;
+            }
+            VersaoCatalogo v;
+            v.caminho = le_string(segmento.fd, r.off_caminho, r.tam_caminho);
+            v.versao = r.versao;
+            v.snapshot = le_string(segmento.fd, r.off_snapshot, r.tam_snapshot);
+            v.checksum = r.checksum;
+            v.bytes = r.bytes;
+            mescladas[{v.caminho, v.versao}] = v;
+        }
+    }
+
+    std::vector<VersaoCatalogo> versoes;
+    versoes.reserve(mescladas.size());
+    for (auto& par : mescladas) {
+        versoes.push_back(std::move(par.second));
+    }
+    return versoes;
+}
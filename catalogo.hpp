@@ -0,0 +1,110 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef CATALOGO_HPP
+#define CATALOGO_HPP
+
+#include "backup.hpp"
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+/** Nome do diretorio do catalogo de versoes, na raiz do destino do backup. */
+extern const char* const NOME_CATALOGO;
+
+/**
+ * @brief Uma versao de um arquivo registrada no catalogo.
+ * @details A chave e (caminho, versao); o valor indica o snapshot onde os bytes
+ * dessa versao foram gravados.
+ */
+struct VersaoCatalogo {
+    std::string caminho;        ///< Caminho relativo, como em Backup.parm.
+    std::int64_t versao = 0;    ///< Instante do snapshot (ver versao_do_snapshot).
+    std::string snapshot;       ///< Diretorio do snapshot que contem os bytes.
+    std::uint64_t checksum = 0; ///< XXH64 do conteudo.
+    std::uint64_t bytes = 0;    ///< Tamanho do conteudo.
+};
+
+/**
+ * @brief Converte o nome de um snapshot em numero de versao ordenavel.
+ * @details versao = segundos UTC * 1000 + sufixo ".N" (snapshots no mesmo segundo).
+ * @return -1 se o nome nao for de snapshot.
+ */
+std::int64_t versao_do_snapshot(const std::string& nome_snapshot);
+
+/** @brief Maior versao possivel para um instante (inclui todos os sufixos do segundo). */
+std::int64_t versao_limite(std::time_t instante);
+
+/**
+ * @brief Interpreta o argumento de --as-of (UTC).
+ * @details Aceita "AAAA-MM-DD" (fim do dia), "AAAA-MM-DD_HHMMSS" e "AAAA-MM-DD HH:MM:SS".
+ * @return false se o texto nao estiver em nenhum desses formatos.
+ */
+bool interpreta_instante(const std::string& texto, std::time_t& instante);
+
+/**
+ * @brief Catalogo persistente de versoes em estilo LSM.
+ * @details Cada execucao grava um segmento imutavel com registros de tamanho fixo
+ * ordenados por (caminho, versao), seguido das strings. A busca faz pesquisa binaria
+ * com pread diretamente no arquivo, sem carregar o segmento; quando o numero de
+ * segmentos passa de LIMITE_SEGMENTOS eles sao mesclados em um so, mantendo a busca
+ * logaritmica mesmo apos anos de versoes.
+ */
+class Catalogo {
+ public:
+    /** Numero de segmentos que dispara a compactacao. */
+    static const std::size_t LIMITE_SEGMENTOS = 8;
+
+    /** @brief Abre (sem criar) o catalogo de um destino de backup. */
+    explicit Catalogo(const std::string& caminho_destino_base);
+    ~Catalogo();
+    Catalogo(const Catalogo&) = delete;
+    Catalogo& operator=(const Catalogo&) = delete;
+
+    /**
+     * @brief Grava um novo segmento com as versoes informadas.
+     * @return SUCESSO ou ERRO_GERAL.
+     * @post As versoes passam a ser visiveis para busca().
+     */
+    ResultadoBackup adiciona(std::vector<VersaoCatalogo> versoes);
+
+    /**
+     * @brief Encontra a versao de um arquivo vigente em um instante.
+     * @param caminho Caminho relativo do arquivo.
+     * @param versao_maxima Maior versao aceitavel (ver versao_limite).
+     * @param encontrada Recebe a versao mais recente com versao <= versao_maxima.
+     * @return false se o arquivo nao tinha nenhuma versao ate aquele instante.
+     */
+    bool busca(const std::string& caminho, std::int64_t versao_maxima, VersaoCatalogo& encontrada) const;
+
+    /**
+     * @brief Lista todas as versoes registradas (ordenadas por caminho e versao).
+     */
+    std::vector<VersaoCatalogo> todas_as_versoes() const;
+
+    /**
+     * @brief Substitui todos os segmentos por um unico segmento com as versoes dadas.
+     * @return SUCESSO ou ERRO_GERAL.
+     */
+    ResultadoBackup reescreve(std::vector<VersaoCatalogo> versoes);
+
+    /** @brief Numero de segmentos atualmente em uso. */
+    std::size_t segmentos() const { return segmentos_.size(); }
+
+ private:
+    struct Segmento {
+        std::string caminho;
+        int fd;
+        std::uint64_t quantidade;
+    };
+
+    void abre_segmentos();
+    void fecha_segmentos();
+    ResultadoBackup grava_segmento(std::vector<VersaoCatalogo>& versoes, unsigned numero);
+    unsigned proximo_numero() const;
+
+    std::string diretorio_;
+    std::vector<Segmento> segmentos_;  ///< Do mais antigo ao mais novo.
+};
+
+#endif  // CATALOGO_HPP
@@ -0,0 +1,215 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "checksum.hpp"
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+
+namespace {
+
+constexpr std::uint64_t PRIMO1 = 0x9E3779B185EBCA87ULL;
+constexpr std::uint64_t PRIMO2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr std::uint64_t PRIMO3 = 0x165667B19E3779F9ULL;
+constexpr std::uint64_t PRIMO4 = 0x85EBCA77C2B2AE63ULL;
+constexpr std::uint64_t PRIMO5 = 0x27D4EB2F165667C5ULL;
+
+inline std::uint64_t rotl(std::uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+inline std::uint64_t le64(const unsigned char* p) {
+    std::uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;  // Assume arquitetura little-endian (x86/ARM)
+}
+
+inline std::uint32_t le32(const unsigned char* p) {
+    std::uint32_t v;
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+inline std::uint64_t rodada(std::uint64_t acc, std::uint64_t entrada) {
+    acc += entrada * PRIMO2;
+    acc = rotl(acc, 31);
+    return acc * PRIMO1;
+}
+
+inline std::uint64_t mescla(std::uint64_t h, std::uint64_t acc) {
+    h ^= rodada(0, acc);
+    return h * PRIMO1 + PRIMO4;
+}
+
+}  // namespace
+
+HashXXH64::HashXXH64()
+    : acc_{PRIMO1 + PRIMO2, PRIMO2, 0, 0 - PRIMO1}, total_(0), pendente_{}, tam_pendente_(0) {}
+
+void HashXXH64::atualiza(const void* dados, std::size_t tamanho) {
+    const unsigned char* p = static_cast<const unsigned char*>(dados);
+    const unsigned char* fim = p + tamanho;
+    total_ += tamanho;
+
+    // Completa o bloco de 32 bytes que ficou pendente na chamada anterior
+    if (tam_pendente_ > 0) {
+        std::size_t falta = 32 - tam_pendente_;
+        if (tamanho < falta) {
+            std::memcpy(pendente_ + tam_pendente_, p, tamanho);
+            tam_pendente_ += tamanho;
+            return;
+        }
+        std::memcpy(pendente_ + tam_pendente_, p, falta);
+        p += falta;
+        for (int i = 0; i < 4; ++i) {
+            acc_[i] = rodada(acc_[i], le64(pendente_ + 8 * i));
+        }
+        tam_pendente_ = 0;
+    }
+
+    // Laco principal: quatro acumuladores independentes por bloco de 32 bytes
+    while (fim - p >= 32) {
+        acc_[0] = rodada(acc_[0], le64(p));
+        acc_[1] = rodada(acc_[1], le64(p + 8));
+        acc_[2] = rodada(acc_[2], le64(p + 16));
+        acc_[3] = rodada(acc_[3], le64(p + 24));
+        p += 32;
+    }
+
+    if (p < fim) {
+        tam_pendente_ = static_cast<std::size_t>(fim - p);
+        std::memcpy(pendente_, p, tam_pendente_);
+    }
+}
+
+void HashXXH64::atualiza_zeros(std::uintmax_t tamanho) {
+    static const unsigned char zeros[32] = {};
+    if (tam_pendente_ > 0) {
+        std::size_t falta = static_cast<std::size_t>(std::min<std::uintmax_t>(32 - tam_pendente_, tamanho));
+        atualiza(zeros, falta);
+        tamanho -= falta;
+        if (tamanho == 0) {
+            return;
+        }
+    }
+    total_ += tamanho;
+
+    // Com entrada zero a rodada se reduz a rotacao e multiplicacao
+    std::uint64_t a0 = acc_[0], a1 = acc_[1], a2 = acc_[2], a3 = acc_[3];
+    for (std::uintmax_t blocos = tamanho / 32; blocos > 0; --blocos) {
+        a0 = ((a0 << 31) | (a0 >> 33)) * PRIMO1;
+        a1 = ((a1 << 31) | (a1 >> 33)) * PRIMO1;
+        a2 = ((a2 << 31) | (a2 >> 33)) * PRIMO1;
+        a3 = ((a3 << 31) | (a3 >> 33)) * PRIMO1;
+    }
+    acc_[0] = a0;
+    acc_[1] = a1;
+    acc_[2] = a2;
+    acc_[3] = a3;
+
+    tam_pendente_ = static_cast<std::size_t>(tamanho % 32);
+    std::memset(pendente_, 0, tam_pendente_);
+}
+
+std::uint64_t HashXXH64::finaliza() const {
+    std::uint64_t h;
+    if (total_ >= 32) {
+        h = rotl(acc_[0], 1) + rotl(acc_[1], 7) + rotl(acc_[2], 12) + rotl(acc_[3], 18);
+        for (int i = 0; i < 4; ++i) {
+            h = mescla(h, acc_[i]);
+        }
+    } else {
+        h = PRIMO5;
+    }
+    h += total_;
+
+    const unsigned char* p = pendente_;
+    const unsigned char* fim = pendente_ + tam_pendente_;
+    while (fim - p >= 8) {
+        h ^= rodada(0, le64(p));
+        h = rotl(h, 27) * PRIMO1 + PRIMO4;
+        p += 8;
+    }
+    if (fim - p >= 4) {
+        h ^= static_cast<std::uint64_t>(le32(p)) * PRIMO1;
+        h = rotl(h, 23) * PRIMO2 + PRIMO3;
+        p += 4;
+    }
+    while (p < fim) {
+        h ^= (*p) * PRIMO5;
+        h = rotl(h, 11) * PRIMO1;
+        ++p;
+    }
+
+    h ^= h >> 33;
+    h *= PRIMO2;
+    h ^= h >> 29;
+    h *= PRIMO3;
+    h ^= h >> 32;
+    return h;
+}
+
+std::string HashXXH64::exporta_estado() const {
+    // acc[0..3], total e os bytes pendentes (menos de 32)
+    std::string texto;
+    for (std::uint64_t valor : acc_) {
+        texto += checksum_para_hex(valor);
+    }
+    texto += checksum_para_hex(total_);
+    for (std::size_t i = 0; i < tam_pendente_; ++i) {
+        char byte[3];
+        std::snprintf(byte, sizeof(byte), "%02x", pendente_[i]);
+        texto += byte;
+    }
+    return texto;
+}
+
+bool HashXXH64::importa_estado(const std::string& texto) {
+    const std::size_t fixo = 5 * 16;
+    if (texto.size() < fixo || texto.size() > fixo + 2 * 31 || (texto.size() - fixo) % 2 != 0) {
+        return false;
+    }
+    std::uint64_t valores[5];
+    for (std::size_t i = 0; i < 5; ++i) {
+        if (!hex_para_checksum(texto.substr(16 * i, 16), valores[i])) {
+            return false;
+        }
+    }
+    const std::size_t tam_pendente = (texto.size() - fixo) / 2;
+    if (valores[4] % 32 != tam_pendente) {
+        return false;
+    }
+    unsigned char pendente[32] = {};
+    for (std::size_t i = 0; i < tam_pendente; ++i) {
+        char* fim = nullptr;
+        const std::string byte = texto.substr(fixo + 2 * i, 2);
+        pendente[i] = static_cast<unsigned char>(std::strtoul(byte.c_str(), &fim, 16));
+        if (fim != byte.c_str() + 2) {
+            return false;
+        }
+    }
+    std::memcpy(acc_, valores, sizeof(acc_));
+    total_ = valores[4];
+    std::memcpy(pendente_, pendente, sizeof(pendente_));
+    tam_pendente_ = tam_pendente;
+    return true;
+}
+
+std::string checksum_para_hex(std::uint64_t checksum) {
+    char buffer[17];
+    std::snprintf(buffer, sizeof(buffer), "%016llx", static_cast<unsigned long long>(checksum));
+    return std::string(buffer, 16);
+}
+
+bool hex_para_checksum(const std::string& hex, std::uint64_t& checksum) {
+    if (hex.size() != 16) {
+        return false;
+    }
+    char* fim = nullptr;
+    unsigned long long valor = std::strtoull(hex.c_str(), &fim, 16);
+    if (fim != hex.c_str() + hex.size()) {
+        return false;
+    }
+    checksum = static_cast<std::uint64_t>(valor);
+    return true;
+}
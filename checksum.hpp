@@ -0,0 +1,68 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef CHECKSUM_HPP
+#define CHECKSUM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Calculo incremental do hash XXH64 (semente 0).
+ * @details Permite alimentar o hash em blocos a medida que os dados passam pelo
+ * motor de copia, sem precisar reler o arquivo depois.
+ */
+class HashXXH64 {
+ public:
+    HashXXH64();
+
+    /**
+     * @brief Acrescenta um bloco de dados ao hash.
+     * @param dados Ponteiro para o bloco.
+     * @param tamanho Quantidade de bytes do bloco.
+     */
+    void atualiza(const void* dados, std::size_t tamanho);
+
+    /**
+     * @brief Acrescenta 'tamanho' bytes zero, sem ler memoria.
+     * @details Equivale a atualiza() com um bloco zerado; usado nos buracos de arquivos
+     * esparsos, que podem ter dezenas de GiB.
+     */
+    void atualiza_zeros(std::uintmax_t tamanho);
+
+    /**
+     * @brief Retorna o hash dos dados acumulados ate o momento.
+     * @post O estado interno nao e alterado; novos blocos podem ser acrescentados.
+     */
+    std::uint64_t finaliza() const;
+
+    /**
+     * @brief Estado interno em texto (hexadecimal), para continuar o calculo em outra execucao.
+     * @details Usado pela copia retomavel: o diario de checkpoint guarda o hash do prefixo
+     * ja gravado e a retomada segue dali sem reler o prefixo inteiro.
+     */
+    std::string exporta_estado() const;
+
+    /**
+     * @brief Restaura um estado produzido por exporta_estado.
+     * @return false (e estado inalterado) se o texto nao for valido.
+     */
+    bool importa_estado(const std::string& texto);
+
+ private:
+    std::uint64_t acc_[4];
+    std::uint64_t total_;
+    unsigned char pendente_[32];
+    std::size_t tam_pendente_;
+};
+
+/** @brief Converte um checksum para 16 digitos hexadecimais. */
+std::string checksum_para_hex(std::uint64_t checksum);
+
+/**
+ * @brief Converte 16 digitos hexadecimais em checksum.
+ * @return false se a string nao for um hexadecimal valido.
+ */
+bool hex_para_checksum(const std::string& hex, std::uint64_t& checksum);
+
+#endif  // CHECKSUM_HPP
@@ -0,0 +1,180 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "concorrencia.hpp"
+#include <algorithm>
+#include <cmath>
+#include <map>
+#include <memory>
+#include <sys/sysmacros.h>
+
+namespace {
+
+std::mutex g_mutex_controles;
+std::map<dev_t, std::unique_ptr<ControleConcorrencia>> g_controles;
+unsigned g_maximo = 0;
+
+}  // namespace
+
+// ==============================================================================
+// PERMISSAO
+// ==============================================================================
+
+ControleConcorrencia::Permissao& ControleConcorrencia::Permissao::operator=(Permissao&& outra) noexcept {
+    if (this != &outra) {
+        libera();
+        controle_ = outra.controle_;
+        inicio_ = outra.inicio_;
+        bytes_ = outra.bytes_;
+        outra.controle_ = nullptr;
+    }
+    return *this;
+}
+
+void ControleConcorrencia::Permissao::libera() {
+    if (controle_ != nullptr) {
+        controle_->registra(inicio_, bytes_);
+        controle_ = nullptr;
+    }
+}
+
+// ==============================================================================
+// CONTROLE AIMD
+// ==============================================================================
+
+ControleConcorrencia::ControleConcorrencia(unsigned maximo) : maximo_(std::max(1u, maximo)) {}
+
+ControleConcorrencia::Permissao ControleConcorrencia::adquire() {
+    std::unique_lock<std::mutex> trava(mutex_);
+    liberada_.wait(trava, [this] { return em_voo_ < limite_; });
+    ++em_voo_;
+    if (em_voo_ >= limite_) {
+        saturada_ = true;
+    }
+    return Permissao(this);
+}
+
+void ControleConcorrencia::registra(std::chrono::steady_clock::time_point inicio, std::uint64_t bytes) {
+    const auto agora = std::chrono::steady_clock::now();
+    std::lock_guard<std::mutex> trava(mutex_);
+    --em_voo_;
+    trabalho_janela_ += static_cast<double>(bytes) + CUSTO_OPERACAO;
+    latencia_janela_ += std::chrono::duration<double>(agora - inicio).count();
+    ++operacoes_janela_;
+
+    // Janela fechada com tempo e operacoes suficientes para a medida valer
+    const double decorrido = std::chrono::duration<double>(agora - inicio_janela_).count();
+    if (decorrido >= std::chrono::duration<double>(JANELA_CONCORRENCIA).count() &&
+        operacoes_janela_ >= limite_) {
+        const double vazao = trabalho_janela_ / decorrido;
+        const double latencia = latencia_janela_ / trabalho_janela_;
+        const bool saturada = saturada_;
+        inicio_janela_ = agora;
+        trabalho_janela_ = 0.0;
+        latencia_janela_ = 0.0;
+        operacoes_janela_ = 0;
+        saturada_ = em_voo_ >= limite_;
+
+        const unsigned antes = limite_;
+        aplica_passo(vazao, latencia, saturada);
+        if (limite_ > antes) {
+            liberada_.notify_all();
+            return;
+        }
+    }
+    liberada_.notify_one();
+}
+
+void ControleConcorrencia::ajusta(double vazao, double latencia, bool saturada) {
+    std::lock_guard<std::mutex> trava(mutex_);
+    const unsigned antes = limite_;
+    aplica_passo(vazao, latencia, saturada);
+    if (limite_ > antes) {
+        liberada_.notify_all();
+    }
+}
+
+void ControleConcorrencia::aplica_passo(double vazao, double latencia, bool saturada) {
+    if (vazao <= 0.0 || latencia <= 0.0) {
+        return;
+    }
+    // Referencia: a latencia sem fila, medida nas primeiras janelas (limite baixo)
+    latencia_minima_ = latencia_minima_ > 0.0 ? std::min(latencia_minima_, latencia) : latencia;
+    const bool ganhou = vazao > vazao_anterior_ * (1.0 + GANHO_MINIMO);
+    const bool fila = latencia > latencia_minima_ * LIMIAR_LATENCIA && !ganhou;
+    vazao_anterior_ = vazao;
+
+    if (fila) {
+        // Reducao multiplicativa: fim da partida lenta
+        partida_lenta_ = false;
+        ++reducoes_;
+        limite_ = std::max(1u, static_cast<unsigned>(std::floor(limite_ * FATOR_REDUCAO)));
+        return;
+    }
+    if (!saturada) {
+        return;  // Limite nao atingido: a medida nao diz nada sobre um limite maior
+    }
+    if (partida_lenta_ && !ganhou) {
+        partida_lenta_ = false;  // Patamar sem fila (ex: CPU): segue em passos de 1
+    }
+    limite_ = std::min(maximo_, partida_lenta_ ? limite_ * 2 : limite_ + 1);
+}
+
+unsigned ControleConcorrencia::limite() const {
+    std::lock_guard<std::mutex> trava(mutex_);
+    return limite_;
+}
+
+unsigned ControleConcorrencia::em_voo() const {
+    std::lock_guard<std::mutex> trava(mutex_);
+    return em_voo_;
+}
+
+std::uint64_t ControleConcorrencia::reducoes() const {
+    std::lock_guard<std::mutex> trava(mutex_);
+    return reducoes_;
+}
+
+// ==============================================================================
+// CONTROLES POR DISPOSITIVO
+// ==============================================================================
+
+void define_concorrencia_adaptativa(unsigned maximo) {
+    std::lock_guard<std::mutex> trava(g_mutex_controles);
+    g_controles.clear();
+    g_maximo = maximo;
+}
+
+unsigned concorrencia_adaptativa() {
+    std::lock_guard<std::mutex> trava(g_mutex_controles);
+    return g_maximo;
+}
+
+ControleConcorrencia& controle_do_dispositivo(dev_t dispositivo) {
+    std::lock_guard<std::mutex> trava(g_mutex_controles);
+    auto& controle = g_controles[dispositivo];
+    if (!controle) {
+        controle.reset(new ControleConcorrencia(g_maximo));
+    }
+    return *controle;
+}
+
+PermissoesDispositivos adquire_dispositivos(dev_t origem, dev_t destino) {
+    PermissoesDispositivos permissoes;
+    if (concorrencia_adaptativa() == 0) {
+        return permissoes;
+    }
+    permissoes.primeira_ = controle_do_dispositivo(std::min(origem, destino)).adquire();
+    if (origem != destino) {
+        permissoes.segunda_ = controle_do_dispositivo(std::max(origem, destino)).adquire();
+    }
+    return permissoes;
+}
+
+void relata_concorrencia(std::ostream& saida) {
+    std::lock_guard<std::mutex> trava(g_mutex_controles);
+    for (const auto& [dispositivo, controle] : g_controles) {
+        saida << "Concorrencia no dispositivo " << major(dispositivo) << ":" << minor(dispositivo) << ": limite "
+              << controle->limite() << " de " << controle->maximo() << ", " << controle->reducoes()
+              << " reducoes" << std::endl;
+    }
+}
@@ -0,0 +1,148 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef CONCORRENCIA_HPP
+#define CONCORRENCIA_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <utility>
+#include <sys/types.h>
+
+/** Teto de threads (e de operacoes simultaneas por dispositivo) com "-j auto". */
+const unsigned CONCORRENCIA_ADAPTATIVA_MAXIMA = 32;
+
+/**
+ * @brief Limite adaptativo de operacoes simultaneas em um dispositivo (AIMD, como o TCP).
+ * @details Cada operacao (copia ou vinculo de um arquivo) pede uma permissao antes de
+ * comecar e a devolve ao terminar, informando os bytes transferidos. A cada janela de
+ * JANELA_CONCORRENCIA o controle mede a vazao (bytes mais CUSTO_OPERACAO por operacao,
+ * por segundo) e a latencia (tempo das operacoes por byte transferido) e ajusta o limite:
+ * - partida lenta: o limite dobra enquanto a vazao cresce;
+ * - aumento aditivo: depois, +1 por janela em que o limite foi de fato atingido;
+ * - reducao multiplicativa: latencia acima de LIMIAR_LATENCIA vezes a menor da execucao, sem
+ *   ganho de vazao, indica fila no dispositivo (mais operacoes so esperam mais) e o limite
+ *   cai para FATOR_REDUCAO do atual.
+ * Num dispositivo saturado com n operacoes a latencia cresce na proporcao do excesso, de
+ * modo que o limite oscila logo acima do ponto de saturacao: alto num NVMe, 1 a 2 num HD,
+ * poucos num pen-drive.
+ */
+class ControleConcorrencia {
+ public:
+    static constexpr std::chrono::milliseconds JANELA_CONCORRENCIA{200};
+    static constexpr double CUSTO_OPERACAO = 64.0 * 1024.0;  ///< Bytes equivalentes a uma operacao.
+    static constexpr double LIMIAR_LATENCIA = 1.5;
+    static constexpr double FATOR_REDUCAO = 0.75;
+    static constexpr double GANHO_MINIMO = 0.05;  ///< Crescimento de vazao que conta como ganho.
+
+    /**
+     * @brief Permissao de uma operacao; devolvida ao sair de escopo.
+     */
+    class Permissao {
+     public:
+        Permissao() = default;
+        ~Permissao() { libera(); }
+        Permissao(Permissao&& outra) noexcept { *this = std::move(outra); }
+        Permissao& operator=(Permissao&& outra) noexcept;
+        Permissao(const Permissao&) = delete;
+        Permissao& operator=(const Permissao&) = delete;
+
+        /** @brief Bytes transferidos pela operacao (contados na vazao ao liberar). */
+        void conclui(std::uint64_t bytes) { bytes_ = bytes; }
+        void libera();
+
+     private:
+        friend class ControleConcorrencia;
+        explicit Permissao(ControleConcorrencia* controle)
+            : controle_(controle), inicio_(std::chrono::steady_clock::now()) {}
+
+        ControleConcorrencia* controle_ = nullptr;
+        std::chrono::steady_clock::time_point inicio_{};
+        std::uint64_t bytes_ = 0;
+    };
+
+    /** @param maximo Teto do limite (normalmente o numero de threads). */
+    explicit ControleConcorrencia(unsigned maximo);
+    ControleConcorrencia(const ControleConcorrencia&) = delete;
+    ControleConcorrencia& operator=(const ControleConcorrencia&) = delete;
+
+    /** @brief Espera ate haver menos operacoes em andamento que o limite. */
+    Permissao adquire();
+
+    /**
+     * @brief Aplica o passo AIMD com a medicao de uma janela.
+     * @param vazao Bytes equivalentes por segundo.
+     * @param latencia Segundos de operacao por byte equivalente.
+     * @param saturada Se o limite foi atingido na janela (sem isso o limite nao sobe).
+     */
+    void ajusta(double vazao, double latencia, bool saturada = true);
+
+    unsigned limite() const;
+    unsigned maximo() const { return maximo_; }
+    unsigned em_voo() const;
+    /** @brief Quantidade de reducoes multiplicativas (sinais de fila no dispositivo). */
+    std::uint64_t reducoes() const;
+
+ private:
+    void registra(std::chrono::steady_clock::time_point inicio, std::uint64_t bytes);
+    /** @brief Passo AIMD; exige mutex_ travado. */
+    void aplica_passo(double vazao, double latencia, bool saturada);
+
+    const unsigned maximo_;
+    mutable std::mutex mutex_;
+    std::condition_variable liberada_;
+    unsigned limite_ = 1;
+    unsigned em_voo_ = 0;
+    bool partida_lenta_ = true;
+    std::uint64_t reducoes_ = 0;
+    double vazao_anterior_ = 0.0;
+    double latencia_minima_ = 0.0;
+
+    // Janela em andamento
+    std::chrono::steady_clock::time_point inicio_janela_ = std::chrono::steady_clock::now();
+    double trabalho_janela_ = 0.0;
+    double latencia_janela_ = 0.0;
+    unsigned operacoes_janela_ = 0;
+    bool saturada_ = false;
+};
+
+/**
+ * @brief Permissoes de uma operacao na origem e no destino (uma so se forem o mesmo dispositivo).
+ * @details Vazia (sem efeito) com a concorrencia adaptativa desligada.
+ */
+class PermissoesDispositivos {
+ public:
+    void conclui(std::uint64_t bytes) {
+        primeira_.conclui(bytes);
+        segunda_.conclui(bytes);
+    }
+
+ private:
+    friend PermissoesDispositivos adquire_dispositivos(dev_t origem, dev_t destino);
+    ControleConcorrencia::Permissao primeira_;
+    ControleConcorrencia::Permissao segunda_;
+};
+
+/**
+ * @brief Liga a concorrencia adaptativa por dispositivo com o teto dado (0 desliga).
+ * @details Descarta os controles existentes: cada execucao recomeca a medicao.
+ */
+void define_concorrencia_adaptativa(unsigned maximo);
+/** @brief Teto definido por define_concorrencia_adaptativa (0 = desligada). */
+unsigned concorrencia_adaptativa();
+
+/** @brief Controle do dispositivo, criado na primeira operacao nele. */
+ControleConcorrencia& controle_do_dispositivo(dev_t dispositivo);
+
+/**
+ * @brief Adquire as permissoes da origem e do destino, sempre na ordem dos dispositivos.
+ * @details A ordem fixa evita que duas threads esperem uma pela outra.
+ */
+PermissoesDispositivos adquire_dispositivos(dev_t origem, dev_t destino);
+
+/** @brief Imprime o limite final de cada dispositivo (ex: "8:1 limite 2 de 32, 5 reducoes"). */
+void relata_concorrencia(std::ostream& saida);
+
+#endif  // CONCORRENCIA_HPP
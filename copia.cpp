@@ -0,0 +1,1239 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "copia.hpp"
+#include "armazenamento.hpp"
+#include "buffers.hpp"
+#include "checksum.hpp"
+#include "estatisticas.hpp"
+#include "limites.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <system_error>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Tamanho do bloco de leitura/escrita do motor de copia
+constexpr std::size_t TAMANHO_BLOCO = TAMANHO_BUFFER_POOL;
+// O buffer (do pool_blocos) e alinhado a pagina e cada escrita (exceto a ultima) e um bloco
+// inteiro num deslocamento multiplo de TAMANHO_BLOCO
+// A partir deste tamanho o destino e pre-alocado (fallocate) antes da copia
+constexpr std::uintmax_t LIMIAR_PREALOCACAO = TAMANHO_BLOCO;
+
+[[noreturn]] void lanca_erro(const std::string& origem, const std::string& destino, int erro) {
+    throw fs::filesystem_error("copia_arquivo", origem, destino,
+                               std::error_code(erro, std::system_category()));
+}
+
+/**
+ * @brief Fecha o descritor ao sair de escopo (inclusive quando uma excecao e lancada).
+ */
+class Descritor {
+ public:
+    explicit Descritor(int fd) : fd_(fd) {}
+    ~Descritor() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+    Descritor(const Descritor&) = delete;
+    Descritor& operator=(const Descritor&) = delete;
+
+    int get() const { return fd_; }
+
+    /** @brief Fecha explicitamente, retornando o errno em caso de falha (0 se OK). */
+    int fecha() {
+        int fd = fd_;
+        fd_ = -1;
+        return (::close(fd) == 0) ? 0 : errno;
+    }
+
+ private:
+    int fd_;
+};
+
+const char* const SUFIXO_COPIANDO = ".copiando";
+const char* const SUFIXO_VINCULANDO = ".vinculando";
+
+// Durabilidade das copias
+std::atomic<int> modo_durabilidade{DURABILIDADE_LOTE};
+
+/**
+ * @brief Copias publicadas que aguardam o syncfs do lote.
+ * @details Guarda um descritor (dup de uma das copias) por sistema de arquivos de
+ * destino, ja visto, ate o fim do processo: um syncfs nele confirma tudo o que foi gravado
+ * naquele sistema de arquivos, inclusive as renomeacoes. Cada confirmacao com copias
+ * pendentes sincroniza todos os sistemas conhecidos; assim uma copia inscrita antes do
+ * syncfs de outra thread e renomeada depois dele continua pendente e entra no proximo. O
+ * syncfs roda fora da trava, para nao segurar as outras threads de copia alem do necessario.
+ */
+class LoteDurabilidade {
+ public:
+    ~LoteDurabilidade() {
+        for (const auto& [dispositivo, fd] : sistemas_) {
+            (void)dispositivo;
+            ::close(fd);
+        }
+    }
+
+    void configura(std::size_t arquivos, std::chrono::milliseconds janela) {
+        std::lock_guard<std::mutex> trava(mutex_);
+        arquivos_por_lote_ = arquivos > 0 ? arquivos : 1;
+        janela_ = janela;
+    }
+
+    void inscreve(int fd, const std::string& caminho) {
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            lanca_erro(caminho, caminho, errno);
+        }
+        std::lock_guard<std::mutex> trava(mutex_);
+        if (sistemas_.count(st.st_dev) == 0) {
+            int copia = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+            if (copia < 0) {
+                lanca_erro(caminho, caminho, errno);
+            }
+            sistemas_[st.st_dev] = copia;
+        }
+    }
+
+    /** @brief Conta uma copia ja renomeada; confirma o lote quando ele completa. */
+    void conta() {
+        const auto agora = std::chrono::steady_clock::now();
+        {
+            std::lock_guard<std::mutex> trava(mutex_);
+            if (pendentes_++ == 0) {
+                primeiro_pendente_ = agora;
+            }
+            if (pendentes_ < arquivos_por_lote_ && agora - primeiro_pendente_ < janela_) {
+                return;
+            }
+        }
+        confirma();
+    }
+
+    bool confirma() {
+        std::vector<int> descritores;
+        {
+            std::lock_guard<std::mutex> trava(mutex_);
+            if (pendentes_ == 0) {
+                return true;
+            }
+            // Copias contadas a partir daqui ficam para o proximo syncfs
+            pendentes_ = 0;
+            for (const auto& [dispositivo, fd] : sistemas_) {
+                (void)dispositivo;
+                descritores.push_back(fd);
+            }
+        }
+        MEDE_FASE(FASE_SINCRONIA);
+        bool ok = true;
+        for (int fd : descritores) {
+            if (::syncfs(fd) != 0) {
+                std::cerr << "Erro ao confirmar as copias (syncfs): " << std::strerror(errno) << std::endl;
+                ok = false;
+            }
+        }
+        lotes_.fetch_add(1, std::memory_order_relaxed);
+        return ok;
+    }
+
+    std::uint64_t lotes() const { return lotes_.load(std::memory_order_relaxed); }
+
+ private:
+    std::mutex mutex_;
+    std::map<dev_t, int> sistemas_;  ///< Nunca encolhe: os descritores vivem ate o fim do processo.
+    std::size_t pendentes_ = 0;
+    std::chrono::steady_clock::time_point primeiro_pendente_;
+    std::size_t arquivos_por_lote_ = ARQUIVOS_POR_LOTE_PADRAO;
+    std::chrono::milliseconds janela_ = JANELA_LOTE_PADRAO;
+    std::atomic<std::uint64_t> lotes_{0};
+};
+
+LoteDurabilidade& lote_durabilidade() {
+    static LoteDurabilidade lote;
+    return lote;
+}
+
+/** @brief fsync do diretorio que contem 'caminho', para tornar duravel uma renomeacao nele. */
+void sincroniza_diretorio(const std::string& caminho) {
+    std::string diretorio = fs::path(caminho).parent_path().string();
+    if (diretorio.empty()) {
+        diretorio = ".";
+    }
+    Descritor fd(::open(diretorio.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (fd.get() < 0 || ::fsync(fd.get()) != 0) {
+        lanca_erro(diretorio, caminho, errno);
+    }
+}
+
+/**
+ * @brief Remove o temporario de uma copia que falhou, a menos que tenha sido publicado.
+ */
+class TemporarioCopia {
+ public:
+    explicit TemporarioCopia(std::string caminho) : caminho_(std::move(caminho)) {}
+    ~TemporarioCopia() {
+        if (!publicado_) {
+            std::remove(caminho_.c_str());
+        }
+    }
+    TemporarioCopia(const TemporarioCopia&) = delete;
+    TemporarioCopia& operator=(const TemporarioCopia&) = delete;
+
+    const std::string& caminho() const { return caminho_; }
+    void publica(const std::string& destino) {
+        publica_copia(caminho_, destino);
+        publicado_ = true;
+    }
+
+ private:
+    std::string caminho_;
+    bool publicado_ = false;
+};
+
+/**
+ * @brief Le ate encher o bloco (ou ate o fim do arquivo).
+ * @details Uma leitura curta no meio do arquivo desalinharia todas as escritas seguintes;
+ * completando o bloco, o destino recebe sempre blocos inteiros em deslocamentos alinhados.
+ * @return Bytes lidos; menos que 'tamanho' so no fim do arquivo.
+ */
+std::size_t le_bloco(int fd, char* buffer, std::size_t tamanho, const std::string& origem,
+                     const std::string& destino) {
+    std::size_t lidos = 0;
+    while (lidos < tamanho) {
+        ssize_t n = ::read(fd, buffer + lidos, tamanho - lidos);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            lanca_erro(origem, destino, errno);
+        }
+        if (n == 0) {
+            break;
+        }
+        lidos += static_cast<std::size_t>(n);
+    }
+    limita_leitura(lidos);
+    return lidos;
+}
+
+/**
+ * @brief Reserva no destino o espaco de [inicio, fim) de uma vez, sem alterar o tamanho.
+ * @details Com o espaco reservado antes das escritas, o sistema de arquivos entrega
+ * extents (ou clusters, no FAT/exFAT) contiguos em vez de ir estendendo o arquivo aos
+ * pedacos, e a restauracao depois le o arquivo em sequencia. FALLOC_FL_KEEP_SIZE deixa o
+ * tamanho por conta das escritas, de modo que uma copia interrompida nao parece completa.
+ * Sem suporte no sistema de arquivos a reserva e so dispensada.
+ * @return true se o espaco foi reservado (o excedente e liberado por ajusta_tamanho).
+ */
+bool prealoca(int fd, std::uintmax_t inicio, std::uintmax_t fim) {
+    if (fim <= inicio || fim < LIMIAR_PREALOCACAO) {
+        return false;
+    }
+    return ::fallocate(fd, FALLOC_FL_KEEP_SIZE, static_cast<off_t>(inicio), static_cast<off_t>(fim - inicio)) == 0;
+}
+
+/**
+ * @brief Fixa o tamanho exato do destino, liberando o que foi reservado alem dele.
+ * @details Necessario quando a origem encolheu durante a copia: o espaco pre-alocado
+ * alem do fim ficaria preso ao arquivo. Vem antes de futimens, que o ftruncate alteraria.
+ */
+void ajusta_tamanho(int fd, std::uintmax_t tamanho, const std::string& origem, const std::string& destino) {
+    if (::ftruncate(fd, static_cast<off_t>(tamanho)) != 0) {
+        lanca_erro(origem, destino, errno);
+    }
+}
+
+// Modo que preserva o cache de paginas do host (define_preserva_cache)
+std::atomic<bool> preserva_cache_atual{false};
+constexpr std::uintmax_t JANELA_FLUXO = 8 * TAMANHO_BLOCO;
+// A residencia da origem e anotada ate esta distancia a frente do cursor: mais que o
+// read-ahead do kernel (read_ahead_kb chega a 8 MiB, dobrado por POSIX_FADV_SEQUENTIAL)
+constexpr std::uintmax_t JANELA_RESIDENCIA = 64 * TAMANHO_BLOCO;
+
+/**
+ * @brief Copia que nao desloca o cache de paginas do host (define_preserva_cache).
+ * @details Na origem, anota quais paginas ja estavam em cache (mincore) ate
+ * JANELA_RESIDENCIA a frente do cursor, antes que o read-ahead do kernel chegue la; depois de lido cada
+ * bloco, descarta (POSIX_FADV_DONTNEED) so as paginas que a copia trouxe, preservando
+ * as que outros processos (ex: um banco de dados) mantinham. No destino, a gravacao de
+ * cada bloco e iniciada na hora (sync_file_range); quando o atraso passa de duas janelas,
+ * espera a gravacao da mais antiga e a descarta, de modo que o backup nunca acumula mais
+ * que duas janelas de paginas sujas. Inativo, nao faz nenhuma chamada. Os dois lados tem
+ * estado separado: na copia em pipeline, a thread leitora chama antes_de_ler e
+ * depois_de_ler e a gravadora, depois_de_gravar; finaliza so depois de a leitora terminar.
+ */
+class FluxoSemCache {
+ public:
+    FluxoSemCache(int entrada, int saida, std::uintmax_t tamanho_origem, std::uintmax_t inicio)
+        : entrada_(entrada), saida_(saida), ativo_(preserva_cache()), tamanho_origem_(tamanho_origem),
+          pagina_(static_cast<std::uintmax_t>(::sysconf(_SC_PAGESIZE))), liberado_(inicio) {}
+
+    void antes_de_ler(std::uintmax_t posicao, std::size_t tamanho) {
+        if (!ativo_ || posicao >= tamanho_origem_) {
+            return;
+        }
+        const std::uintmax_t pagina_atual = posicao - posicao % pagina_;
+        if (pagina_atual < base_ || pagina_atual > anotado_ate()) {
+            // Primeiro bloco, ou o cursor saltou um buraco maior que o anotado
+            descarta_origem(anotado_ate());
+            base_ = pagina_atual;
+            descartado_ = pagina_atual;
+            residentes_.clear();
+        } else if (pagina_atual - base_ >= JANELA_RESIDENCIA) {
+            descarta_origem(pagina_atual);
+            residentes_.erase(residentes_.begin(),
+                              residentes_.begin() + static_cast<std::ptrdiff_t>((pagina_atual - base_) / pagina_));
+            base_ = pagina_atual;
+        }
+        const std::uintmax_t alvo = std::min(tamanho_origem_, posicao + tamanho + JANELA_RESIDENCIA);
+        if (alvo > anotado_ate()) {
+            anota(anotado_ate(), alvo);
+        }
+    }
+
+    /** @brief Origem: descarta o bloco lido e os buracos pulados antes dele (o read-ahead pode te-los lido). */
+    void depois_de_ler(std::uintmax_t posicao, std::size_t tamanho) {
+        if (!ativo_ || tamanho == 0) {
+            return;
+        }
+        descarta_origem(std::min(tamanho_origem_, posicao + tamanho));
+    }
+
+    /** @brief Destino: inicia a gravacao do bloco e libera a janela mais antiga ja gravada. */
+    void depois_de_gravar(std::uintmax_t posicao, std::size_t tamanho) {
+        if (!ativo_ || tamanho == 0) {
+            return;
+        }
+        ::sync_file_range(saida_, static_cast<off_t>(posicao), static_cast<off_t>(tamanho), SYNC_FILE_RANGE_WRITE);
+        const std::uintmax_t fim = posicao + tamanho;
+        if (fim > liberado_ && fim - liberado_ >= 2 * JANELA_FLUXO) {
+            libera_destino(fim - JANELA_FLUXO);
+        }
+    }
+
+    /** @brief Fim da copia: espera a gravacao do restante do destino e o descarta do cache. */
+    void finaliza(std::uintmax_t total) {
+        if (!ativo_) {
+            return;
+        }
+        descarta_origem(anotado_ate());
+        if (total > liberado_) {
+            libera_destino(total);
+        }
+    }
+
+ private:
+    std::uintmax_t anotado_ate() const { return base_ + residentes_.size() * pagina_; }
+
+    bool residente(std::uintmax_t pagina) const {
+        if (pagina < base_ || pagina >= anotado_ate()) {
+            return false;
+        }
+        return residentes_[static_cast<std::size_t>((pagina - base_) / pagina_)] & 1;
+    }
+
+    /** @brief Descarta as sequencias de paginas de [descartado_, ate) que nao estavam em cache. */
+    void descarta_origem(std::uintmax_t ate) {
+        std::uintmax_t pagina = descartado_ - descartado_ % pagina_;
+        while (pagina < ate) {
+            if (residente(pagina)) {
+                pagina += pagina_;
+                continue;
+            }
+            std::uintmax_t fim = pagina;
+            while (fim < ate && !residente(fim)) {
+                fim += pagina_;
+            }
+            ::posix_fadvise(entrada_, static_cast<off_t>(pagina), static_cast<off_t>(fim - pagina),
+                            POSIX_FADV_DONTNEED);
+            pagina = fim;
+        }
+        descartado_ = std::max(descartado_, ate);
+    }
+
+    /** @brief Acrescenta a residencia das paginas de [de, ate); sem mincore, conta como ausentes. */
+    void anota(std::uintmax_t de, std::uintmax_t ate) {
+        const std::size_t extensao = static_cast<std::size_t>(ate - de);
+        const std::size_t antes = residentes_.size();
+        residentes_.resize(antes + static_cast<std::size_t>((extensao + pagina_ - 1) / pagina_), 0);
+        void* mapa = ::mmap(nullptr, extensao, PROT_READ, MAP_SHARED, entrada_, static_cast<off_t>(de));
+        if (mapa != MAP_FAILED) {
+            if (::mincore(mapa, extensao, residentes_.data() + antes) != 0) {
+                std::fill(residentes_.begin() + static_cast<std::ptrdiff_t>(antes), residentes_.end(), 0);
+            }
+            ::munmap(mapa, extensao);
+        }
+    }
+
+    void libera_destino(std::uintmax_t ate) {
+        const off_t inicio = static_cast<off_t>(liberado_);
+        const off_t extensao = static_cast<off_t>(ate - liberado_);
+        ::sync_file_range(saida_, inicio, extensao,
+                          SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+        ::posix_fadvise(saida_, inicio, extensao, POSIX_FADV_DONTNEED);
+        liberado_ = ate;
+    }
+
+    int entrada_;
+    int saida_;
+    bool ativo_;
+    std::uintmax_t tamanho_origem_;
+    std::uintmax_t pagina_;
+    std::vector<unsigned char> residentes_;  ///< mincore de [base_, anotado_ate()), uma entrada por pagina.
+    std::uintmax_t base_ = 0;
+    std::uintmax_t descartado_ = 0;  ///< Origem ja tratada ate aqui.
+    std::uintmax_t liberado_;        ///< Destino gravado e descartado ate aqui.
+};
+
+/**
+ * @brief Percorre a origem pelos trechos de dados (SEEK_DATA/SEEK_HOLE), pulando os buracos.
+ * @details So e usado em arquivos esparsos (menos blocos alocados que o tamanho); nos
+ * demais, proximo devolve sempre um bloco inteiro sem nenhuma chamada extra. Um buraco
+ * nao e lido nem escrito: o chamador posiciona o destino adiante (lseek), o que recria o
+ * buraco, e conta zeros no checksum, que continua sendo o do conteudo logico.
+ */
+class CursorDados {
+ public:
+    CursorDados(int fd, std::uintmax_t tamanho, bool esparso) : fd_(fd), tamanho_(tamanho), esparso_(esparso) {}
+
+    /**
+     * @brief Quanto ler a partir de 'posicao', depois de pular 'buraco' bytes.
+     * @details Deixa o descritor de leitura posicionado em posicao + buraco.
+     * @return Bytes a ler (ate TAMANHO_BLOCO); 0 se so resta buraco ate o fim.
+     */
+    std::size_t proximo(std::uintmax_t posicao, std::uintmax_t& buraco, const std::string& origem) {
+        buraco = 0;
+        if (!esparso_) {
+            return TAMANHO_BLOCO;
+        }
+        if (posicao >= fim_dados_) {
+            off_t dados = ::lseek(fd_, static_cast<off_t>(posicao), SEEK_DATA);
+            if (dados < 0) {
+                if (errno != ENXIO) {
+                    lanca_erro(origem, origem, errno);
+                }
+                // So buraco ate o fim
+                buraco = tamanho_ > posicao ? tamanho_ - posicao : 0;
+                return 0;
+            }
+            off_t fim = ::lseek(fd_, dados, SEEK_HOLE);
+            if (fim < 0 || ::lseek(fd_, dados, SEEK_SET) < 0) {
+                lanca_erro(origem, origem, errno);
+            }
+            buraco = static_cast<std::uintmax_t>(dados) - posicao;
+            fim_dados_ = static_cast<std::uintmax_t>(fim);
+        }
+        return static_cast<std::size_t>(std::min<std::uintmax_t>(TAMANHO_BLOCO, fim_dados_ - (posicao + buraco)));
+    }
+
+ private:
+    int fd_;
+    std::uintmax_t tamanho_;
+    bool esparso_;
+    std::uintmax_t fim_dados_ = 0;
+};
+
+bool eh_esparso(const struct stat& st) {
+    return static_cast<std::uintmax_t>(st.st_blocks) * 512 < static_cast<std::uintmax_t>(st.st_size);
+}
+
+/** @brief Posiciona o destino adiante, deixando um buraco no lugar do que nao foi escrito. */
+void pula_buraco(int fd, std::uintmax_t posicao, const std::string& origem, const std::string& destino) {
+    if (::lseek(fd, static_cast<off_t>(posicao), SEEK_SET) < 0) {
+        lanca_erro(origem, destino, errno);
+    }
+}
+
+// Copia em pipeline (define_pipeline)
+std::atomic<int> pipeline_atual{PIPELINE_AUTOMATICO};
+std::atomic<std::uint64_t> total_copias_em_pipeline{0};
+std::atomic<std::uint64_t> total_leitoras_criadas{0};
+// Arquivos menores sao lidos e gravados alternadamente: a thread nao se paga
+constexpr std::uintmax_t LIMIAR_PIPELINE = 8 * TAMANHO_BLOCO;
+// Blocos do anel entre a thread leitora e a gravadora
+constexpr std::size_t BLOCOS_PIPELINE = 4;
+
+/** @brief Decide se a copia usa a thread leitora (ver define_pipeline). */
+bool usa_pipeline(const struct stat& st_origem, int saida) {
+    if (static_cast<std::uintmax_t>(st_origem.st_size) < LIMIAR_PIPELINE) {
+        return false;
+    }
+    switch (static_cast<ModoPipeline>(pipeline_atual.load(std::memory_order_relaxed))) {
+        case PIPELINE_SEMPRE:
+            return true;
+        case PIPELINE_AUTOMATICO: {
+            struct stat st_destino;
+            return ::fstat(saida, &st_destino) == 0 && st_destino.st_dev != st_origem.st_dev;
+        }
+        case PIPELINE_NUNCA:
+            break;
+    }
+    return false;
+}
+
+/**
+ * @brief Thread leitora reaproveitada pelas copias em pipeline de uma mesma thread de copia.
+ * @details Criada na primeira copia em pipeline e encerrada junto com a thread dona
+ * (thread_local). Uma thread nova por arquivo grande custaria a criacao a cada arquivo e,
+ * com --trace, um anel de eventos novo por arquivo.
+ */
+class LeitoraPersistente {
+ public:
+    LeitoraPersistente() = default;
+    ~LeitoraPersistente() {
+        if (thread_.joinable()) {
+            {
+                std::lock_guard<std::mutex> trava(mutex_);
+                encerrar_ = true;
+            }
+            mudou_.notify_all();
+            thread_.join();
+        }
+    }
+    LeitoraPersistente(const LeitoraPersistente&) = delete;
+    LeitoraPersistente& operator=(const LeitoraPersistente&) = delete;
+
+    /** @brief Entrega uma tarefa a leitora (que deve estar livre: ver aguarda). */
+    void executa(void (*tarefa)(void*), void* contexto) {
+        {
+            std::lock_guard<std::mutex> trava(mutex_);
+            if (!thread_.joinable()) {
+                thread_ = std::thread(&LeitoraPersistente::laco, this);
+                total_leitoras_criadas.fetch_add(1, std::memory_order_relaxed);
+            }
+            tarefa_ = tarefa;
+            contexto_ = contexto;
+            ocupada_ = true;
+        }
+        mudou_.notify_all();
+    }
+
+    /** @brief Espera a tarefa terminar; depois disso a leitora nao toca mais no contexto. */
+    void aguarda() {
+        std::unique_lock<std::mutex> trava(mutex_);
+        mudou_.wait(trava, [this] { return !ocupada_; });
+    }
+
+ private:
+    void laco() {
+        std::unique_lock<std::mutex> trava(mutex_);
+        for (;;) {
+            mudou_.wait(trava, [this] { return encerrar_ || tarefa_ != nullptr; });
+            if (tarefa_ == nullptr) {
+                return;
+            }
+            void (*tarefa)(void*) = tarefa_;
+            tarefa_ = nullptr;
+            trava.unlock();
+            tarefa(contexto_);
+            trava.lock();
+            ocupada_ = false;
+            mudou_.notify_all();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable mudou_;
+    void (*tarefa_)(void*) = nullptr;
+    void* contexto_ = nullptr;
+    bool ocupada_ = false;
+    bool encerrar_ = false;
+    std::thread thread_;
+};
+
+LeitoraPersistente& leitora_da_thread() {
+    thread_local LeitoraPersistente leitora;
+    return leitora;
+}
+
+/**
+ * @brief Proximo trecho da origem: 'buraco' bytes a recriar e depois 'tamanho' bytes lidos.
+ */
+struct BlocoLido {
+    std::uintmax_t buraco = 0;
+    std::size_t tamanho = 0;  ///< 0 no fim da origem.
+    const char* dados = nullptr;
+};
+
+/**
+ * @brief Lado da leitura da copia: entrega a origem em blocos, pulando os buracos.
+ * @details Sem pipeline, cada bloco e lido na hora, no buffer unico, e o laco de copia alterna
+ * leitura e escrita. Em pipeline, a leitora da thread (LeitoraPersistente) enche um anel de BLOCOS_PIPELINE buffers
+ * enquanto a thread da copia grava os anteriores: com origem e destino em dispositivos
+ * diferentes (ex: HD -> pen-drive) os dois trabalham ao mesmo tempo e a copia tende ao mais
+ * lento dos dois, em vez da soma dos tempos. Um erro de leitura e relancado por proximo, na
+ * ordem em que ocorreu.
+ */
+class LeitorBlocos {
+ public:
+    LeitorBlocos(int entrada, std::uintmax_t tamanho_origem, std::uintmax_t inicio, bool esparso, bool pipeline,
+                 FluxoSemCache& fluxo, const std::string& origem, const std::string& destino)
+        : entrada_(entrada), dados_(entrada, tamanho_origem, esparso), fluxo_(fluxo), origem_(origem),
+          destino_(destino), posicao_(inicio) {
+        if (!pipeline) {
+            buffers_[0] = pool_blocos().empresta();
+            return;
+        }
+        for (auto& buffer : buffers_) {
+            buffer = pool_blocos().empresta();
+        }
+        leitora_ = &leitora_da_thread();
+        leitora_->executa([](void* leitor) { static_cast<LeitorBlocos*>(leitor)->laco_leitor(); }, this);
+        total_copias_em_pipeline.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    ~LeitorBlocos() {
+        if (leitora_ != nullptr) {
+            {
+                std::lock_guard<std::mutex> trava(mutex_);
+                parar_ = true;
+            }
+            espaco_.notify_one();
+            leitora_->aguarda();
+        }
+    }
+    LeitorBlocos(const LeitorBlocos&) = delete;
+    LeitorBlocos& operator=(const LeitorBlocos&) = delete;
+
+    /**
+     * @brief Libera o bloco entregue antes e devolve o seguinte.
+     * @throw std::filesystem::filesystem_error se a leitura falhou.
+     */
+    BlocoLido proximo() {
+        if (leitora_ == nullptr) {
+            return le(buffers_[0].get());
+        }
+        std::unique_lock<std::mutex> trava(mutex_);
+        if (consumidos_ > liberados_) {
+            ++liberados_;
+            espaco_.notify_one();
+        }
+        pronto_.wait(trava, [this] { return produzidos_ > consumidos_ || erro_; });
+        if (produzidos_ == consumidos_) {
+            std::rethrow_exception(erro_);
+        }
+        const BlocoLido bloco = anel_[consumidos_++ % BLOCOS_PIPELINE];
+        if (bloco.tamanho == 0) {
+            // A leitora ja terminou: depois disto o FluxoSemCache volta a ser so da thread da copia
+            trava.unlock();
+            leitora_->aguarda();
+            leitora_ = nullptr;
+        }
+        return bloco;
+    }
+
+ private:
+    BlocoLido le(char* buffer) {
+        BlocoLido bloco;
+        const std::size_t limite = dados_.proximo(posicao_, bloco.buraco, origem_);
+        posicao_ += bloco.buraco;
+        fluxo_.antes_de_ler(posicao_, limite);
+        bloco.tamanho = limite > 0 ? le_bloco(entrada_, buffer, limite, origem_, destino_) : 0;
+        bloco.dados = buffer;
+        fluxo_.depois_de_ler(posicao_, bloco.tamanho);
+        posicao_ += bloco.tamanho;
+        return bloco;
+    }
+
+    void laco_leitor() {
+        for (std::size_t i = 0;; ++i) {
+            {
+                std::unique_lock<std::mutex> trava(mutex_);
+                espaco_.wait(trava, [this, i] { return parar_ || i - liberados_ < BLOCOS_PIPELINE; });
+                if (parar_) {
+                    return;
+                }
+            }
+            BlocoLido bloco;
+            try {
+                bloco = le(buffers_[i % BLOCOS_PIPELINE].get());
+            } catch (...) {
+                std::lock_guard<std::mutex> trava(mutex_);
+                erro_ = std::current_exception();
+                pronto_.notify_one();
+                return;
+            }
+            {
+                std::lock_guard<std::mutex> trava(mutex_);
+                anel_[i % BLOCOS_PIPELINE] = bloco;
+                ++produzidos_;
+            }
+            pronto_.notify_one();
+            if (bloco.tamanho == 0) {
+                return;
+            }
+        }
+    }
+
+    int entrada_;
+    CursorDados dados_;
+    FluxoSemCache& fluxo_;
+    const std::string& origem_;
+    const std::string& destino_;
+    std::uintmax_t posicao_;  ///< So a thread leitora (ou a da copia, sem pipeline) mexe aqui.
+    std::array<PoolBuffers::Emprestimo, BLOCOS_PIPELINE> buffers_;  ///< So o primeiro sem pipeline.
+
+    // Anel do pipeline: bloco i vai no buffer i % BLOCOS_PIPELINE
+    std::array<BlocoLido, BLOCOS_PIPELINE> anel_;
+    std::mutex mutex_;
+    std::condition_variable espaco_;  ///< A leitora espera um buffer liberado.
+    std::condition_variable pronto_;  ///< A copia espera um bloco lido.
+    std::size_t produzidos_ = 0;
+    std::size_t consumidos_ = 0;
+    std::size_t liberados_ = 0;
+    bool parar_ = false;
+    std::exception_ptr erro_;
+    LeitoraPersistente* leitora_ = nullptr;  ///< nullptr sem pipeline ou depois do ultimo bloco.
+};
+
+// Copia retomavel (arquivos grandes)
+const char* const SUFIXO_RETOMADA = ".retomada";
+const char* const CABECALHO_RETOMADA = "SYSBACKUP-RETOMADA 1";
+
+std::atomic<std::uintmax_t> intervalo_checkpoint_atual{INTERVALO_CHECKPOINT_PADRAO};
+
+/**
+ * @brief Conteudo do diario de retomada: ate onde o arquivo temporario esta confirmado.
+ */
+struct Checkpoint {
+    std::uintmax_t tamanho_origem = 0;
+    std::int64_t data_origem = 0;       ///< ns desde a epoca; origem alterada invalida o diario.
+    std::uintmax_t confirmados = 0;     ///< Bytes gravados e confirmados com fdatasync.
+    std::uintmax_t inicio_trecho = 0;   ///< Inicio do ultimo trecho confirmado.
+    std::uint64_t checksum_trecho = 0;  ///< XXH64 de [inicio_trecho, confirmados).
+    std::string estado_hash;            ///< HashXXH64::exporta_estado de [0, confirmados).
+};
+
+bool le_checkpoint(const std::string& caminho, Checkpoint& cp) {
+    std::ifstream entrada(caminho);
+    std::string linha;
+    if (!std::getline(entrada, linha) || linha != CABECALHO_RETOMADA || !std::getline(entrada, linha)) {
+        return false;
+    }
+    std::istringstream campos(linha);
+    std::string hex_trecho;
+    return static_cast<bool>(campos >> cp.tamanho_origem >> cp.data_origem >> cp.confirmados >> cp.inicio_trecho >>
+                             hex_trecho >> cp.estado_hash) &&
+           hex_para_checksum(hex_trecho, cp.checksum_trecho) && cp.inicio_trecho <= cp.confirmados;
+}
+
+/**
+ * @brief Grava o diario em um temporario e renomeia. Sem fsync: um diario perdido ou
+ * antigo so faz a retomada partir de um checkpoint anterior (ou do zero).
+ */
+void grava_checkpoint(const std::string& caminho, const Checkpoint& cp) {
+    const std::string temporario = caminho + ".tmp";
+    {
+        std::ofstream saida(temporario, std::ios::trunc);
+        saida << CABECALHO_RETOMADA << "\n"
+              << cp.tamanho_origem << " " << cp.data_origem << " " << cp.confirmados << " " << cp.inicio_trecho
+              << " " << checksum_para_hex(cp.checksum_trecho) << " " << cp.estado_hash << "\n";
+        if (!saida) {
+            lanca_erro(caminho, temporario, EIO);
+        }
+    }
+    if (std::rename(temporario.c_str(), caminho.c_str()) != 0) {
+        lanca_erro(temporario, caminho, errno);
+    }
+}
+
+/** @brief Confere o ultimo trecho confirmado do temporario contra o checksum do diario. */
+bool confere_trecho(int fd, const Checkpoint& cp, char* buffer, std::size_t tamanho_buffer) {
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || static_cast<std::uintmax_t>(st.st_size) < cp.confirmados) {
+        return false;
+    }
+    HashXXH64 hash;
+    for (std::uintmax_t posicao = cp.inicio_trecho; posicao < cp.confirmados;) {
+        std::size_t parte = static_cast<std::size_t>(std::min<std::uintmax_t>(tamanho_buffer, cp.confirmados - posicao));
+        ssize_t lidos = ::pread(fd, buffer, parte, static_cast<off_t>(posicao));
+        if (lidos < 0 && errno == EINTR) {
+            continue;
+        }
+        if (lidos <= 0) {
+            return false;
+        }
+        hash.atualiza(buffer, static_cast<std::size_t>(lidos));
+        posicao += static_cast<std::uintmax_t>(lidos);
+    }
+    return hash.finaliza() == cp.checksum_trecho;
+}
+
+void escreve_tudo(int fd, const char* dados, std::size_t tamanho, const std::string& origem,
+                  const std::string& destino) {
+    while (tamanho > 0) {
+        ssize_t n = ::write(fd, dados, tamanho);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            lanca_erro(origem, destino, errno);
+        }
+        limita_escrita(static_cast<std::size_t>(n));
+        dados += n;
+        tamanho -= static_cast<std::size_t>(n);
+    }
+}
+
+/**
+ * @brief Copia para "<destino>.copiando" com checkpoints e renomeia ao final.
+ * @details Retoma do ultimo checkpoint quando o diario corresponde a mesma origem
+ * (tamanho e data) e o ultimo trecho confirmado confere; caso contrario recomeca do zero.
+ */
+void copia_retomavel(int entrada, const struct stat& st_origem, const std::string& origem,
+                     const std::string& destino, std::uintmax_t intervalo, InfoCopia& info) {
+    const std::string temporario = destino + SUFIXO_COPIANDO;
+    const std::string diario = destino + SUFIXO_RETOMADA;
+
+    Descritor saida(::open(temporario.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, st_origem.st_mode & 07777));
+    if (saida.get() < 0) {
+        lanca_erro(origem, temporario, errno);
+    }
+
+    Checkpoint cp;
+    cp.tamanho_origem = static_cast<std::uintmax_t>(st_origem.st_size);
+    cp.data_origem = static_cast<std::int64_t>(st_origem.st_mtim.tv_sec) * 1000000000 + st_origem.st_mtim.tv_nsec;
+
+    HashXXH64 hash;
+    std::uintmax_t inicio = 0;
+    Checkpoint anterior;
+    if (le_checkpoint(diario, anterior) && anterior.tamanho_origem == cp.tamanho_origem &&
+        anterior.data_origem == cp.data_origem && anterior.confirmados <= cp.tamanho_origem &&
+        confere_trecho(saida.get(), anterior, pool_blocos().empresta().get(), TAMANHO_BLOCO) &&
+        hash.importa_estado(anterior.estado_hash)) {
+        inicio = anterior.confirmados;
+    }
+
+    // Descarta o que passou do ultimo checkpoint (pode estar incompleto) e posiciona os dois lados
+    if (::ftruncate(saida.get(), static_cast<off_t>(inicio)) != 0 ||
+        ::lseek(saida.get(), static_cast<off_t>(inicio), SEEK_SET) < 0 ||
+        ::lseek(entrada, static_cast<off_t>(inicio), SEEK_SET) < 0) {
+        lanca_erro(origem, temporario, errno);
+    }
+    const bool esparso = eh_esparso(st_origem);
+    if (!esparso) {
+        prealoca(saida.get(), inicio, cp.tamanho_origem);
+    }
+
+    std::uintmax_t total = inicio;
+    std::uintmax_t ultimo_checkpoint = inicio;
+    std::uintmax_t buracos = 0;
+    HashXXH64 trecho;
+    FluxoSemCache fluxo(entrada, saida.get(), cp.tamanho_origem, inicio);
+    LeitorBlocos leitor(entrada, cp.tamanho_origem, inicio, esparso, usa_pipeline(st_origem, saida.get()), fluxo,
+                        origem, temporario);
+    for (;;) {
+        const BlocoLido bloco = leitor.proximo();
+        if (bloco.buraco > 0) {
+            hash.atualiza_zeros(bloco.buraco);
+            trecho.atualiza_zeros(bloco.buraco);
+            total += bloco.buraco;
+            buracos += bloco.buraco;
+            pula_buraco(saida.get(), total, origem, temporario);
+        }
+        if (bloco.tamanho == 0) {
+            break;
+        }
+        hash.atualiza(bloco.dados, bloco.tamanho);
+        trecho.atualiza(bloco.dados, bloco.tamanho);
+        escreve_tudo(saida.get(), bloco.dados, bloco.tamanho, origem, temporario);
+        fluxo.depois_de_gravar(total, bloco.tamanho);
+        total += bloco.tamanho;
+
+        // Checkpoint: os dados precisam estar no dispositivo antes de o diario apontar para eles
+        if (total - ultimo_checkpoint >= intervalo) {
+            if (::fdatasync(saida.get()) != 0) {
+                lanca_erro(origem, temporario, errno);
+            }
+            cp.confirmados = total;
+            cp.inicio_trecho = ultimo_checkpoint;
+            cp.checksum_trecho = trecho.finaliza();
+            cp.estado_hash = hash.exporta_estado();
+            grava_checkpoint(diario, cp);
+            ultimo_checkpoint = total;
+            trecho = HashXXH64();
+        }
+    }
+
+    fluxo.finaliza(total);
+    ajusta_tamanho(saida.get(), total, origem, temporario);
+    struct timespec tempos[2] = {st_origem.st_atim, st_origem.st_mtim};
+    if (::futimens(saida.get(), tempos) != 0) {
+        lanca_erro(origem, temporario, errno);
+    }
+    prepara_publicacao(saida.get(), temporario);
+    int erro = saida.fecha();
+    if (erro != 0) {
+        lanca_erro(origem, temporario, erro);
+    }
+    publica_copia(temporario, destino);
+    std::remove(diario.c_str());
+
+    info.checksum = hash.finaliza();
+    info.bytes = total;
+    info.retomados = inicio;
+    info.buracos = buracos;
+    CONTA_BYTES(total - inicio - buracos);
+}
+
+}  // namespace
+
+void define_intervalo_checkpoint(std::uintmax_t bytes) {
+    intervalo_checkpoint_atual.store(bytes, std::memory_order_relaxed);
+}
+
+std::uintmax_t intervalo_checkpoint() {
+    return intervalo_checkpoint_atual.load(std::memory_order_relaxed);
+}
+
+void define_preserva_cache(bool ativo) {
+    preserva_cache_atual.store(ativo, std::memory_order_relaxed);
+}
+
+bool preserva_cache() {
+    return preserva_cache_atual.load(std::memory_order_relaxed);
+}
+
+void define_pipeline(ModoPipeline modo) {
+    pipeline_atual.store(modo, std::memory_order_relaxed);
+}
+
+ModoPipeline pipeline() {
+    return static_cast<ModoPipeline>(pipeline_atual.load(std::memory_order_relaxed));
+}
+
+const char* nome_pipeline(ModoPipeline modo) {
+    switch (modo) {
+        case PIPELINE_NUNCA:
+            return "nunca";
+        case PIPELINE_AUTOMATICO:
+            return "auto";
+        case PIPELINE_SEMPRE:
+            return "sempre";
+    }
+    return "?";
+}
+
+bool interpreta_pipeline(const std::string& texto, ModoPipeline& modo) {
+    for (ModoPipeline candidato : {PIPELINE_NUNCA, PIPELINE_AUTOMATICO, PIPELINE_SEMPRE}) {
+        if (texto == nome_pipeline(candidato)) {
+            modo = candidato;
+            return true;
+        }
+    }
+    return false;
+}
+
+std::uint64_t copias_em_pipeline() {
+    return total_copias_em_pipeline.load(std::memory_order_relaxed);
+}
+
+std::uint64_t leitoras_criadas() {
+    return total_leitoras_criadas.load(std::memory_order_relaxed);
+}
+
+std::uintmax_t bytes_em_cache(const std::string& caminho) {
+    Descritor fd(::open(caminho.c_str(), O_RDONLY | O_CLOEXEC));
+    struct stat st;
+    if (fd.get() < 0 || ::fstat(fd.get(), &st) != 0 || st.st_size == 0) {
+        return 0;
+    }
+    const std::size_t tamanho = static_cast<std::size_t>(st.st_size);
+    void* mapa = ::mmap(nullptr, tamanho, PROT_READ, MAP_SHARED, fd.get(), 0);
+    if (mapa == MAP_FAILED) {
+        return 0;
+    }
+    const std::size_t pagina = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    std::vector<unsigned char> residentes((tamanho + pagina - 1) / pagina);
+    std::uintmax_t bytes = 0;
+    if (::mincore(mapa, tamanho, residentes.data()) == 0) {
+        for (std::size_t i = 0; i < residentes.size(); ++i) {
+            if (residentes[i] & 1) {
+                bytes += std::min(pagina, tamanho - i * pagina);
+            }
+        }
+    }
+    ::munmap(mapa, tamanho);
+    return bytes;
+}
+
+void define_durabilidade(ModoDurabilidade modo, std::size_t arquivos_por_lote, std::chrono::milliseconds janela) {
+    // Copias pendentes do modo anterior nao ficam sem confirmacao
+    confirma_copias();
+    lote_durabilidade().configura(arquivos_por_lote, janela);
+    modo_durabilidade.store(modo, std::memory_order_relaxed);
+}
+
+ModoDurabilidade durabilidade() {
+    return static_cast<ModoDurabilidade>(modo_durabilidade.load(std::memory_order_relaxed));
+}
+
+const char* nome_durabilidade(ModoDurabilidade modo) {
+    switch (modo) {
+        case DURABILIDADE_NENHUMA:
+            return "nenhuma";
+        case DURABILIDADE_ARQUIVO:
+            return "arquivo";
+        case DURABILIDADE_LOTE:
+            return "lote";
+    }
+    return "?";
+}
+
+bool interpreta_durabilidade(const std::string& texto, ModoDurabilidade& modo) {
+    for (ModoDurabilidade candidato : {DURABILIDADE_NENHUMA, DURABILIDADE_ARQUIVO, DURABILIDADE_LOTE}) {
+        if (texto == nome_durabilidade(candidato)) {
+            modo = candidato;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool confirma_copias() {
+    return lote_durabilidade().confirma();
+}
+
+bool confirma_diretorio_publicado(const std::string& diretorio) {
+    if (durabilidade() == DURABILIDADE_NENHUMA) {
+        return true;
+    }
+    MEDE_FASE(FASE_SINCRONIA);
+    Descritor fd(::open(diretorio.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC));
+    if (fd.get() < 0 || ::syncfs(fd.get()) != 0) {
+        std::cerr << "Erro ao confirmar " << diretorio << " (syncfs): " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::uint64_t lotes_confirmados() {
+    return lote_durabilidade().lotes();
+}
+
+void prepara_publicacao(int fd, const std::string& temporario) {
+    switch (durabilidade()) {
+        case DURABILIDADE_ARQUIVO: {
+            MEDE_FASE(FASE_SINCRONIA);
+            if (::fdatasync(fd) != 0) {
+                lanca_erro(temporario, temporario, errno);
+            }
+            break;
+        }
+        case DURABILIDADE_LOTE:
+            lote_durabilidade().inscreve(fd, temporario);
+            break;
+        case DURABILIDADE_NENHUMA:
+            break;
+    }
+}
+
+void prepara_publicacao(const std::string& temporario) {
+    if (durabilidade() == DURABILIDADE_NENHUMA) {
+        return;
+    }
+    Descritor fd(::open(temporario.c_str(), O_RDONLY | O_CLOEXEC));
+    if (fd.get() < 0) {
+        lanca_erro(temporario, temporario, errno);
+    }
+    prepara_publicacao(fd.get(), temporario);
+}
+
+void publica_copia(const std::string& temporario, const std::string& destino) {
+    limita_metadados();
+    if (std::rename(temporario.c_str(), destino.c_str()) != 0) {
+        lanca_erro(temporario, destino, errno);
+    }
+    switch (durabilidade()) {
+        case DURABILIDADE_ARQUIVO: {
+            MEDE_FASE(FASE_SINCRONIA);
+            sincroniza_diretorio(destino);
+            break;
+        }
+        case DURABILIDADE_LOTE:
+            lote_durabilidade().conta();
+            break;
+        case DURABILIDADE_NENHUMA:
+            break;
+    }
+}
+
+bool vincula_copia(const std::string& existente, const std::string& destino) {
+    const std::string temporario = destino + SUFIXO_VINCULANDO;
+    limita_metadados(2);  // unlink e link
+    ::unlink(temporario.c_str());  // Sobra de uma execucao interrompida
+    if (::link(existente.c_str(), temporario.c_str()) != 0) {
+        if (errno == EPERM || errno == EOPNOTSUPP || errno == EXDEV || errno == EMLINK || errno == ENOENT) {
+            return false;
+        }
+        lanca_erro(existente, temporario, errno);
+    }
+    try {
+        publica_copia(temporario, destino);
+    } catch (const fs::filesystem_error&) {
+        ::unlink(temporario.c_str());
+        throw;
+    }
+    return true;
+}
+
+void copia_arquivo(const std::string& origem, const std::string& destino, InfoCopia& info) {
+    // Assertiva de entrada
+    assert(!origem.empty() && "A string de origem nao pode ser vazia.");
+    assert(!destino.empty() && "A string de destino nao pode ser vazia.");
+    MEDE_FASE_DE(FASE_COPIA, origem.c_str());
+
+    limita_metadados(2);  // Abertura da origem e do temporario
+    Descritor entrada(::open(origem.c_str(), O_RDONLY | O_CLOEXEC));
+    if (entrada.get() < 0) {
+        lanca_erro(origem, destino, errno);
+    }
+
+    struct stat st_origem;
+    if (::fstat(entrada.get(), &st_origem) != 0) {
+        lanca_erro(origem, destino, errno);
+    }
+
+    // Arquivos grandes: copia retomavel, com checkpoints
+    const std::uintmax_t intervalo = intervalo_checkpoint();
+    if (intervalo > 0 && static_cast<std::uintmax_t>(st_origem.st_size) >= intervalo) {
+        ::posix_fadvise(entrada.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+        copia_retomavel(entrada.get(), st_origem, origem, destino, intervalo, info);
+        return;
+    }
+
+    // O destino so e substituido, por renomeacao, depois de a copia estar completa
+    TemporarioCopia temporario(destino + SUFIXO_COPIANDO);
+    Descritor saida(::open(temporario.caminho().c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                           st_origem.st_mode & 07777));
+    if (saida.get() < 0) {
+        lanca_erro(origem, temporario.caminho(), errno);
+    }
+
+    // Leitura sequencial: pede ao kernel um read-ahead mais agressivo
+    ::posix_fadvise(entrada.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+    // Origem esparsa: so os trechos de dados sao copiados (e nada e pre-alocado)
+    const bool esparso = eh_esparso(st_origem);
+    const bool prealocado = !esparso && prealoca(saida.get(), 0, static_cast<std::uintmax_t>(st_origem.st_size));
+
+    HashXXH64 hash;
+    std::uintmax_t total = 0;
+    std::uintmax_t buracos = 0;
+    FluxoSemCache fluxo(entrada.get(), saida.get(), static_cast<std::uintmax_t>(st_origem.st_size), 0);
+    LeitorBlocos leitor(entrada.get(), static_cast<std::uintmax_t>(st_origem.st_size), 0, esparso,
+                        usa_pipeline(st_origem, saida.get()), fluxo, origem, temporario.caminho());
+
+    for (;;) {
+        const BlocoLido bloco = leitor.proximo();
+        if (bloco.buraco > 0) {
+            hash.atualiza_zeros(bloco.buraco);
+            total += bloco.buraco;
+            buracos += bloco.buraco;
+            pula_buraco(saida.get(), total, origem, temporario.caminho());
+        }
+        if (bloco.tamanho == 0) {
+            break;
+        }
+        hash.atualiza(bloco.dados, bloco.tamanho);
+        escreve_tudo(saida.get(), bloco.dados, bloco.tamanho, origem, temporario.caminho());
+        fluxo.depois_de_gravar(total, bloco.tamanho);
+        total += bloco.tamanho;
+    }
+    fluxo.finaliza(total);
+    // Buraco no fim: o tamanho vem do ftruncate, pois nada foi escrito ali
+    if (prealocado || buracos > 0) {
+        ajusta_tamanho(saida.get(), total, origem, temporario.caminho());
+    }
+
+    // Preserva a data de modificacao da origem no destino
+    struct timespec tempos[2] = {st_origem.st_atim, st_origem.st_mtim};
+    if (::futimens(saida.get(), tempos) != 0) {
+        lanca_erro(origem, temporario.caminho(), errno);
+    }
+    prepara_publicacao(saida.get(), temporario.caminho());
+
+    // Erros de escrita adiados (ex.: pen-drive cheio) aparecem no close
+    int erro = saida.fecha();
+    if (erro != 0) {
+        lanca_erro(origem, temporario.caminho(), erro);
+    }
+    temporario.publica(destino);
+
+    info.checksum = hash.finaliza();
+    info.bytes = total;
+    info.buracos = buracos;
+    CONTA_BYTES(total - buracos);
+}
+
+void copia_entre(Armazenamento& arm_origem, const std::string& origem,
+                 Armazenamento& arm_destino, const std::string& destino, InfoCopia& info) {
+    if (&arm_origem == &armazenamento_posix() && &arm_destino == &armazenamento_posix()) {
+        copia_arquivo(origem, destino, info);
+        return;
+    }
+
+    // Assertiva de entrada
+    assert(!origem.empty() && "A string de origem nao pode ser vazia.");
+    assert(!destino.empty() && "A string de destino nao pode ser vazia.");
+    MEDE_FASE_DE(FASE_COPIA, origem.c_str());
+
+    // No disco local a copia passa por um temporario; nos demais (ex: S3) a escrita ja e atomica
+    const bool local = &arm_destino == &armazenamento_posix();
+    std::unique_ptr<TemporarioCopia> temporario;
+    if (local) {
+        temporario = std::make_unique<TemporarioCopia>(destino + SUFIXO_COPIANDO);
+    }
+    const std::string& gravado = local ? temporario->caminho() : destino;
+
+    fs::file_time_type data = arm_origem.data_modificacao(origem);
+    std::unique_ptr<LeitorArquivo> entrada = arm_origem.abre_leitura(origem);
+    std::unique_ptr<EscritorArquivo> saida = arm_destino.abre_escrita(gravado);
+    const bool data_registrada = saida->define_data(data);  // Ex: metadado do objeto remoto
+
+    PoolBuffers::Emprestimo bloco = pool_blocos().empresta();
+    char* buffer = bloco.get();
+    HashXXH64 hash;
+    std::uintmax_t total = 0;
+    for (std::size_t lidos; (lidos = entrada->le(buffer, TAMANHO_BLOCO)) > 0;) {
+        hash.atualiza(buffer, lidos);
+        saida->escreve(buffer, lidos);
+        total += lidos;
+    }
+    saida->fecha();
+    if (!data_registrada) {
+        arm_destino.define_data(gravado, data);
+    }
+    if (local) {
+        prepara_publicacao(gravado);
+        temporario->publica(destino);
+    }
+
+    info.checksum = hash.finaliza();
+    info.bytes = total;
+    CONTA_BYTES(total);
+}
@@ -0,0 +1,195 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef COPIA_HPP
+#define COPIA_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+class Armazenamento;
+
+/**
+ * @brief Informacoes produzidas pelo motor de copia para cada arquivo copiado.
+ */
+struct InfoCopia {
+    std::uint64_t checksum = 0;  ///< XXH64 do conteudo, calculado durante a copia.
+    std::uintmax_t bytes = 0;    ///< Quantidade de bytes escritos no destino.
+    std::uintmax_t retomados = 0;  ///< Bytes aproveitados de uma copia interrompida (nao relidos da origem).
+    std::uintmax_t buracos = 0;    ///< Bytes de buracos da origem esparsa, recriados no destino sem leitura nem escrita.
+};
+
+/**
+ * @brief Copia um arquivo em fluxo, calculando o checksum dos dados enquanto passam.
+ * @details Substitui fs::copy: o conteudo e lido uma unica vez da origem, o hash e
+ * atualizado bloco a bloco e o destino recebe as permissoes e a data de modificacao
+ * da origem (assim uma nova execucao reconhece o arquivo como inalterado). Arquivos
+ * grandes usam a copia retomavel (ver define_intervalo_checkpoint). O conteudo e
+ * gravado em "<destino>.copiando" e renomeado por cima do destino so depois de completo:
+ * uma falha no meio da copia deixa o destino anterior intacto, nunca truncado. A
+ * durabilidade segue define_durabilidade. Numa origem esparsa (ex: imagem de disco de
+ * VM), so os trechos de dados sao lidos e gravados (SEEK_DATA/SEEK_HOLE) e os buracos
+ * sao recriados no destino; o checksum continua sendo o do conteudo completo.
+ * @param origem Caminho do arquivo a ser copiado.
+ * @param destino Caminho do arquivo a ser criado ou sobrescrito.
+ * @param info Recebe o checksum e o tamanho copiado.
+ * @throw std::filesystem::filesystem_error em caso de falha de E/S.
+ * @pre origem e destino nao devem ser strings vazias.
+ * @post O destino tem o mesmo conteudo e a mesma data de modificacao da origem.
+ */
+void copia_arquivo(const std::string& origem, const std::string& destino, InfoCopia& info);
+
+/** Intervalo padrao entre checkpoints da copia retomavel. */
+const std::uintmax_t INTERVALO_CHECKPOINT_PADRAO = 256ULL * 1024 * 1024;
+
+/**
+ * @brief Define o intervalo entre checkpoints da copia retomavel (0 desativa).
+ * @details Arquivos com pelo menos um intervalo de tamanho sao copiados para
+ * "<destino>.copiando" e, a cada intervalo gravado, os dados sao confirmados
+ * (fdatasync) e o diario "<destino>.retomada" passa a registrar os bytes confirmados,
+ * o estado do hash ate ali e o checksum do ultimo trecho. Se a copia for interrompida
+ * (ex: pen-drive desconectado), a proxima chamada para o mesmo destino confere o ultimo
+ * trecho gravado e continua dali; o destino so e substituido, por renomeacao, ao final.
+ * No modo snapshot o diario fica dentro do ".parcial" e so e aproveitado com --resume
+ * (executa_backup_snapshot com retomar); sem ele a proxima execucao remove o ".parcial".
+ * Arquivos menores que o intervalo seguem a copia direta, sem diario.
+ */
+void define_intervalo_checkpoint(std::uintmax_t bytes);
+std::uintmax_t intervalo_checkpoint();
+
+/**
+ * @brief Liga o modo que preserva o cache de paginas do host (--sem-cache).
+ * @details Para backups grandes numa maquina em producao: a origem e lida sem deslocar do
+ * cache o que outros processos usam (so as paginas trazidas pela copia sao descartadas,
+ * com POSIX_FADV_DONTNEED, logo atras do cursor de leitura) e o destino e gravado em
+ * janelas de 8 MiB, cada uma esperada (sync_file_range) e descartada do cache. O custo e
+ * uma espera pela gravacao no fim de cada arquivo, sensivel com muitos arquivos pequenos.
+ */
+void define_preserva_cache(bool ativo);
+bool preserva_cache();
+
+/**
+ * @brief Quando um arquivo e lido e gravado ao mesmo tempo, por duas threads (ver define_pipeline).
+ */
+enum ModoPipeline {
+    PIPELINE_NUNCA = 0,       ///< Leitura e escrita alternadas na thread da copia.
+    PIPELINE_AUTOMATICO = 1,  ///< Pipeline quando origem e destino estao em dispositivos diferentes (padrao).
+    PIPELINE_SEMPRE = 2       ///< Pipeline em todo arquivo grande, mesmo no mesmo dispositivo.
+};
+
+/**
+ * @brief Define a copia em pipeline de arquivos grandes (8 MiB ou mais).
+ * @details Uma thread leitora enche um anel de 4 blocos de 1 MiB enquanto a thread da copia
+ * calcula o checksum e grava os blocos ja lidos. Com origem e destino em dispositivos
+ * diferentes (ex: HD -> pen-drive), os dois ficam ocupados ao mesmo tempo e a vazao tende a
+ * min(leitura, escrita), em vez de 1 / (1/leitura + 1/escrita) da leitura alternada. No mesmo
+ * dispositivo (um so disco rotativo) as leituras intercaladas com escritas custariam buscas,
+ * por isso o modo automatico so usa o pipeline entre dispositivos diferentes.
+ */
+void define_pipeline(ModoPipeline modo);
+ModoPipeline pipeline();
+
+/** @brief "nunca", "auto" ou "sempre" (nomes usados por --pipeline). */
+const char* nome_pipeline(ModoPipeline modo);
+/** @return false se o texto nao e um dos nomes de nome_pipeline. */
+bool interpreta_pipeline(const std::string& texto, ModoPipeline& modo);
+
+/** @brief Copias feitas em pipeline desde o inicio do processo (para testes e benchmarks). */
+std::uint64_t copias_em_pipeline();
+/** @brief Threads leitoras criadas desde o inicio do processo (no maximo uma por thread de copia). */
+std::uint64_t leitoras_criadas();
+
+/** @brief Bytes do arquivo presentes no cache de paginas (mincore); 0 se nao puder ser consultado. */
+std::uintmax_t bytes_em_cache(const std::string& caminho);
+
+/**
+ * @brief Quando as copias sao forcadas ao dispositivo (ver define_durabilidade).
+ */
+enum ModoDurabilidade {
+    DURABILIDADE_NENHUMA = 0,  ///< So o cache de paginas: mais rapido, mas uma queda de energia perde as copias recentes.
+    DURABILIDADE_ARQUIVO = 1,  ///< fdatasync de cada arquivo antes da renomeacao e fsync do diretorio depois.
+    DURABILIDADE_LOTE = 2      ///< Um syncfs por sistema de arquivos a cada lote de arquivos ou janela de tempo (padrao).
+};
+
+const std::size_t ARQUIVOS_POR_LOTE_PADRAO = 1024;
+constexpr std::chrono::milliseconds JANELA_LOTE_PADRAO{1000};
+
+/**
+ * @brief Define como as copias se tornam duraveis.
+ * @details Com DURABILIDADE_LOTE, cada copia publicada entra num lote; ao atingir
+ * 'arquivos_por_lote' copias, ou 'janela' desde a primeira copia pendente, um unico
+ * syncfs por sistema de arquivos de destino confirma o lote inteiro (dados, inodes e
+ * renomeacoes). confirma_copias fecha o lote antes de qualquer registro que dependa
+ * das copias (grupo do diario de progresso, manifesto). Uma queda no meio de um lote
+ * pode perder as copias ainda nao confirmadas, mas nunca deixa um destino truncado:
+ * cada arquivo e o antigo ou o novo.
+ */
+void define_durabilidade(ModoDurabilidade modo, std::size_t arquivos_por_lote = ARQUIVOS_POR_LOTE_PADRAO,
+                         std::chrono::milliseconds janela = JANELA_LOTE_PADRAO);
+ModoDurabilidade durabilidade();
+
+/** @brief "nenhuma", "arquivo" ou "lote" (nomes usados por --durabilidade). */
+const char* nome_durabilidade(ModoDurabilidade modo);
+/** @return false se o texto nao e um dos nomes de nome_durabilidade. */
+bool interpreta_durabilidade(const std::string& texto, ModoDurabilidade& modo);
+
+/**
+ * @brief Confirma (syncfs) as copias pendentes do lote; sem efeito nos outros modos.
+ * @return false se o syncfs falhou (o erro ja foi informado em std::cerr).
+ */
+bool confirma_copias();
+
+/**
+ * @brief Torna duravel um diretorio publicado por renomeacao (ex: snapshot ".parcial").
+ * @details Com DURABILIDADE_ARQUIVO ou DURABILIDADE_LOTE faz syncfs no sistema de arquivos
+ * do diretorio, cobrindo a renomeacao e o que foi gravado nele fora do motor de copia (o
+ * manifesto); sem efeito com DURABILIDADE_NENHUMA.
+ * @return false se o syncfs falhou (o erro ja foi informado em std::cerr).
+ */
+bool confirma_diretorio_publicado(const std::string& diretorio);
+
+/** @brief Lotes confirmados com syncfs desde o inicio do processo (para testes e benchmarks). */
+std::uint64_t lotes_confirmados();
+
+/**
+ * @brief Primeira metade da publicacao de uma copia gravada num arquivo temporario.
+ * @details Chamada com o temporario completo e ainda aberto, antes do close: faz o
+ * fdatasync (DURABILIDADE_ARQUIVO) ou inscreve o sistema de arquivos no lote
+ * (DURABILIDADE_LOTE). A versao por caminho abre o temporario para isso.
+ * @throw std::filesystem::filesystem_error em caso de falha de E/S.
+ */
+void prepara_publicacao(int fd, const std::string& temporario);
+void prepara_publicacao(const std::string& temporario);
+
+/**
+ * @brief Segunda metade: renomeia o temporario por cima do destino (atomico).
+ * @details Com DURABILIDADE_ARQUIVO tambem faz fsync do diretorio, para que a
+ * renomeacao sobreviva a uma queda; com DURABILIDADE_LOTE conta a copia e confirma o
+ * lote quando ele completa.
+ * @throw std::filesystem::filesystem_error em caso de falha.
+ */
+void publica_copia(const std::string& temporario, const std::string& destino);
+
+/**
+ * @brief Grava 'destino' como hardlink de 'existente' (copia ja feita do mesmo inode de origem).
+ * @details O vinculo e criado num temporario e publicado com publica_copia: um destino
+ * ja existente (Caso 3) e substituido atomicamente e a durabilidade segue a das copias.
+ * @return false se o sistema de arquivos nao tem hardlinks (FAT/exFAT), o limite de
+ * links foi atingido ou 'existente' nao existe mais; o chamador copia normalmente.
+ * @throw std::filesystem::filesystem_error em outras falhas.
+ */
+bool vincula_copia(const std::string& existente, const std::string& destino);
+
+/**
+ * @brief Copia entre dois armazenamentos quaisquer (ex: disco local -> memoria).
+ * @details Mesmo contrato de copia_arquivo: o checksum e calculado durante a copia e
+ * o destino recebe a data de modificacao da origem. Quando os dois lados sao o disco
+ * local (armazenamento_posix), delega para copia_arquivo; quando so o destino e o disco
+ * local, tambem grava num temporario e publica com publica_copia.
+ * @throw std::filesystem::filesystem_error em caso de falha de E/S.
+ */
+void copia_entre(Armazenamento& arm_origem, const std::string& origem,
+                 Armazenamento& arm_destino, const std::string& destino, InfoCopia& info);
+
+#endif  // COPIA_HPP
@@ -0,0 +1,229 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "diario.hpp"
+#include "armazenamento.hpp"
+#include "checksum.hpp"
+#include "copia.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+const char* const CABECALHO_PROGRESSO = "SYSBACKUP-PROGRESSO 1\n";
+
+std::string cabecalho_de(const std::string& identificacao) {
+    return CABECALHO_PROGRESSO + identificacao + "\n";
+}
+
+/** @brief Le o arquivo inteiro ("" se nao existe). */
+std::string le_tudo(const std::string& caminho) {
+    std::string conteudo;
+    int fd = ::open(caminho.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return conteudo;
+    }
+    struct stat st;
+    if (::fstat(fd, &st) == 0) {
+        conteudo.resize(static_cast<std::size_t>(st.st_size));
+        std::size_t lidos = 0;
+        while (lidos < conteudo.size()) {
+            ssize_t n = ::read(fd, &conteudo[lidos], conteudo.size() - lidos);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                break;
+            }
+            lidos += static_cast<std::size_t>(n);
+        }
+        conteudo.resize(lidos);
+    }
+    ::close(fd);
+    return conteudo;
+}
+
+/**
+ * @brief Forma canonica de um caminho do trabalho: "./origem", "origem/" e "/abs/origem"
+ * resultam no mesmo texto (caminho_diario e identifica_trabalho precisam concordar).
+ */
+std::string caminho_normalizado(const std::string& caminho) {
+    std::error_code erro;
+    std::filesystem::path completo = std::filesystem::absolute(caminho, erro);
+    std::filesystem::path normal = (erro ? std::filesystem::path(caminho) : completo).lexically_normal();
+    if (!normal.has_filename() && normal.has_relative_path()) {
+        normal = normal.parent_path();  // Barra final
+    }
+    return normal.string();
+}
+
+}  // namespace
+
+std::string identifica_trabalho(const std::string& nome_arquivo_parm, const std::string& caminho_origem_base,
+                                const std::string& caminho_destino_base, Operacao operacao) {
+    EstadoArquivo parm;
+    try {
+        parm = armazenamento_posix().consulta(nome_arquivo_parm);
+    } catch (const std::filesystem::filesystem_error&) {
+        // Sem os dados do Backup.parm a identificacao so fica menos especifica
+    }
+    return (operacao == BACKUP ? std::string("BACKUP ") : std::string("RESTAURACAO ")) +
+           std::to_string(parm.tamanho) + " " + std::to_string(nanos_desde_epoca(parm.modificacao)) + "\n" +
+           caminho_normalizado(caminho_origem_base) + "\n" + caminho_normalizado(caminho_destino_base);
+}
+
+std::string caminho_diario(const std::string& nome_arquivo_parm, const std::string& caminho_origem_base,
+                           const std::string& caminho_destino_base, Operacao operacao) {
+    const std::string trabalho = (operacao == BACKUP ? std::string("BACKUP\n") : std::string("RESTAURACAO\n")) +
+                                 caminho_normalizado(caminho_origem_base) + "\n" +
+                                 caminho_normalizado(caminho_destino_base);
+    HashXXH64 hash;
+    hash.atualiza(trabalho.data(), trabalho.size());
+    return nome_arquivo_parm + "." + checksum_para_hex(hash.finaliza()) + SUFIXO_PROGRESSO;
+}
+
+DiarioExecucao::DiarioExecucao(const std::string& caminho, const std::string& identificacao, std::size_t total,
+                               bool retomar)
+    : caminho_(caminho), concluidos_(total, 0), ultimo_grupo_(std::chrono::steady_clock::now()) {
+    if (retomar && carrega(identificacao)) {
+        fd_ = ::open(caminho_.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+    } else {
+        fd_ = ::open(caminho_.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        pendente_ = cabecalho_de(identificacao);
+    }
+    if (fd_ < 0) {
+        std::cerr << "Aviso: diario de progresso indisponivel (" << caminho_ << "): " << std::strerror(errno)
+                  << std::endl;
+        pendente_.clear();
+    }
+}
+
+DiarioExecucao::~DiarioExecucao() {
+    if (fd_ >= 0) {
+        descarrega();
+        ::close(fd_);
+    }
+}
+
+bool DiarioExecucao::carrega(const std::string& identificacao) {
+    const std::string conteudo = le_tudo(caminho_);
+    const std::string cabecalho = cabecalho_de(identificacao);
+    if (conteudo.compare(0, cabecalho.size(), cabecalho) != 0) {
+        return false;
+    }
+
+    // "<indice> <codigo>[ <checksum> <bytes>]\n"; para na primeira linha incompleta
+    const char* p = conteudo.c_str() + cabecalho.size();
+    const char* fim = conteudo.c_str() + conteudo.size();
+    std::size_t valido = cabecalho.size();
+    while (p < fim) {
+        const char* quebra = static_cast<const char*>(std::memchr(p, '\n', static_cast<std::size_t>(fim - p)));
+        if (quebra == nullptr) {
+            break;
+        }
+        char* cursor = nullptr;
+        EntradaDiario entrada;
+        entrada.indice = std::strtoull(p, &cursor, 10);
+        entrada.resultado = static_cast<ResultadoBackup>(std::strtol(cursor, &cursor, 10));
+        if (cursor < quebra) {
+            if (quebra - cursor < 18 || !hex_para_checksum(std::string(cursor + 1, 16), entrada.checksum)) {
+                break;
+            }
+            entrada.bytes = std::strtoull(cursor + 17, &cursor, 10);
+        }
+        if (cursor != quebra || entrada.indice >= concluidos_.size()) {
+            break;
+        }
+        if (entrada.resultado == SUCESSO || entrada.resultado == IGNORAR) {
+            if (!concluidos_[entrada.indice]) {
+                ++total_concluidos_;
+            }
+            concluidos_[entrada.indice] = 1;
+            if (entrada.resultado == SUCESSO) {
+                copias_.push_back(entrada);
+            }
+        }
+        p = quebra + 1;
+        valido = static_cast<std::size_t>(p - conteudo.c_str());
+    }
+
+    // Descarta a cauda incompleta para que os novos registros comecem em linha nova
+    if (valido < conteudo.size() && ::truncate(caminho_.c_str(), static_cast<off_t>(valido)) != 0) {
+        return false;
+    }
+    return true;
+}
+
+void DiarioExecucao::registra(std::size_t indice, ResultadoBackup resultado, const InfoCopia& info) {
+    if (fd_ < 0) {
+        return;
+    }
+    pendente_ += std::to_string(indice);
+    pendente_ += ' ';
+    pendente_ += std::to_string(static_cast<int>(resultado));
+    if (resultado == SUCESSO) {
+        pendente_ += ' ';
+        pendente_ += checksum_para_hex(info.checksum);
+        pendente_ += ' ';
+        pendente_ += std::to_string(info.bytes);
+    }
+    pendente_ += '\n';
+
+    // Commit em grupo: por quantidade ou por tempo desde o ultimo grupo
+    if (++registros_pendentes_ >= GRUPO_DIARIO ||
+        std::chrono::steady_clock::now() - ultimo_grupo_ >= JANELA_DIARIO) {
+        descarrega();
+    }
+}
+
+void DiarioExecucao::descarrega() {
+    ultimo_grupo_ = std::chrono::steady_clock::now();
+    if (fd_ < 0 || pendente_.empty()) {
+        return;
+    }
+    // O grupo so pode ser gravado depois que as copias que ele registra sao duraveis
+    if (!confirma_copias()) {
+        return;
+    }
+    const char* dados = pendente_.data();
+    std::size_t restante = pendente_.size();
+    while (restante > 0) {
+        ssize_t n = ::write(fd_, dados, restante);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0) {
+            std::cerr << "Aviso: falha ao gravar o diario de progresso: " << std::strerror(errno) << std::endl;
+            ::close(fd_);
+            fd_ = -1;
+            return;
+        }
+        dados += n;
+        restante -= static_cast<std::size_t>(n);
+    }
+    ::fdatasync(fd_);
+    pendente_.clear();
+    registros_pendentes_ = 0;
+    ++grupos_;
+}
+
+void DiarioExecucao::encerra(bool sucesso) {
+    if (sucesso) {
+        pendente_.clear();
+        if (fd_ >= 0) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+        std::remove(caminho_.c_str());
+        return;
+    }
+    descarrega();
+}
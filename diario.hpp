@@ -0,0 +1,99 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef DIARIO_HPP
+#define DIARIO_HPP
+
+#include "backup.hpp"
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/** Sufixo do diario de progresso, gravado ao lado do Backup.parm (ver caminho_diario). */
+const char* const SUFIXO_PROGRESSO = ".progresso";
+
+/**
+ * @brief Entrada concluida registrada no diario.
+ */
+struct EntradaDiario {
+    std::size_t indice = 0;        ///< Posicao no Backup.parm.
+    ResultadoBackup resultado = SUCESSO;
+    std::uint64_t checksum = 0;    ///< So para copias (SUCESSO).
+    std::uintmax_t bytes = 0;
+};
+
+/**
+ * @brief Diario de progresso de uma execucao: o resultado de cada entrada do Backup.parm.
+ * @details Os registros sao acumulados em memoria e gravados em grupo (uma escrita e um
+ * fdatasync a cada GRUPO_DIARIO entradas ou JANELA_DIARIO, o que vier primeiro), de modo
+ * que o custo por arquivo e desprezivel. O cabecalho identifica o trabalho (operacao,
+ * origem, destino e o proprio Backup.parm): uma retomada so aproveita um diario do mesmo
+ * trabalho. Uma linha incompleta no fim (execucao morta no meio de uma escrita) e ignorada.
+ * Sem retomada, o diario anterior e descartado. Se o diario nao puder ser gravado, a
+ * execucao segue sem ele.
+ */
+class DiarioExecucao {
+ public:
+    static const std::size_t GRUPO_DIARIO = 4096;
+    static constexpr std::chrono::milliseconds JANELA_DIARIO{1000};
+
+    /**
+     * @param identificacao Texto que identifica o trabalho (ver identifica_trabalho).
+     * @param total Quantidade de entradas do Backup.parm.
+     * @param retomar Carrega as entradas concluidas de um diario anterior do mesmo trabalho.
+     */
+    DiarioExecucao(const std::string& caminho, const std::string& identificacao, std::size_t total, bool retomar);
+    ~DiarioExecucao();
+    DiarioExecucao(const DiarioExecucao&) = delete;
+    DiarioExecucao& operator=(const DiarioExecucao&) = delete;
+
+    /** @brief Entrada ja concluida (SUCESSO ou IGNORAR) na execucao anterior. */
+    bool concluido(std::size_t indice) const { return indice < concluidos_.size() && concluidos_[indice]; }
+    std::size_t concluidos_anteriores() const { return total_concluidos_; }
+    /** @brief Copias da execucao anterior, com checksum, para recompor o manifesto. */
+    const std::vector<EntradaDiario>& copias_anteriores() const { return copias_; }
+
+    void registra(std::size_t indice, ResultadoBackup resultado, const InfoCopia& info);
+    /** @brief Confirma as copias do lote (confirma_copias) e grava o grupo pendente (write + fdatasync). */
+    void descarrega();
+    /** @brief Fim da execucao: com sucesso remove o diario; com erro grava o pendente e o mantem. */
+    void encerra(bool sucesso);
+
+    /** @brief Grupos gravados com fdatasync nesta execucao. */
+    std::uint64_t grupos_gravados() const { return grupos_; }
+
+ private:
+    bool carrega(const std::string& identificacao);
+
+    std::string caminho_;
+    int fd_ = -1;
+    std::vector<char> concluidos_;
+    std::size_t total_concluidos_ = 0;
+    std::vector<EntradaDiario> copias_;
+    std::string pendente_;
+    std::size_t registros_pendentes_ = 0;
+    std::chrono::steady_clock::time_point ultimo_grupo_;
+    std::uint64_t grupos_ = 0;
+};
+
+/**
+ * @brief Identificacao de um trabalho para o cabecalho do diario.
+ * @details Inclui tamanho e data do Backup.parm: se a lista mudar, os indices antigos
+ * nao valem mais. Origem e destino entram absolutos e normalizados, como em caminho_diario:
+ * "./origem" e "origem" sao o mesmo trabalho.
+ */
+std::string identifica_trabalho(const std::string& nome_arquivo_parm, const std::string& caminho_origem_base,
+                                const std::string& caminho_destino_base, Operacao operacao);
+
+/**
+ * @brief Caminho do diario de um trabalho: "<Backup.parm>.<hash>.progresso".
+ * @details O hash (XXH64 da operacao e dos caminhos absolutos de origem e destino) separa os
+ * trabalhos que usam o mesmo Backup.parm: um -b e um -r, ou dois pen-drives, nao apagam nem
+ * invalidam o diario um do outro. Tamanho e data do Backup.parm ficam so no cabecalho: com a
+ * lista alterada o trabalho reaproveita o mesmo arquivo (e o recomeca), sem deixar o antigo orfao.
+ */
+std::string caminho_diario(const std::string& nome_arquivo_parm, const std::string& caminho_origem_base,
+                           const std::string& caminho_destino_base, Operacao operacao);
+
+#endif  // DIARIO_HPP
@@ -0,0 +1,253 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "estatisticas.hpp"
+#include "rastreamento.hpp"
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <string>
+
+namespace {
+
+const char* const NOMES_FASES[TOTAL_FASES] = {
+    "parametros", "diretorios", "metadados", "copia", "vinculo", "hardlink", "manifesto", "verificacao", "sincronia",
+    "limite", "arquivo"
+};
+
+// Casos da tabela de decisao contados (o Caso 1 e o erro de Backup.parm ausente)
+constexpr int PRIMEIRO_CASO = 2;
+constexpr int ULTIMO_CASO = 13;
+
+std::atomic<bool> g_ativa{false};
+HistogramaLatencia g_fases[TOTAL_FASES];
+std::atomic<std::uint64_t> g_casos[ULTIMO_CASO + 1];
+std::atomic<std::uint64_t> g_bytes{0};
+std::atomic<std::int64_t> g_inicio_ns{0};
+
+std::int64_t agora_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+std::string formata_duracao(std::uint64_t ns) {
+    char buffer[32];
+    if (ns < 1000) {
+        std::snprintf(buffer, sizeof(buffer), "%lluns", static_cast<unsigned long long>(ns));
+    } else if (ns < 1000000) {
+        std::snprintf(buffer, sizeof(buffer), "%.1fus", ns / 1e3);
+    } else if (ns < 1000000000) {
+        std::snprintf(buffer, sizeof(buffer), "%.1fms", ns / 1e6);
+    } else {
+        std::snprintf(buffer, sizeof(buffer), "%.2fs", ns / 1e9);
+    }
+    return buffer;
+}
+
+}  // namespace
+
+// ==============================================================================
+// HISTOGRAMA LOG-LINEAR
+// ==============================================================================
+
+HistogramaLatencia::HistogramaLatencia() {
+    zera();
+}
+
+void HistogramaLatencia::zera() {
+    for (auto& faixa : faixas_) {
+        faixa.store(0, std::memory_order_relaxed);
+    }
+    quantidade_.store(0, std::memory_order_relaxed);
+    soma_.store(0, std::memory_order_relaxed);
+    maximo_.store(0, std::memory_order_relaxed);
+}
+
+int HistogramaLatencia::faixa_de(std::uint64_t valor) {
+    if (valor < SUB_FAIXAS) {
+        return static_cast<int>(valor);
+    }
+    int expoente = 63 - __builtin_clzll(valor);  // >= 4
+    int sub = static_cast<int>((valor >> (expoente - 4)) & (SUB_FAIXAS - 1));
+    return (expoente - 3) * SUB_FAIXAS + sub;
+}
+
+std::uint64_t HistogramaLatencia::limite_superior(int faixa) {
+    if (faixa < SUB_FAIXAS) {
+        return static_cast<std::uint64_t>(faixa);
+    }
+    int expoente = faixa / SUB_FAIXAS + 3;
+    std::uint64_t sub = static_cast<std::uint64_t>(faixa % SUB_FAIXAS);
+    return ((SUB_FAIXAS + sub + 1) << (expoente - 4)) - 1;
+}
+
+void HistogramaLatencia::registra(std::uint64_t nanossegundos) {
+    faixas_[faixa_de(nanossegundos)].fetch_add(1, std::memory_order_relaxed);
+    quantidade_.fetch_add(1, std::memory_order_relaxed);
+    soma_.fetch_add(nanossegundos, std::memory_order_relaxed);
+    std::uint64_t atual = maximo_.load(std::memory_order_relaxed);
+    while (nanossegundos > atual &&
+           !maximo_.compare_exchange_weak(atual, nanossegundos, std::memory_order_relaxed)) {
+    }
+}
+
+std::uint64_t HistogramaLatencia::quantidade() const {
+    return quantidade_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t HistogramaLatencia::soma() const {
+    return soma_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t HistogramaLatencia::maximo() const {
+    return maximo_.load(std::memory_order_relaxed);
+}
+
+std::uint64_t HistogramaLatencia::percentil(double p) const {
+    assert(p >= 0.0 && p <= 1.0);
+    std::uint64_t total = quantidade();
+    if (total == 0) {
+        return 0;
+    }
+    std::uint64_t alvo = static_cast<std::uint64_t>(p * static_cast<double>(total) + 0.5);
+    if (alvo == 0) {
+        alvo = 1;
+    }
+    std::uint64_t acumulado = 0;
+    for (int i = 0; i < TOTAL_FAIXAS; ++i) {
+        acumulado += faixas_[i].load(std::memory_order_relaxed);
+        if (acumulado >= alvo) {
+            // O limite da faixa nunca passa do maior valor realmente observado
+            return std::min(limite_superior(i), maximo());
+        }
+    }
+    return maximo();
+}
+
+// ==============================================================================
+// CRONOMETRO DE FASE
+// ==============================================================================
+
+CronometroFase::CronometroFase(FaseExecucao fase, const char* detalhe)
+    : fase_(fase), detalhe_(detalhe), estatisticas_(estatisticas_ativas()),
+      rastreamento_(rastreamento_ativo()) {
+    if (estatisticas_ || rastreamento_) {
+        inicio_ns_ = agora_ns();
+    }
+}
+
+CronometroFase::~CronometroFase() {
+    if (!estatisticas_ && !rastreamento_) {
+        return;
+    }
+    std::int64_t fim_ns = agora_ns();
+    if (estatisticas_) {
+        registra_fase(fase_, static_cast<std::uint64_t>(fim_ns - inicio_ns_));
+    }
+    if (rastreamento_) {
+        registra_evento(fase_, inicio_ns_, fim_ns, detalhe_);
+    }
+}
+
+// ==============================================================================
+// COLETA GLOBAL DA EXECUCAO
+// ==============================================================================
+
+const char* nome_fase(FaseExecucao fase) {
+    assert(fase >= 0 && fase < TOTAL_FASES);
+    return NOMES_FASES[fase];
+}
+
+void ativa_estatisticas(bool ativa) {
+    if (ativa && !g_ativa.load()) {
+        zera_estatisticas();
+    }
+    g_ativa.store(ativa, std::memory_order_relaxed);
+}
+
+bool estatisticas_ativas() {
+    return g_ativa.load(std::memory_order_relaxed);
+}
+
+void zera_estatisticas() {
+    for (auto& fase : g_fases) {
+        fase.zera();
+    }
+    for (auto& caso : g_casos) {
+        caso.store(0, std::memory_order_relaxed);
+    }
+    g_bytes.store(0, std::memory_order_relaxed);
+    g_inicio_ns.store(agora_ns(), std::memory_order_relaxed);
+}
+
+void registra_fase(FaseExecucao fase, std::uint64_t nanossegundos) {
+    assert(fase >= 0 && fase < TOTAL_FASES);
+    g_fases[fase].registra(nanossegundos);
+}
+
+void registra_caso(int caso) {
+    assert(caso >= PRIMEIRO_CASO && caso <= ULTIMO_CASO);
+    if (estatisticas_ativas()) {
+        g_casos[caso].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void registra_bytes_copiados(std::uint64_t bytes) {
+    if (estatisticas_ativas()) {
+        g_bytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+}
+
+const HistogramaLatencia& histograma_fase(FaseExecucao fase) {
+    return g_fases[fase];
+}
+
+std::uint64_t contagem_caso(int caso) {
+    assert(caso >= PRIMEIRO_CASO && caso <= ULTIMO_CASO);
+    return g_casos[caso].load(std::memory_order_relaxed);
+}
+
+std::uint64_t bytes_copiados() {
+    return g_bytes.load(std::memory_order_relaxed);
+}
+
+void imprime_estatisticas(std::ostream& saida) {
+    double segundos = static_cast<double>(agora_ns() - g_inicio_ns.load()) / 1e9;
+
+    saida << "=== Estatisticas da execucao ===" << std::endl;
+    saida << std::left << std::setw(12) << "Fase" << std::right << std::setw(10) << "Qtde"
+          << std::setw(10) << "p50" << std::setw(10) << "p99" << std::setw(10) << "max"
+          << std::setw(10) << "total" << std::endl;
+    for (int f = 0; f < TOTAL_FASES; ++f) {
+        const HistogramaLatencia& h = g_fases[f];
+        if (h.quantidade() == 0) {
+            continue;
+        }
+        saida << std::left << std::setw(12) << NOMES_FASES[f] << std::right
+              << std::setw(10) << h.quantidade()
+              << std::setw(10) << formata_duracao(h.percentil(0.50))
+              << std::setw(10) << formata_duracao(h.percentil(0.99))
+              << std::setw(10) << formata_duracao(h.maximo())
+              << std::setw(10) << formata_duracao(h.soma()) << std::endl;
+    }
+
+    saida << "Casos:";
+    for (int caso = PRIMEIRO_CASO; caso <= ULTIMO_CASO; ++caso) {
+        std::uint64_t n = contagem_caso(caso);
+        if (n > 0) {
+            saida << " " << caso << "=" << n;
+        }
+    }
+    saida << std::endl;
+
+    // FASE_VINCULO fica fora de FASE_ARQUIVO (arquivo inalterado do snapshot); FASE_HARDLINK, dentro
+    std::uint64_t arquivos = g_fases[FASE_ARQUIVO].quantidade() + g_fases[FASE_VINCULO].quantidade();
+    double mb = static_cast<double>(bytes_copiados()) / (1024.0 * 1024.0);
+    saida << std::fixed << std::setprecision(2)
+          << "Bytes copiados: " << mb << " MB | Arquivos: " << arquivos
+          << " | Arquivos/s: " << (segundos > 0 ? arquivos / segundos : 0.0)
+          << " | MB/s: " << (segundos > 0 ? mb / segundos : 0.0)
+          << " | Duracao: " << segundos << " s" << std::endl;
+    saida.unsetf(std::ios::fixed);
+}
@@ -0,0 +1,115 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef ESTATISTICAS_HPP
+#define ESTATISTICAS_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * @brief Fases instrumentadas de uma execucao.
+ */
+enum FaseExecucao {
+    FASE_PARAMETROS = 0,  ///< le_arquivo_parametros
+    FASE_DIRETORIOS,      ///< Criacao das pastas de destino
+    FASE_METADADOS,       ///< exists / last_write_time da tabela de decisao
+    FASE_COPIA,           ///< Motor de copia (leitura, hash e escrita)
+    FASE_VINCULO,         ///< Hardlink para o snapshot anterior
+    FASE_HARDLINK,        ///< Nome recriado como hardlink de um inode ja copiado (dentro de FASE_ARQUIVO)
+    FASE_MANIFESTO,       ///< Leitura/gravacao do manifesto e do catalogo
+    FASE_VERIFICACAO,     ///< Releitura e hash de um arquivo do backup
+    FASE_SINCRONIA,       ///< fdatasync/syncfs das copias (ver define_durabilidade)
+    FASE_LIMITE,          ///< Espera imposta pelos limites de E/S (ver define_limite)
+    FASE_ARQUIVO,         ///< faz_backup_arquivo completo
+    TOTAL_FASES
+};
+
+/**
+ * @brief Histograma log-linear de latencias (estilo HDR).
+ * @details 16 sub-faixas por potencia de 2 (erro relativo <= 6,25%) em contadores
+ * atomicos de tamanho fixo: registrar custa um incremento, sem alocacao nem trava.
+ */
+class HistogramaLatencia {
+ public:
+    static const int SUB_FAIXAS = 16;
+    static const int TOTAL_FAIXAS = 61 * SUB_FAIXAS;
+
+    HistogramaLatencia();
+    void registra(std::uint64_t nanossegundos);
+    void zera();
+
+    std::uint64_t quantidade() const;
+    std::uint64_t soma() const;
+    std::uint64_t maximo() const;
+    /** @brief Valor (limite superior da faixa) abaixo do qual esta a fracao p das amostras. */
+    std::uint64_t percentil(double p) const;
+
+    static int faixa_de(std::uint64_t valor);
+    static std::uint64_t limite_superior(int faixa);
+
+ private:
+    std::atomic<std::uint64_t> faixas_[TOTAL_FAIXAS];
+    std::atomic<std::uint64_t> quantidade_;
+    std::atomic<std::uint64_t> soma_;
+    std::atomic<std::uint64_t> maximo_;
+};
+
+/** @brief Nome curto da fase ("copia", "metadados", ...). */
+const char* nome_fase(FaseExecucao fase);
+
+/** @brief Liga ou desliga a coleta em tempo de execucao (desligada por padrao). */
+void ativa_estatisticas(bool ativa);
+bool estatisticas_ativas();
+/** @brief Zera histogramas e contadores e reinicia o relogio da execucao. */
+void zera_estatisticas();
+
+void registra_fase(FaseExecucao fase, std::uint64_t nanossegundos);
+/** @brief Conta uma ocorrencia de um caso da tabela de decisao (2 a 13). */
+void registra_caso(int caso);
+void registra_bytes_copiados(std::uint64_t bytes);
+
+const HistogramaLatencia& histograma_fase(FaseExecucao fase);
+std::uint64_t contagem_caso(int caso);
+std::uint64_t bytes_copiados();
+
+/** @brief Imprime p50/p99/max por fase, os casos, os bytes copiados e arquivos/s. */
+void imprime_estatisticas(std::ostream& saida);
+
+/**
+ * @brief Mede a duracao de um escopo e a registra na fase indicada.
+ * @details Alimenta o histograma da fase (--stats) e a linha do tempo (--trace).
+ * Com ambos desligados nao le o relogio.
+ */
+class CronometroFase {
+ public:
+    /** @param detalhe Texto do evento no rastreamento; deve viver ate o fim do escopo. */
+    explicit CronometroFase(FaseExecucao fase, const char* detalhe = nullptr);
+    ~CronometroFase();
+    CronometroFase(const CronometroFase&) = delete;
+    CronometroFase& operator=(const CronometroFase&) = delete;
+
+ private:
+    FaseExecucao fase_;
+    const char* detalhe_;
+    bool estatisticas_;
+    bool rastreamento_;
+    std::int64_t inicio_ns_ = 0;
+};
+
+// Com -DSYSBACKUP_SEM_ESTATISTICAS a instrumentacao desaparece em tempo de compilacao
+#ifndef SYSBACKUP_SEM_ESTATISTICAS
+#define SYSBACKUP_CONCATENA_(a, b) a##b
+#define SYSBACKUP_CONCATENA(a, b) SYSBACKUP_CONCATENA_(a, b)
+#define MEDE_FASE(fase) CronometroFase SYSBACKUP_CONCATENA(cronometro_, __LINE__)(fase)
+#define MEDE_FASE_DE(fase, detalhe) CronometroFase SYSBACKUP_CONCATENA(cronometro_, __LINE__)(fase, detalhe)
+#define CONTA_CASO(caso) registra_caso(caso)
+#define CONTA_BYTES(bytes) registra_bytes_copiados(bytes)
+#else
+#define MEDE_FASE(fase) ((void)0)
+#define MEDE_FASE_DE(fase, detalhe) ((void)0)
+#define CONTA_CASO(caso) ((void)0)
+#define CONTA_BYTES(bytes) ((void)0)
+#endif
+
+#endif  // ESTATISTICAS_HPP
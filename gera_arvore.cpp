@@ -0,0 +1,43 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "gerador.hpp"
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+// ==============================================================================
+// GERADOR DE ARVORES SINTETICAS
+// ==============================================================================
+
+int main(int argc, char* argv[]) {
+    if (argc < 3 || argc > 4) {
+        std::cerr << "Uso: " << argv[0] << " <PERFIL> <PASTA_DESTINO> [ESCALA]" << std::endl;
+        std::cerr << "PERFIL:";
+        for (int p = 0; p < TOTAL_PERFIS; ++p) {
+            std::cerr << " " << nome_perfil(static_cast<PerfilArvore>(p));
+        }
+        std::cerr << std::endl << "ESCALA: fracao do perfil completo (padrao 1.0)" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    PerfilArvore perfil;
+    if (!interpreta_perfil(argv[1], perfil)) {
+        std::cerr << "ERRO: Perfil desconhecido: " << argv[1] << std::endl;
+        return EXIT_FAILURE;
+    }
+    double escala = (argc == 4) ? std::strtod(argv[3], nullptr) : 1.0;
+    if (escala <= 0.0) {
+        std::cerr << "ERRO: Escala invalida." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    ArvoreGerada arvore;
+    if (gera_arvore(perfil, argv[2], escala, arvore) != SUCESSO) {
+        return EXIT_FAILURE;
+    }
+    std::cout << "Gerados " << arvore.arquivos << " arquivos (" << arvore.bytes / (1024 * 1024)
+              << " MiB logicos, " << arvore.bytes_dados / (1024 * 1024) << " MiB de dados) em "
+              << arvore.raiz << std::endl;
+    std::cout << "Parametros: " << arvore.arquivo_parm << std::endl;
+    return EXIT_SUCCESS;
+}
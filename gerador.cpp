@@ -0,0 +1,209 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "gerador.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::uint64_t KIB = 1024;
+constexpr std::uint64_t MIB = 1024 * KIB;
+constexpr std::uint64_t GIB = 1024 * MIB;
+
+// Nos arquivos grandes, 1 MiB de dados a cada 16 MiB; o resto e buraco
+constexpr std::uint64_t PASSO_ESPARSO = 16 * MIB;
+constexpr std::uint64_t DADOS_ESPARSO = 1 * MIB;
+
+// Todas as datas ficam em 2025-01-01 00:00:00 UTC
+constexpr time_t DATA_FIXA = 1735689600;
+
+struct DescricaoPerfil {
+    const char* nome;
+    std::uint64_t arquivos;
+    std::uint64_t tamanho;
+    std::uint64_t por_pasta;
+};
+
+const DescricaoPerfil PERFIS[TOTAL_PERFIS] = {
+    {"pequenos", 1000000, 1 * KIB, 1000},
+    {"medios", 10000, 1 * MIB, 100},
+    {"grandes", 10, 10 * GIB, 0},
+    {"profunda", 100000, 4 * KIB, 0},
+    {"larga", 100000, 4 * KIB, 0},
+};
+
+constexpr unsigned CADEIAS_PROFUNDA = 100;
+constexpr unsigned NIVEIS_PROFUNDA = 32;
+
+inline std::uint64_t mistura(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+/** @brief Preenche o buffer com bytes pseudoaleatorios determinados pela semente. */
+void preenche(std::vector<char>& buffer, std::uint64_t semente) {
+    std::uint64_t estado = mistura(semente) | 1;
+    for (std::size_t i = 0; i + 8 <= buffer.size(); i += 8) {
+        estado ^= estado >> 12;
+        estado ^= estado << 25;
+        estado ^= estado >> 27;
+        std::uint64_t palavra = estado * 0x2545F4914F6CDD1DULL;
+        std::memcpy(&buffer[i], &palavra, 8);
+    }
+}
+
+std::string caminho_relativo(PerfilArvore perfil, std::uint64_t i, std::uint64_t por_pasta) {
+    char nome[64];
+    switch (perfil) {
+        case PERFIL_GRANDES:
+            std::snprintf(nome, sizeof(nome), "g%02llu.bin", static_cast<unsigned long long>(i));
+            return nome;
+        case PERFIL_LARGA:
+            std::snprintf(nome, sizeof(nome), "f%06llu", static_cast<unsigned long long>(i));
+            return nome;
+        case PERFIL_PROFUNDA: {
+            std::snprintf(nome, sizeof(nome), "c%02llu", static_cast<unsigned long long>(i % CADEIAS_PROFUNDA));
+            std::string caminho = nome;
+            std::uint64_t nivel = (i / CADEIAS_PROFUNDA) % NIVEIS_PROFUNDA;
+            for (std::uint64_t n = 0; n <= nivel; ++n) {
+                std::snprintf(nome, sizeof(nome), "/n%02llu", static_cast<unsigned long long>(n));
+                caminho += nome;
+            }
+            std::snprintf(nome, sizeof(nome), "/f%06llu", static_cast<unsigned long long>(i));
+            return caminho + nome;
+        }
+        default:
+            std::snprintf(nome, sizeof(nome), "d%04llu/f%07llu",
+                          static_cast<unsigned long long>(i / por_pasta), static_cast<unsigned long long>(i));
+            return nome;
+    }
+}
+
+/**
+ * @brief Grava um arquivo: denso com 'tamanho' bytes ou esparso com blocos a cada PASSO_ESPARSO.
+ * @return Bytes de dados escritos ou -1 em caso de erro.
+ */
+long long grava_arquivo(const std::string& caminho, std::uint64_t tamanho, bool esparso,
+                        std::uint64_t semente, std::vector<char>& buffer) {
+    int fd = ::open(caminho.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        return -1;
+    }
+    long long escritos = 0;
+    bool ok = true;
+    if (esparso) {
+        ok = ::ftruncate(fd, static_cast<off_t>(tamanho)) == 0;
+        for (std::uint64_t offset = 0; ok && offset < tamanho; offset += PASSO_ESPARSO) {
+            std::size_t bloco = static_cast<std::size_t>(std::min(DADOS_ESPARSO, tamanho - offset));
+            preenche(buffer, semente ^ offset);
+            ok = ::pwrite(fd, buffer.data(), bloco, static_cast<off_t>(offset)) == static_cast<ssize_t>(bloco);
+            escritos += static_cast<long long>(bloco);
+        }
+    } else {
+        preenche(buffer, semente);
+        ok = ::write(fd, buffer.data(), tamanho) == static_cast<ssize_t>(tamanho);
+        escritos = static_cast<long long>(tamanho);
+    }
+
+    const struct timespec datas[2] = {{DATA_FIXA, 0}, {DATA_FIXA, 0}};
+    ok = ok && ::futimens(fd, datas) == 0;
+    ok = (::close(fd) == 0) && ok;
+    return ok ? escritos : -1;
+}
+
+}  // namespace
+
+const char* nome_perfil(PerfilArvore perfil) {
+    assert(perfil >= 0 && perfil < TOTAL_PERFIS);
+    return PERFIS[perfil].nome;
+}
+
+bool interpreta_perfil(const std::string& nome, PerfilArvore& perfil) {
+    for (int p = 0; p < TOTAL_PERFIS; ++p) {
+        if (nome == PERFIS[p].nome) {
+            perfil = static_cast<PerfilArvore>(p);
+            return true;
+        }
+    }
+    return false;
+}
+
+ResultadoBackup gera_arvore(PerfilArvore perfil, const std::string& raiz, double escala,
+                            ArvoreGerada& arvore) {
+    // Assertiva de entrada
+    assert(perfil >= 0 && perfil < TOTAL_PERFIS);
+    assert(!raiz.empty() && escala > 0.0);
+
+    const DescricaoPerfil& descricao = PERFIS[perfil];
+    const bool esparso = (perfil == PERFIL_GRANDES);
+    std::uint64_t arquivos = descricao.arquivos;
+    std::uint64_t tamanho = descricao.tamanho;
+    if (esparso) {
+        // Nos grandes a escala reduz o tamanho, em MiB inteiros
+        tamanho = std::max<std::uint64_t>(MIB, static_cast<std::uint64_t>(std::llround(tamanho * escala / MIB)) * MIB);
+    } else {
+        arquivos = std::max<std::uint64_t>(1, static_cast<std::uint64_t>(std::llround(arquivos * escala)));
+    }
+
+    std::error_code erro;
+    fs::remove_all(raiz, erro);
+    fs::create_directories(raiz, erro);
+    if (erro) {
+        std::cerr << "Erro ao criar " << raiz << ": " << erro.message() << std::endl;
+        return ERRO_GERAL;
+    }
+
+    arvore = ArvoreGerada{};
+    arvore.raiz = raiz;
+    arvore.arquivo_parm = raiz + "/Backup.parm";
+    std::ofstream parm(arvore.arquivo_parm, std::ios::trunc);
+    if (!parm.is_open()) {
+        return ERRO_GERAL;
+    }
+
+    std::vector<char> buffer(static_cast<std::size_t>(esparso ? DADOS_ESPARSO : tamanho));
+    std::set<std::string> diretorios;
+    for (std::uint64_t i = 0; i < arquivos; ++i) {
+        const std::string relativo = caminho_relativo(perfil, i, descricao.por_pasta);
+        const std::string caminho = raiz + "/" + relativo;
+
+        std::string::size_type barra = relativo.rfind('/');
+        if (barra != std::string::npos && diretorios.insert(relativo.substr(0, barra)).second) {
+            fs::create_directories(raiz + "/" + relativo.substr(0, barra), erro);
+        }
+
+        long long escritos = grava_arquivo(caminho, tamanho, esparso, i + 1, buffer);
+        if (escritos < 0) {
+            std::cerr << "Erro ao gerar " << caminho << ": " << std::strerror(errno) << std::endl;
+            return ERRO_GERAL;
+        }
+        parm << relativo << '\n';
+        ++arvore.arquivos;
+        arvore.bytes += tamanho;
+        arvore.bytes_dados += static_cast<std::uint64_t>(escritos);
+    }
+
+    parm.flush();
+    if (!parm) {
+        return ERRO_GERAL;
+    }
+
+    // Assertiva de saida
+    assert(arvore.arquivos == arquivos);
+    return SUCESSO;
+}
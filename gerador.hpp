@@ -0,0 +1,51 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef GERADOR_HPP
+#define GERADOR_HPP
+
+#include "backup.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Formatos de arvore sintetica usados nos benchmarks.
+ */
+enum PerfilArvore {
+    PERFIL_PEQUENOS = 0,  ///< 1.000.000 x 1 KiB, 1000 arquivos por pasta
+    PERFIL_MEDIOS,        ///< 10.000 x 1 MiB, 100 arquivos por pasta
+    PERFIL_GRANDES,       ///< 10 x 10 GiB esparsos: 1 MiB de dados a cada 16 MiB
+    PERFIL_PROFUNDA,      ///< 100.000 x 4 KiB em 100 cadeias de 32 niveis
+    PERFIL_LARGA,         ///< 100.000 x 4 KiB em uma unica pasta
+    TOTAL_PERFIS
+};
+
+/**
+ * @brief Resumo de uma arvore gerada.
+ */
+struct ArvoreGerada {
+    std::string raiz;             ///< Pasta de origem criada.
+    std::string arquivo_parm;     ///< Backup.parm (dentro da raiz) listando todos os arquivos.
+    std::uint64_t arquivos = 0;
+    std::uint64_t bytes = 0;      ///< Tamanho logico total (inclui os buracos).
+    std::uint64_t bytes_dados = 0;  ///< Bytes efetivamente escritos.
+};
+
+const char* nome_perfil(PerfilArvore perfil);
+/** @return false se o nome nao corresponde a nenhum perfil. */
+bool interpreta_perfil(const std::string& nome, PerfilArvore& perfil);
+
+/**
+ * @brief Gera de forma reprodutivel uma arvore de origem e o seu Backup.parm.
+ * @details O conteudo de cada arquivo vem de um gerador pseudoaleatorio semeado pelo
+ * seu indice e todas as datas de modificacao sao fixas, de modo que duas execucoes
+ * (em qualquer maquina) produzem arvores identicas.
+ * @param escala Multiplica a quantidade de arquivos (ou, no perfil de grandes, o
+ * tamanho de cada um); 1.0 gera o perfil completo.
+ * @return SUCESSO ou ERRO_GERAL.
+ * @post A raiz contem apenas a arvore gerada.
+ */
+ResultadoBackup gera_arvore(PerfilArvore perfil, const std::string& raiz, double escala,
+                            ArvoreGerada& arvore);
+
+#endif  // GERADOR_HPP
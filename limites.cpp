@@ -0,0 +1,281 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "limites.hpp"
+#include "estatisticas.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace {
+
+// Espera maxima de uma vez: uma taxa alterada no meio da espera vale a partir da fatia seguinte
+constexpr std::chrono::milliseconds FATIA_ESPERA{100};
+
+// ioprio_set(2): classe no alto do valor, nivel (0-7) embaixo
+constexpr int IOPRIO_QUEM_PROCESSO = 1;
+constexpr int IOPRIO_CLASSE_OCIOSA = 3;
+constexpr int IOPRIO_DESLOCAMENTO_CLASSE = 13;
+
+BaldeFichas g_baldes[TOTAL_LIMITES];
+
+volatile std::sig_atomic_t g_releitura_pedida = 0;
+
+void trata_sighup(int) {
+    g_releitura_pedida = 1;
+}
+
+/**
+ * @brief Thread que rele o arquivo de controle quando ele muda ou chega um SIGHUP.
+ * @details Encerrada no fim do processo (destrutor do objeto estatico).
+ */
+class AcompanhamentoControle {
+ public:
+    ~AcompanhamentoControle() { para(); }
+
+    void inicia(const std::string& arquivo) {
+        para();
+        arquivo_ = arquivo;
+        versao_ = versao_atual();
+        parar_ = false;
+        thread_ = std::thread(&AcompanhamentoControle::laco, this);
+    }
+
+ private:
+    void para() {
+        if (thread_.joinable()) {
+            {
+                std::lock_guard<std::mutex> trava(mutex_);
+                parar_ = true;
+            }
+            acorda_.notify_one();
+            thread_.join();
+        }
+    }
+
+    /** @brief Data e tamanho do arquivo: muda a cada gravacao (ou substituicao) do controle. */
+    std::string versao_atual() const {
+        struct stat st;
+        if (::stat(arquivo_.c_str(), &st) != 0) {
+            return std::string();
+        }
+        return std::to_string(st.st_mtim.tv_sec) + "." + std::to_string(st.st_mtim.tv_nsec) + " " +
+               std::to_string(st.st_size) + " " + std::to_string(st.st_ino);
+    }
+
+    void laco() {
+        std::unique_lock<std::mutex> trava(mutex_);
+        while (!acorda_.wait_for(trava, INTERVALO_CONTROLE, [this] { return parar_; })) {
+            const std::string versao = versao_atual();
+            if (g_releitura_pedida == 0 && versao == versao_) {
+                continue;
+            }
+            g_releitura_pedida = 0;
+            versao_ = versao;
+            if (!carrega_controle_limites(arquivo_)) {
+                std::cerr << "Aviso: arquivo de controle invalido (" << arquivo_ << "); limites mantidos"
+                          << std::endl;
+            }
+        }
+    }
+
+    std::string arquivo_;
+    std::string versao_;
+    std::mutex mutex_;
+    std::condition_variable acorda_;
+    bool parar_ = false;
+    std::thread thread_;
+};
+
+AcompanhamentoControle& acompanhamento_controle() {
+    static AcompanhamentoControle instancia;
+    return instancia;
+}
+
+}  // namespace
+
+// ==============================================================================
+// BALDE DE FICHAS
+// ==============================================================================
+
+void BaldeFichas::define_taxa(double por_segundo) {
+    std::lock_guard<std::mutex> trava(mutex_);
+    taxa_.store(std::max(0.0, por_segundo), std::memory_order_relaxed);
+    // A divida acumulada na taxa anterior nao vale na nova; quem ja esta esperando se ajusta
+    saldo_ = 0.0;
+    reposto_ = std::chrono::steady_clock::now();
+}
+
+void BaldeFichas::consome(double quantidade) {
+    double taxa = taxa_.load(std::memory_order_relaxed);
+    if (taxa <= 0.0 || quantidade <= 0.0) {
+        return;
+    }
+    double divida;
+    {
+        std::lock_guard<std::mutex> trava(mutex_);
+        const auto agora = std::chrono::steady_clock::now();
+        const double decorrido = std::chrono::duration<double>(agora - reposto_).count();
+        saldo_ = std::min(taxa * RAJADA_LIMITE, saldo_ + taxa * decorrido);
+        reposto_ = agora;
+        saldo_ -= quantidade;
+        divida = -saldo_;
+    }
+    if (divida <= 0.0) {
+        return;
+    }
+
+    MEDE_FASE(FASE_LIMITE);
+    while (divida > 0.0) {
+        const auto fatia = std::min<std::chrono::nanoseconds>(
+            FATIA_ESPERA, std::chrono::nanoseconds(static_cast<std::int64_t>(divida / taxa * 1e9)));
+        std::this_thread::sleep_for(fatia);
+        espera_ns_.fetch_add(fatia.count(), std::memory_order_relaxed);
+        divida -= taxa * std::chrono::duration<double>(fatia).count();
+
+        // Limite alterado durante a espera: o que falta e pago na nova taxa (ou perdoado)
+        taxa = taxa_.load(std::memory_order_relaxed);
+        if (taxa <= 0.0 || fatia.count() == 0) {
+            break;
+        }
+    }
+}
+
+// ==============================================================================
+// LIMITES DA EXECUCAO
+// ==============================================================================
+
+void define_limite(RecursoLimitado recurso, double por_segundo) {
+    g_baldes[recurso].define_taxa(por_segundo);
+}
+
+double limite(RecursoLimitado recurso) {
+    return g_baldes[recurso].taxa();
+}
+
+std::chrono::nanoseconds espera_do_limite(RecursoLimitado recurso) {
+    return g_baldes[recurso].espera_total();
+}
+
+void limita_leitura(std::size_t bytes) {
+    g_baldes[LIMITE_LEITURA].consome(static_cast<double>(bytes));
+}
+
+void limita_escrita(std::size_t bytes) {
+    g_baldes[LIMITE_ESCRITA].consome(static_cast<double>(bytes));
+}
+
+void limita_metadados(unsigned operacoes) {
+    g_baldes[LIMITE_METADADOS].consome(static_cast<double>(operacoes));
+}
+
+const char* nome_limite(RecursoLimitado recurso) {
+    switch (recurso) {
+        case LIMITE_LEITURA:
+            return "leitura";
+        case LIMITE_ESCRITA:
+            return "escrita";
+        case LIMITE_METADADOS:
+            return "metadados";
+        case TOTAL_LIMITES:
+            break;
+    }
+    return "?";
+}
+
+bool interpreta_taxa(const std::string& texto, double& por_segundo) {
+    if (texto == "ilimitado") {
+        por_segundo = 0.0;
+        return true;
+    }
+    char* fim = nullptr;
+    double valor = std::strtod(texto.c_str(), &fim);
+    if (fim == texto.c_str() || valor < 0.0) {
+        return false;
+    }
+    switch (*fim) {
+        case 'k':
+        case 'K':
+            valor *= 1024.0;
+            ++fim;
+            break;
+        case 'm':
+        case 'M':
+            valor *= 1024.0 * 1024.0;
+            ++fim;
+            break;
+        case 'g':
+        case 'G':
+            valor *= 1024.0 * 1024.0 * 1024.0;
+            ++fim;
+            break;
+        default:
+            break;
+    }
+    if (*fim != '\0') {
+        return false;
+    }
+    por_segundo = valor;
+    return true;
+}
+
+bool carrega_controle_limites(const std::string& arquivo) {
+    std::ifstream entrada(arquivo);
+    if (!entrada.is_open()) {
+        return false;
+    }
+    double taxas[TOTAL_LIMITES] = {};
+    std::string linha;
+    while (std::getline(entrada, linha)) {
+        std::istringstream campos(linha);
+        std::string chave, valor, sobra;
+        if (!(campos >> chave) || chave[0] == '#') {
+            continue;
+        }
+        int recurso = 0;
+        while (recurso < TOTAL_LIMITES && chave != nome_limite(static_cast<RecursoLimitado>(recurso))) {
+            ++recurso;
+        }
+        if (recurso == TOTAL_LIMITES || !(campos >> valor) || (campos >> sobra) ||
+            !interpreta_taxa(valor, taxas[recurso])) {
+            return false;
+        }
+    }
+    for (int recurso = 0; recurso < TOTAL_LIMITES; ++recurso) {
+        if (limite(static_cast<RecursoLimitado>(recurso)) != taxas[recurso]) {
+            define_limite(static_cast<RecursoLimitado>(recurso), taxas[recurso]);
+        }
+    }
+    return true;
+}
+
+bool acompanha_controle_limites(const std::string& arquivo) {
+    if (!carrega_controle_limites(arquivo)) {
+        return false;
+    }
+    struct sigaction acao;
+    std::memset(&acao, 0, sizeof(acao));
+    acao.sa_handler = trata_sighup;
+    acao.sa_flags = SA_RESTART;  // As chamadas de E/S interrompidas continuam sozinhas
+    sigemptyset(&acao.sa_mask);
+    ::sigaction(SIGHUP, &acao, nullptr);
+    acompanhamento_controle().inicia(arquivo);
+    return true;
+}
+
+bool define_prioridade_ociosa() {
+    if (::syscall(SYS_ioprio_set, IOPRIO_QUEM_PROCESSO, 0, IOPRIO_CLASSE_OCIOSA << IOPRIO_DESLOCAMENTO_CLASSE) != 0) {
+        std::cerr << "Aviso: classe de E/S ociosa indisponivel: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    return true;
+}
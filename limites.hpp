@@ -0,0 +1,108 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef LIMITES_HPP
+#define LIMITES_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+/**
+ * @brief Balde de fichas: limita a taxa media de um recurso, com rajadas curtas.
+ * @details O saldo e reposto a 'taxa' fichas por segundo, ate RAJADA_LIMITE de taxa
+ * acumulada. consome() desconta a quantidade ja usada e, se o saldo ficou negativo,
+ * dorme o tempo de pagar a divida (fora da trava); como cada thread dorme a divida
+ * acumulada ate ela, as threads que dividem o balde ficam, juntas, na taxa. Com taxa 0
+ * (ilimitado) consome() e uma leitura atomica.
+ */
+class BaldeFichas {
+ public:
+    /** Rajada maxima, em segundos de taxa: o que sobra de um periodo ocioso. */
+    static constexpr double RAJADA_LIMITE = 0.1;
+
+    void define_taxa(double por_segundo);
+    double taxa() const { return taxa_.load(std::memory_order_relaxed); }
+
+    /** @brief Desconta 'quantidade' fichas, esperando se o balde estiver em divida. */
+    void consome(double quantidade);
+
+    /** @brief Tempo total de espera imposto por este balde (para testes e relatorios). */
+    std::chrono::nanoseconds espera_total() const {
+        return std::chrono::nanoseconds(espera_ns_.load(std::memory_order_relaxed));
+    }
+
+ private:
+    std::atomic<double> taxa_{0.0};
+    std::atomic<std::int64_t> espera_ns_{0};
+    std::mutex mutex_;
+    double saldo_ = 0.0;
+    std::chrono::steady_clock::time_point reposto_{};
+};
+
+/**
+ * @brief Recursos limitados durante uma execucao (backup em horario comercial).
+ */
+enum RecursoLimitado {
+    LIMITE_LEITURA = 0,  ///< Bytes/s lidos da origem (e relidos na verificacao).
+    LIMITE_ESCRITA,      ///< Bytes/s gravados no destino.
+    LIMITE_METADADOS,    ///< Operacoes/s de metadados (stat, open, rename, link, mkdir).
+    TOTAL_LIMITES
+};
+
+/**
+ * @brief Define o limite de um recurso, compartilhado por todas as threads (0 = sem limite).
+ * @details Pode ser chamado a qualquer momento: a nova taxa vale a partir da proxima
+ * operacao, inclusive no meio de uma copia.
+ */
+void define_limite(RecursoLimitado recurso, double por_segundo);
+double limite(RecursoLimitado recurso);
+/** @brief Espera acumulada imposta pelo limite do recurso desde o inicio do processo. */
+std::chrono::nanoseconds espera_do_limite(RecursoLimitado recurso);
+
+/** @brief Contabiliza bytes lidos/gravados e operacoes de metadados, esperando se preciso. */
+void limita_leitura(std::size_t bytes);
+void limita_escrita(std::size_t bytes);
+void limita_metadados(unsigned operacoes = 1);
+
+/** @brief "leitura", "escrita" ou "metadados" (chaves do arquivo de controle). */
+const char* nome_limite(RecursoLimitado recurso);
+
+/**
+ * @brief Interpreta uma taxa: numero com sufixo opcional K, M ou G (potencias de 1024).
+ * @details "0" e "ilimitado" desligam o limite. Ex: "20M" = 20 MiB/s, "500" = 500 op/s.
+ * @return false se o texto nao for uma taxa valida.
+ */
+bool interpreta_taxa(const std::string& texto, double& por_segundo);
+
+/**
+ * @brief Aplica os limites de um arquivo de controle.
+ * @details Uma linha por recurso, "<leitura|escrita|metadados> <taxa>"; linhas vazias e
+ * comecadas por '#' sao ignoradas. Recursos ausentes do arquivo ficam sem limite.
+ * @return false (e nenhum limite alterado) se o arquivo nao existe ou tem linha invalida.
+ */
+bool carrega_controle_limites(const std::string& arquivo);
+
+/**
+ * @brief Aplica o arquivo de controle e passa a acompanha-lo durante a execucao.
+ * @details O arquivo e relido quando muda (conferido a cada INTERVALO_CONTROLE) ou quando
+ * o processo recebe SIGHUP, de modo que um operador pode apertar ou soltar os limites de
+ * um backup em andamento. Um arquivo invalido mantem os limites anteriores.
+ * @return false se a primeira leitura falhar.
+ */
+bool acompanha_controle_limites(const std::string& arquivo);
+constexpr std::chrono::milliseconds INTERVALO_CONTROLE{500};
+
+/**
+ * @brief Poe o processo na classe de E/S ociosa (ioprio_set IOPRIO_CLASS_IDLE).
+ * @details O escalonador de E/S (BFQ; CFQ nos kernels antigos) so atende o backup quando
+ * nenhum outro processo usa o disco e volta a dar-lhe a banda toda quando o disco fica
+ * livre. Deve ser chamado antes de criar threads, que herdam a prioridade. Com
+ * mq-deadline ou none a classe e aceita mas nao tem efeito.
+ * @return false se o kernel recusou (o erro ja foi informado em std::cerr).
+ */
+bool define_prioridade_ociosa();
+
+#endif  // LIMITES_HPP
@@ -1,22 +1,217 @@
 #include "backup.hpp"
+#include "buffers.hpp"
+#include "catalogo.hpp"
+#include "concorrencia.hpp"
+#include "estatisticas.hpp"
+#include "limites.hpp"
+#include "objetos.hpp"
+#include "poda.hpp"
+#include "rastreamento.hpp"
+#include "remoto.hpp"
+#include "snapshot.hpp"
+#include "tar.hpp"
+#include "verificacao.hpp"
+#include "vinculos.hpp"
 #include <iostream>
 #include <string>
+#include <vector>
+#include <cctype> // Para isdigit
+#include <cerrno> // Para errno (strtoul)
+#include <climits> // Para UINT_MAX / ULONG_MAX
 #include <cstdlib> // Para EXIT_SUCCESS / EXIT_FAILURE
 #include <cstring> // Para strcmp
+#include <unistd.h> // Para isatty
 
 // ==============================================================================
 // FUNÇÃO PRINCIPAL
 // ==============================================================================
 
+static void imprime_uso(const char* programa) {
+    std::cerr << "Uso: " << programa << " <MODO> <ARQUIVO_PARAM> <ORIGEM_BASE> <DESTINO_BASE>" << std::endl;
+    std::cerr << "     " << programa << " -v <ARQUIVO_PARAM> <DESTINO_BASE>" << std::endl;
+    std::cerr << "     " << programa << " -s <DESTINO_BASE> [LEITURAS_SIMULTANEAS]" << std::endl;
+    std::cerr << "     " << programa << " -p <DESTINO_BASE> <SNAPSHOTS_A_MANTER> [THREADS]" << std::endl;
+    std::cerr << "     " << programa << " -d <DESTINO_BASE> [PORTA] [ENDERECO]" << std::endl;
+    std::cerr << "MODO: -b (Backup) ou -r (Restauracao)" << std::endl;
+    std::cerr << "Opcoes de -b/-r:" << std::endl;
+    std::cerr << "  --snapshot  -b cria DESTINO_BASE/<instante UTC>/ com hardlinks para o que nao mudou;" << std::endl;
+    std::cerr << "              -r restaura a partir do snapshot mais recente de ORIGEM_BASE" << std::endl;
+    std::cerr << "  --as-of T   -r restaura cada arquivo como estava no instante T (UTC, AAAA-MM-DD" << std::endl;
+    std::cerr << "              para o fim do dia ou AAAA-MM-DD_HHMMSS), consultando o catalogo" << std::endl;
+    std::cerr << "  -j N        numero de threads do modo snapshot (padrao 1) ou de conexoes de dados" << std::endl;
+    std::cerr << "              do backup remoto (padrao 4)" << std::endl;
+    std::cerr << "  -j auto     -b --snapshot: ajusta as copias simultaneas a cada dispositivo de origem e de" << std::endl;
+    std::cerr << "              destino pela vazao e latencia medidas (AIMD, ate " << CONCORRENCIA_ADAPTATIVA_MAXIMA << ")" << std::endl;
+    std::cerr << "  --resume    retoma uma execucao interrompida do mesmo trabalho, pulando as entradas" << std::endl;
+    std::cerr << "              ja concluidas (diario <ARQUIVO_PARAM>.<trabalho>.progresso); com --snapshot -b," << std::endl;
+    std::cerr << "              continua no snapshot interrompido mais recente (<instante>.parcial)" << std::endl;
+    std::cerr << "  --durabilidade M  quando as copias vao para o dispositivo: lote (padrao; um syncfs a" << std::endl;
+    std::cerr << "              cada 1024 arquivos ou 1 s), arquivo (fdatasync por arquivo) ou nenhuma" << std::endl;
+    std::cerr << "  --sem-cache le e grava sem deslocar o cache de paginas do host (descarta so o que a" << std::endl;
+    std::cerr << "              copia trouxe para o cache); para backups grandes em maquinas de producao" << std::endl;
+    std::cerr << "  --pipeline M  arquivos de 8 MiB ou mais sao lidos por uma thread e gravados por outra:" << std::endl;
+    std::cerr << "              auto (padrao; origem e destino em dispositivos diferentes), sempre ou nunca" << std::endl;
+    std::cerr << "  --limite-leitura T, --limite-escrita T, --limite-metadados T  limita bytes/s lidos," << std::endl;
+    std::cerr << "              gravados e operacoes/s de metadados, somando todas as threads (ex: 20M)" << std::endl;
+    std::cerr << "  --controle-limites F  le os limites de F (linhas \"leitura 20M\", \"escrita 10M\"," << std::endl;
+    std::cerr << "              \"metadados 500\") e o rele quando muda ou com SIGHUP, durante a execucao" << std::endl;
+    std::cerr << "  --ioprio-ocioso  classe de E/S ociosa: o disco so atende o backup quando esta livre" << std::endl;
+    std::cerr << "  --paginas-enormes  buffers de copia em paginas de 2 MiB (hugetlbfs ou THP)" << std::endl;
+    std::cerr << "  --stats     ao final imprime latencias por fase (p50/p99/max), casos e vazao" << std::endl;
+    std::cerr << "  --trace F   grava em F a linha do tempo por thread (formato Chrome trace/Perfetto)" << std::endl;
+    std::cerr << "  --s3-endpoint URL  servico S3 para DESTINO_BASE (-b) ou ORIGEM_BASE (-r) na forma" << std::endl;
+    std::cerr << "              s3://bucket/prefixo (padrao: $SYSBACKUP_S3_ENDPOINT ou http://127.0.0.1:9000;" << std::endl;
+    std::cerr << "              credenciais em AWS_ACCESS_KEY_ID/AWS_SECRET_ACCESS_KEY/AWS_REGION)" << std::endl;
+    std::cerr << "  DESTINO_BASE - (-b) escreve um tar (pax) na saida padrao; ORIGEM_BASE - (-r) le o tar" << std::endl;
+    std::cerr << "              da entrada padrao" << std::endl;
+    std::cerr << "  DESTINO_BASE tcp://host[:porta] faz o backup (-b) para um receptor backup_app -d" << std::endl;
+    std::cerr << "-v: verifica o backup contra o manifesto de checksums" << std::endl;
+    std::cerr << "-s: varre (scrub) todo o backup em paralelo procurando arquivos corrompidos (num destino" << std::endl;
+    std::cerr << "    --snapshot, todos os snapshots; cada arquivo vinculado entre eles e lido uma vez)" << std::endl;
+    std::cerr << "    (leituras simultaneas: numero fixo ou \"auto\")" << std::endl;
+    std::cerr << "-p: poda os snapshots antigos, mantendo os mais recentes" << std::endl;
+    std::cerr << "-d: recebe backups remotos em DESTINO_BASE (padrao 0.0.0.0:7070; sem autenticacao)" << std::endl;
+}
+
+// Leituras simultaneas padrao do scrub: suficiente para manter a fila do pen-drive
+// ocupada sem transformar a leitura sequencial em aleatoria
+static const unsigned CONCORRENCIA_SCRUB_PADRAO = 2;
+
+// Inteiro positivo e ate 'maximo', em decimal e sem sobras: "4x", "-1" e "" sao recusados
+static bool interpreta_positivo(const char* texto, unsigned long maximo, unsigned long& valor) {
+    char* fim = nullptr;
+    errno = 0;
+    valor = std::strtoul(texto, &fim, 10);
+    return std::isdigit(static_cast<unsigned char>(texto[0])) && *fim == '\0' && errno == 0 && valor > 0 &&
+           valor <= maximo;
+}
+
+static int executa_modo_scrub(const std::string& destino, unsigned concorrencia) {
+    std::cout << "MODO: Scrub (releitura completa do Pen-drive)" << std::endl;
+    RelatorioScrub relatorio;
+    ResultadoBackup resultado = executa_scrub(destino, concorrencia, relatorio);
+
+    for (const auto& arquivo : relatorio.divergentes) {
+        std::cerr << "CORROMPIDO: " << arquivo << std::endl;
+    }
+    for (const auto& arquivo : relatorio.ausentes) {
+        std::cerr << "AUSENTE: " << arquivo << std::endl;
+    }
+    for (const auto& arquivo : relatorio.ilegiveis) {
+        std::cerr << "ILEGIVEL: " << arquivo << std::endl;
+    }
+
+    double mb = static_cast<double>(relatorio.bytes) / (1024.0 * 1024.0);
+    std::cout << "Verificados: " << relatorio.verificados
+              << " | Corrompidos: " << relatorio.divergentes.size()
+              << " | Ausentes: " << relatorio.ausentes.size()
+              << " | Ilegiveis: " << relatorio.ilegiveis.size()
+              << " | Sem checksum: " << relatorio.sem_checksum
+              << (relatorio.snapshots > 0 ? " | Snapshots: " + std::to_string(relatorio.snapshots) : "") << std::endl;
+    relata_concorrencia(std::cout);
+    std::cout << "Lidos " << mb << " MB em " << relatorio.segundos << " s ("
+              << (relatorio.segundos > 0 ? mb / relatorio.segundos : 0.0) << " MB/s)" << std::endl;
+
+    if (resultado == SUCESSO) {
+        std::cout << "Scrub concluido com SUCESSO." << std::endl;
+        return EXIT_SUCCESS;
+    }
+    std::cerr << "ERRO FATAL: Scrub falhou com codigo " << resultado_para_string(resultado) << std::endl;
+    return EXIT_FAILURE;
+}
+
 int main(int argc, char* argv[]) {
-    // Verifica o numero minimo de argumentos (./backup_app -b Backup.parm origem destino)
-    if (argc != 5) {
+    // Modo de verificacao (./backup_app -v Backup.parm destino)
+    if (argc == 4 && std::strcmp(argv[1], "-v") == 0) {
+        std::cout << "MODO: Verificacao (Pen-drive x manifesto)" << std::endl;
+        ResultadoBackup resultado = executa_verificacao(argv[2], argv[3]);
+        if (resultado == SUCESSO) {
+            std::cout << "Verificacao concluida com SUCESSO." << std::endl;
+            return EXIT_SUCCESS;
+        }
+        std::cerr << "ERRO FATAL: Verificacao falhou com codigo " << resultado_para_string(resultado) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Modo de scrub (./backup_app -s destino [leituras_simultaneas|auto])
+    if ((argc == 3 || argc == 4) && std::strcmp(argv[1], "-s") == 0) {
+        unsigned concorrencia = CONCORRENCIA_SCRUB_PADRAO;
+        if (argc == 4 && std::strcmp(argv[3], "auto") == 0) {
+            define_concorrencia_adaptativa(CONCORRENCIA_ADAPTATIVA_MAXIMA);
+        } else if (argc == 4) {
+            unsigned long valor = 0;
+            if (!interpreta_positivo(argv[3], UINT_MAX, valor)) {
+                std::cerr << "ERRO: Numero de leituras simultaneas invalido." << std::endl;
+                return EXIT_FAILURE;
+            }
+            concorrencia = static_cast<unsigned>(valor);
+        }
+        return executa_modo_scrub(argv[2], concorrencia);
+    }
+
+    // Modo de poda (./backup_app -p destino snapshots_a_manter [threads])
+    if ((argc == 4 || argc == 5) && std::strcmp(argv[1], "-p") == 0) {
+        unsigned long manter = 0, trabalhadores = 1;
+        if (!interpreta_positivo(argv[3], ULONG_MAX, manter) ||
+            (argc == 5 && !interpreta_positivo(argv[4], UINT_MAX, trabalhadores))) {
+            std::cerr << "ERRO: Quantidade de snapshots ou de threads invalida." << std::endl;
+            return EXIT_FAILURE;
+        }
+        std::cout << "MODO: Poda de snapshots (mantendo " << manter << ")" << std::endl;
+        RelatorioPoda relatorio;
+        ResultadoBackup resultado = executa_poda(argv[2], manter, static_cast<unsigned>(trabalhadores), relatorio);
+        for (const auto& nome : relatorio.removidos) {
+            std::cout << "Removido: " << nome << std::endl;
+        }
+        std::cout << "Arquivos desvinculados: " << relatorio.arquivos_removidos
+                  << " | Liberados: " << relatorio.bytes_liberados / (1024.0 * 1024.0) << " MB"
+                  << " | Versoes realocadas: " << relatorio.versoes_realocadas
+                  << " | Versoes descartadas: " << relatorio.versoes_descartadas
+                  << " | " << relatorio.segundos << " s" << std::endl;
+        if (resultado == SUCESSO) {
+            std::cout << "Poda concluida com SUCESSO." << std::endl;
+            return EXIT_SUCCESS;
+        }
+        std::cerr << "ERRO FATAL: Poda falhou com codigo " << resultado_para_string(resultado) << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Modo receptor (./backup_app -d destino [porta] [endereco])
+    if (argc >= 3 && argc <= 5 && std::strcmp(argv[1], "-d") == 0) {
+        unsigned long porta = PORTA_REMOTA_PADRAO;
+        const std::string endereco = (argc == 5) ? argv[4] : "0.0.0.0";
+        if (argc >= 4 && !interpreta_positivo(argv[3], 65535, porta)) {
+            std::cerr << "ERRO: Porta invalida." << std::endl;
+            return EXIT_FAILURE;
+        }
+        try {
+            ReceptorBackup receptor(argv[2], endereco, static_cast<std::uint16_t>(porta));
+            std::cout << "MODO: Receptor de backups remotos em " << endereco << ":" << receptor.porta()
+                      << " -> " << argv[2] << std::endl;
+            receptor.aguarda();
+        } catch (const std::filesystem::filesystem_error& e) {
+            std::cerr << "ERRO FATAL: " << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
+    }
+
+    // Verifica o numero minimo de argumentos (./backup_app -b Backup.parm origem destino [opcoes])
+    if (argc < 5) {
         std::cerr << "ERRO: Numero incorreto de argumentos." << std::endl;
-        std::cerr << "Uso: " << argv[0] << " <MODO> <ARQUIVO_PARAM> <ORIGEM_BASE> <DESTINO_BASE>" << std::endl;
-        std::cerr << "MODO: -b (Backup) ou -r (Restauracao)" << std::endl;
+        imprime_uso(argv[0]);
         return EXIT_FAILURE;
     }
 
+    // Backup em fluxo tar na saida padrao: as mensagens passam para a saida de erro
+    if (std::strcmp(argv[1], "-b") == 0) {
+        for (int i = 2; i < argc; ++i) {
+            if (std::strcmp(argv[i], "-") == 0) {
+                std::cout.rdbuf(std::cerr.rdbuf());
+            }
+        }
+    }
+
     Operacao operacao;
     std::string modo_arg = argv[1];
     
@@ -32,22 +227,244 @@ int main(int argc, char* argv[]) {
         return EXIT_FAILURE;
     }
 
+    // Separa os argumentos posicionais das opcoes
+    std::vector<std::string> posicionais;
+    bool modo_snapshot = false;
+    bool restauracao_pontual = false;
+    std::time_t instante = 0;
+    unsigned trabalhadores = 1;
+    bool trabalhadores_definidos = false;
+    bool concorrencia_automatica = false;
+    bool estatisticas = false;
+    bool retomar = false;
+    std::string arquivo_rastreamento;
+    ConfiguracaoS3 configuracao_s3 = configuracao_s3_do_ambiente();
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--snapshot") {
+            modo_snapshot = true;
+        } else if (arg == "--resume") {
+            retomar = true;
+        } else if (arg == "--durabilidade" && i + 1 < argc) {
+            ModoDurabilidade modo;
+            if (!interpreta_durabilidade(argv[++i], modo)) {
+                std::cerr << "ERRO: --durabilidade aceita nenhuma, arquivo ou lote." << std::endl;
+                return EXIT_FAILURE;
+            }
+            define_durabilidade(modo);
+        } else if (arg == "--sem-cache") {
+            define_preserva_cache(true);
+        } else if (arg == "--pipeline" && i + 1 < argc) {
+            ModoPipeline modo;
+            if (!interpreta_pipeline(argv[++i], modo)) {
+                std::cerr << "ERRO: --pipeline aceita auto, sempre ou nunca." << std::endl;
+                return EXIT_FAILURE;
+            }
+            define_pipeline(modo);
+        } else if ((arg == "--limite-leitura" || arg == "--limite-escrita" || arg == "--limite-metadados") &&
+                   i + 1 < argc) {
+            double taxa;
+            if (!interpreta_taxa(argv[++i], taxa)) {
+                std::cerr << "ERRO: " << arg << " aceita uma taxa (ex: 500, 20M, 1.5G ou ilimitado)." << std::endl;
+                return EXIT_FAILURE;
+            }
+            define_limite(arg == "--limite-leitura"   ? LIMITE_LEITURA
+                          : arg == "--limite-escrita" ? LIMITE_ESCRITA
+                                                      : LIMITE_METADADOS,
+                          taxa);
+        } else if (arg == "--controle-limites" && i + 1 < argc) {
+            if (!acompanha_controle_limites(argv[++i])) {
+                std::cerr << "ERRO: Arquivo de controle de limites ausente ou invalido: " << argv[i] << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (arg == "--ioprio-ocioso") {
+            define_prioridade_ociosa();
+        } else if (arg == "--paginas-enormes") {
+            pool_blocos().define_paginas_enormes(true);
+        } else if (arg == "--stats") {
+            estatisticas = true;
+        } else if (arg == "--trace" && i + 1 < argc) {
+            arquivo_rastreamento = argv[++i];
+        } else if (arg == "--s3-endpoint" && i + 1 < argc) {
+            if (!interpreta_endpoint(argv[++i], configuracao_s3)) {
+                std::cerr << "ERRO: Endpoint S3 invalido (use http://host:porta)." << std::endl;
+                return EXIT_FAILURE;
+            }
+        } else if (arg == "--as-of" && i + 1 < argc) {
+            if (operacao != RESTAURACAO || !interpreta_instante(argv[++i], instante)) {
+                std::cerr << "ERRO: --as-of exige -r e um instante AAAA-MM-DD ou AAAA-MM-DD_HHMMSS." << std::endl;
+                return EXIT_FAILURE;
+            }
+            restauracao_pontual = true;
+        } else if (arg == "-j" && i + 1 < argc && std::strcmp(argv[i + 1], "auto") == 0) {
+            ++i;
+            concorrencia_automatica = true;
+        } else if (arg == "-j" && i + 1 < argc) {
+            unsigned long valor = 0;
+            if (!interpreta_positivo(argv[++i], UINT_MAX, valor)) {
+                std::cerr << "ERRO: Numero de threads invalido." << std::endl;
+                return EXIT_FAILURE;
+            }
+            trabalhadores = static_cast<unsigned>(valor);
+            trabalhadores_definidos = true;
+        } else {
+            posicionais.push_back(arg);
+        }
+    }
+    if (posicionais.size() != 3) {
+        std::cerr << "ERRO: Numero incorreto de argumentos." << std::endl;
+        imprime_uso(argv[0]);
+        return EXIT_FAILURE;
+    }
+
     // Argumentos corrigidos:
-    const std::string arquivo_parametros = argv[2]; // Deve ser Backup.parm
-    const std::string caminho_origem = argv[3];     // Deve ser hd_source
-    const std::string caminho_destino = argv[4];    // Deve ser pen_drive_target
+    const std::string arquivo_parametros = posicionais[0]; // Deve ser Backup.parm
+    std::string caminho_origem = posicionais[1];           // Deve ser hd_source
+    const std::string caminho_destino = posicionais[2];    // Deve ser pen_drive_target
+
+    // Bucket S3 como destino do backup ou origem da restauracao (s3://bucket/prefixo)
+    const std::string PREFIXO_S3 = "s3://";
+    const bool origem_s3 = caminho_origem.compare(0, PREFIXO_S3.size(), PREFIXO_S3) == 0;
+    const bool destino_s3 = caminho_destino.compare(0, PREFIXO_S3.size(), PREFIXO_S3) == 0;
+    if ((origem_s3 || destino_s3) && (modo_snapshot || restauracao_pontual)) {
+        std::cerr << "ERRO: --snapshot e --as-of nao se aplicam a buckets S3." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Receptor remoto como destino do backup (tcp://host:porta)
+    std::string host_remoto;
+    std::uint16_t porta_remota = 0;
+    const bool destino_remoto = interpreta_destino_remoto(caminho_destino, host_remoto, porta_remota);
+    if (caminho_origem.compare(0, 6, "tcp://") == 0 ||
+        (destino_remoto && (operacao != BACKUP || modo_snapshot || restauracao_pontual))) {
+        std::cerr << "ERRO: tcp:// so e aceito como DESTINO_BASE de um backup simples (-b)." << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (!destino_remoto && caminho_destino.compare(0, 6, "tcp://") == 0) {
+        std::cerr << "ERRO: Destino remoto invalido (use tcp://host[:porta])." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // Fluxo tar: "-" como DESTINO_BASE do backup ou ORIGEM_BASE da restauracao
+    const bool destino_tar = (operacao == BACKUP && caminho_destino == "-");
+    const bool origem_tar = (operacao == RESTAURACAO && caminho_origem == "-");
+    if ((destino_tar || origem_tar) && (modo_snapshot || restauracao_pontual)) {
+        std::cerr << "ERRO: --snapshot e --as-of nao se aplicam ao fluxo tar." << std::endl;
+        return EXIT_FAILURE;
+    }
+    if (destino_tar && ::isatty(STDOUT_FILENO)) {
+        std::cerr << "ERRO: A saida padrao e um terminal; redirecione o fluxo tar (ex: > backup.tar)." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    if (retomar && ((modo_snapshot && operacao != BACKUP) || restauracao_pontual || destino_tar || origem_tar ||
+                    destino_remoto)) {
+        std::cerr << "ERRO: --resume so se aplica ao backup/restauracao simples (inclusive S3) e ao backup"
+                  << " --snapshot." << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    // So o backup em modo snapshot reparte as copias entre dispositivos
+    if (concorrencia_automatica && !(modo_snapshot && operacao == BACKUP)) {
+        std::cerr << "ERRO: -j auto so se aplica ao backup --snapshot (e ao scrub: -s DESTINO auto)." << std::endl;
+        imprime_uso(argv[0]);
+        return EXIT_FAILURE;
+    }
+    if (concorrencia_automatica) {
+        trabalhadores = CONCORRENCIA_ADAPTATIVA_MAXIMA;
+        define_concorrencia_adaptativa(CONCORRENCIA_ADAPTATIVA_MAXIMA);
+    }
+
+    // Restauracao de snapshot: a origem passa a ser o snapshot mais recente
+    if (modo_snapshot && operacao == RESTAURACAO && !restauracao_pontual) {
+        std::vector<std::string> snapshots = lista_snapshots(caminho_origem);
+        if (snapshots.empty()) {
+            std::cerr << "ERRO FATAL: Nenhum snapshot encontrado em " << caminho_origem << std::endl;
+            return EXIT_FAILURE;
+        }
+        caminho_origem += "/" + snapshots.back();
+        std::cout << "Snapshot: " << snapshots.back() << std::endl;
+    }
 
     std::cout << "Arquivo Parametros: " << arquivo_parametros << std::endl;
     std::cout << "Base Origem: " << caminho_origem << std::endl;
     std::cout << "Base Destino: " << caminho_destino << std::endl;
     
     // Chamada da funcao principal
-    ResultadoBackup resultado = executa_backup_restauracao(
-        arquivo_parametros, 
-        caminho_origem, 
-        caminho_destino, 
-        operacao
-    );
+    ativa_estatisticas(estatisticas);
+    ativa_rastreamento(!arquivo_rastreamento.empty());
+    ResultadoBackup resultado;
+    if (modo_snapshot && operacao == BACKUP) {
+        RelatorioSnapshot relatorio;
+        resultado = executa_backup_snapshot(arquivo_parametros, caminho_origem, caminho_destino,
+                                            trabalhadores, relatorio, retomar);
+        if (!relatorio.retomado.empty()) {
+            std::cout << "Retomado: " << relatorio.retomado << ".parcial" << std::endl;
+        }
+        if (resultado == SUCESSO) {
+            std::cout << "Snapshot: " << relatorio.nome
+                      << (relatorio.anterior.empty() ? "" : " (base: " + relatorio.anterior + ")") << std::endl;
+            relata_concorrencia(std::cout);
+            std::cout << "Copiados: " << relatorio.copiados << " | Vinculados: " << relatorio.vinculados
+                      << " | Ignorados: " << relatorio.ignorados << std::endl;
+        }
+    } else if (restauracao_pontual) {
+        std::cout << "Instante (UTC): " << nome_snapshot_para(instante) << std::endl;
+        resultado = executa_restauracao_snapshot(arquivo_parametros, caminho_origem, caminho_destino, instante);
+    } else if (destino_tar || origem_tar) {
+        RelatorioTar relatorio;
+        resultado = destino_tar
+            ? executa_backup_tar(arquivo_parametros, caminho_origem, STDOUT_FILENO, relatorio)
+            : executa_restauracao_tar(arquivo_parametros, STDIN_FILENO, caminho_destino, relatorio);
+        std::cout << "Arquivos: " << relatorio.arquivos << " | Hardlinks: " << relatorio.vinculos
+                  << " | Ignorados: " << relatorio.ignorados << " | "
+                  << relatorio.bytes / (1024.0 * 1024.0) << " MB (" << relatorio.bytes_splice / (1024.0 * 1024.0)
+                  << " MB por splice) | " << relatorio.segundos << " s" << std::endl;
+    } else if (destino_remoto) {
+        RelatorioRemoto relatorio;
+        resultado = executa_backup_remoto(arquivo_parametros, caminho_origem, host_remoto, porta_remota,
+                                          trabalhadores_definidos ? trabalhadores : FLUXOS_REMOTOS_PADRAO,
+                                          relatorio);
+        std::cout << "Enviados: " << relatorio.enviados << " | Inalterados: " << relatorio.inalterados
+                  << " | Ausentes: " << relatorio.ausentes << " | "
+                  << relatorio.bytes / (1024.0 * 1024.0) << " MB | Idas e voltas: " << relatorio.idas_e_voltas
+                  << " | " << relatorio.segundos << " s" << std::endl;
+    } else if (origem_s3 || destino_s3) {
+        std::cout << "S3: " << configuracao_s3.host << ":" << configuracao_s3.porta << std::endl;
+        ArmazenamentoObjetos s3(configuracao_s3);
+        resultado = executa_backup_restauracao(
+            arquivo_parametros,
+            origem_s3 ? caminho_origem.substr(PREFIXO_S3.size()) : caminho_origem,
+            destino_s3 ? caminho_destino.substr(PREFIXO_S3.size()) : caminho_destino,
+            operacao,
+            origem_s3 ? static_cast<Armazenamento&>(s3) : armazenamento_posix(),
+            destino_s3 ? static_cast<Armazenamento&>(s3) : armazenamento_posix(),
+            retomar);
+    } else {
+        resultado = executa_backup_restauracao(
+            arquivo_parametros, 
+            caminho_origem, 
+            caminho_destino, 
+            operacao,
+            armazenamento_posix(),
+            armazenamento_posix(),
+            retomar
+        );
+    }
+
+    if (vinculos_recriados() > 0) {
+        std::cout << "Hardlinks da origem recriados no destino: " << vinculos_recriados() << std::endl;
+    }
+    if (estatisticas) {
+        imprime_estatisticas(std::cout);
+    }
+    if (!arquivo_rastreamento.empty()) {
+        ativa_rastreamento(false);
+        if (grava_rastreamento(arquivo_rastreamento) == SUCESSO) {
+            std::cout << "Rastreamento: " << arquivo_rastreamento << " (" << eventos_registrados()
+                      << " eventos)" << std::endl;
+        }
+    }
 
     if (resultado == SUCESSO) {
         std::cout << "Operação concluída com SUCESSO." << std::endl;
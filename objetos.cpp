@@ -0,0 +1,947 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "objetos.hpp"
+#include "rede.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <cctype>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <future>
+#include <map>
+#include <mutex>
+#include <system_error>
+#include <unordered_set>
+
+namespace fs = std::filesystem;
+
+using Cabecalhos = std::vector<std::pair<std::string, std::string>>;
+
+namespace {
+
+// ==============================================================================
+// SHA-256 E HMAC (assinatura AWS Signature Version 4)
+// ==============================================================================
+
+class Sha256 {
+ public:
+    void atualiza(const void* dados, std::size_t tamanho) {
+        const auto* bytes = static_cast<const std::uint8_t*>(dados);
+        total_ += tamanho;
+        while (tamanho > 0) {
+            std::size_t cabe = std::min(tamanho, sizeof(bloco_) - usados_);
+            std::memcpy(bloco_ + usados_, bytes, cabe);
+            usados_ += cabe;
+            bytes += cabe;
+            tamanho -= cabe;
+            if (usados_ == sizeof(bloco_)) {
+                processa();
+                usados_ = 0;
+            }
+        }
+    }
+
+    std::string finaliza() {
+        const std::uint64_t bits = total_ * 8;
+        const std::uint8_t marca = 0x80;
+        atualiza(&marca, 1);
+        const std::uint8_t zero = 0;
+        while (usados_ != 56) {
+            atualiza(&zero, 1);
+        }
+        std::uint8_t tamanho[8];
+        for (int i = 0; i < 8; ++i) {
+            tamanho[i] = static_cast<std::uint8_t>(bits >> (56 - 8 * i));
+        }
+        atualiza(tamanho, 8);
+
+        std::string resumo(32, '\0');
+        for (int i = 0; i < 32; ++i) {
+            resumo[i] = static_cast<char>(estado_[i / 4] >> (24 - 8 * (i % 4)));
+        }
+        return resumo;
+    }
+
+ private:
+    static std::uint32_t rotaciona(std::uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+    void processa() {
+        static const std::uint32_t K[64] = {
+            0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+            0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+            0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+            0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+            0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+            0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+            0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+            0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+        };
+        std::uint32_t w[64];
+        for (int i = 0; i < 16; ++i) {
+            w[i] = static_cast<std::uint32_t>(bloco_[4 * i]) << 24 | static_cast<std::uint32_t>(bloco_[4 * i + 1]) << 16 |
+                   static_cast<std::uint32_t>(bloco_[4 * i + 2]) << 8 | static_cast<std::uint32_t>(bloco_[4 * i + 3]);
+        }
+        for (int i = 16; i < 64; ++i) {
+            std::uint32_t s0 = rotaciona(w[i - 15], 7) ^ rotaciona(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            std::uint32_t s1 = rotaciona(w[i - 2], 17) ^ rotaciona(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+        std::uint32_t a = estado_[0], b = estado_[1], c = estado_[2], d = estado_[3];
+        std::uint32_t e = estado_[4], f = estado_[5], g = estado_[6], h = estado_[7];
+        for (int i = 0; i < 64; ++i) {
+            std::uint32_t t1 = h + (rotaciona(e, 6) ^ rotaciona(e, 11) ^ rotaciona(e, 25)) + ((e & f) ^ (~e & g)) + K[i] + w[i];
+            std::uint32_t t2 = (rotaciona(a, 2) ^ rotaciona(a, 13) ^ rotaciona(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+        estado_[0] += a;
+        estado_[1] += b;
+        estado_[2] += c;
+        estado_[3] += d;
+        estado_[4] += e;
+        estado_[5] += f;
+        estado_[6] += g;
+        estado_[7] += h;
+    }
+
+    std::uint32_t estado_[8] = {0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+                                0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19};
+    std::uint8_t bloco_[64];
+    std::size_t usados_ = 0;
+    std::uint64_t total_ = 0;
+};
+
+std::string sha256(const std::string& texto) {
+    Sha256 hash;
+    hash.atualiza(texto.data(), texto.size());
+    return hash.finaliza();
+}
+
+std::string hmac_sha256(std::string chave, const std::string& mensagem) {
+    if (chave.size() > 64) {
+        chave = sha256(chave);
+    }
+    chave.resize(64, '\0');
+    std::string interna(64, '\0'), externa(64, '\0');
+    for (std::size_t i = 0; i < 64; ++i) {
+        interna[i] = static_cast<char>(chave[i] ^ 0x36);
+        externa[i] = static_cast<char>(chave[i] ^ 0x5c);
+    }
+    return sha256(externa + sha256(interna + mensagem));
+}
+
+std::string para_hex(const std::string& bytes) {
+    static const char DIGITOS[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(bytes.size() * 2);
+    for (unsigned char c : bytes) {
+        hex += DIGITOS[c >> 4];
+        hex += DIGITOS[c & 0xf];
+    }
+    return hex;
+}
+
+std::string minusculas(std::string texto) {
+    std::transform(texto.begin(), texto.end(), texto.begin(), [](unsigned char c) { return std::tolower(c); });
+    return texto;
+}
+
+std::string apara(const std::string& texto) {
+    std::size_t inicio = texto.find_first_not_of(" \t");
+    if (inicio == std::string::npos) {
+        return std::string();
+    }
+    return texto.substr(inicio, texto.find_last_not_of(" \t") - inicio + 1);
+}
+
+// ==============================================================================
+// DATAS E ERROS
+// ==============================================================================
+
+std::string instante_iso() {
+    std::time_t agora = std::time(nullptr);
+    std::tm utc{};
+    ::gmtime_r(&agora, &utc);
+    char texto[32];
+    std::strftime(texto, sizeof(texto), "%Y%m%dT%H%M%SZ", &utc);
+    return texto;
+}
+
+/** @brief Converte "Wed, 21 Oct 2015 07:28:00 GMT" (Last-Modified). */
+bool interpreta_data_http(const std::string& texto, fs::file_time_type& data) {
+    std::tm utc{};
+    if (::strptime(texto.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &utc) == nullptr) {
+        return false;
+    }
+    data = data_de_nanos(static_cast<std::int64_t>(::timegm(&utc)) * 1000000000);
+    return true;
+}
+
+[[noreturn]] void lanca_erro(const char* operacao, const std::string& chave, int erro) {
+    throw fs::filesystem_error(operacao, chave, std::error_code(erro, std::generic_category()));
+}
+
+[[noreturn]] void lanca_erro_http(const char* operacao, const std::string& chave, int status) {
+    lanca_erro(operacao, chave, status == 404 ? ENOENT : (status == 403 ? EACCES : EIO));
+}
+
+/** @brief Chave do objeto: sem barra inicial, "./" e barras repetidas. */
+std::string chave_de(const std::string& caminho) {
+    std::string chave;
+    std::size_t i = 0;
+    while (i < caminho.size()) {
+        std::size_t fim = caminho.find('/', i);
+        if (fim == std::string::npos) {
+            fim = caminho.size();
+        }
+        if (fim > i && !(fim - i == 1 && caminho[i] == '.')) {
+            if (!chave.empty()) {
+                chave += '/';
+            }
+            chave.append(caminho, i, fim - i);
+        }
+        i = fim + 1;
+    }
+    return chave;
+}
+
+/** @brief Conteudo do primeiro elemento XML <marca> (respostas simples do S3). */
+std::string valor_xml(const std::string& xml, const std::string& marca) {
+    const std::string abre = "<" + marca + ">";
+    std::size_t inicio = xml.find(abre);
+    if (inicio == std::string::npos) {
+        return std::string();
+    }
+    inicio += abre.size();
+    std::size_t fim = xml.find("</" + marca + ">", inicio);
+    return (fim == std::string::npos) ? std::string() : xml.substr(inicio, fim - inicio);
+}
+
+const char* const META_DATA = "x-amz-meta-mtime";
+
+}  // namespace
+
+// ==============================================================================
+// FUNCOES AUXILIARES PUBLICAS
+// ==============================================================================
+
+bool interpreta_endpoint(const std::string& url, ConfiguracaoS3& configuracao) {
+    std::string resto = url;
+    if (resto.compare(0, 7, "http://") == 0) {
+        resto = resto.substr(7);
+    } else if (resto.find("://") != std::string::npos) {
+        return false;
+    }
+    resto = resto.substr(0, resto.find('/'));
+    if (resto.empty()) {
+        return false;
+    }
+
+    std::string host = resto;
+    unsigned long porta = 80;
+    std::size_t dois_pontos = resto.rfind(':');
+    if (dois_pontos != std::string::npos && resto.find(']', dois_pontos) == std::string::npos) {
+        host = resto.substr(0, dois_pontos);
+        char* fim = nullptr;
+        porta = std::strtoul(resto.c_str() + dois_pontos + 1, &fim, 10);
+        if (*fim != '\0' || porta == 0 || porta > 65535) {
+            return false;
+        }
+    }
+    if (host.size() > 2 && host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+    configuracao.host = host;
+    configuracao.porta = static_cast<std::uint16_t>(porta);
+    return !host.empty();
+}
+
+ConfiguracaoS3 configuracao_s3_do_ambiente() {
+    ConfiguracaoS3 configuracao;
+    if (const char* endpoint = std::getenv("SYSBACKUP_S3_ENDPOINT")) {
+        interpreta_endpoint(endpoint, configuracao);
+    }
+    if (const char* chave = std::getenv("AWS_ACCESS_KEY_ID")) {
+        configuracao.chave_acesso = chave;
+    }
+    if (const char* segredo = std::getenv("AWS_SECRET_ACCESS_KEY")) {
+        configuracao.chave_secreta = segredo;
+    }
+    if (const char* regiao = std::getenv("AWS_REGION")) {
+        configuracao.regiao = regiao;
+    }
+    return configuracao;
+}
+
+std::string codifica_uri(const std::string& texto, bool mantem_barras) {
+    static const char DIGITOS[] = "0123456789ABCDEF";
+    std::string codificado;
+    codificado.reserve(texto.size());
+    for (unsigned char c : texto) {
+        if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~' || (mantem_barras && c == '/')) {
+            codificado += static_cast<char>(c);
+        } else {
+            codificado += '%';
+            codificado += DIGITOS[c >> 4];
+            codificado += DIGITOS[c & 0xf];
+        }
+    }
+    return codificado;
+}
+
+std::string decodifica_uri(const std::string& texto) {
+    std::string decodificado;
+    decodificado.reserve(texto.size());
+    for (std::size_t i = 0; i < texto.size(); ++i) {
+        if (texto[i] == '%' && i + 2 < texto.size() && std::isxdigit(static_cast<unsigned char>(texto[i + 1])) &&
+            std::isxdigit(static_cast<unsigned char>(texto[i + 2]))) {
+            decodificado += static_cast<char>(std::strtoul(texto.substr(i + 1, 2).c_str(), nullptr, 16));
+            i += 2;
+        } else {
+            decodificado += texto[i];
+        }
+    }
+    return decodificado;
+}
+
+std::string assina_requisicao_s3(const std::string& metodo, const std::string& caminho, const std::string& consulta,
+                                 const Cabecalhos& cabecalhos, const ConfiguracaoS3& configuracao,
+                                 const std::string& instante) {
+    assert(instante.size() >= 8);
+
+    // Query string canonica: parametros ordenados, sempre na forma chave=valor
+    std::vector<std::string> parametros;
+    for (std::size_t i = 0; i <= consulta.size() && !consulta.empty();) {
+        std::size_t fim = consulta.find('&', i);
+        if (fim == std::string::npos) {
+            fim = consulta.size();
+        }
+        std::string parametro = consulta.substr(i, fim - i);
+        if (parametro.find('=') == std::string::npos) {
+            parametro += '=';
+        }
+        parametros.push_back(parametro);
+        i = fim + 1;
+    }
+    std::sort(parametros.begin(), parametros.end());
+    std::string consulta_canonica;
+    for (const auto& parametro : parametros) {
+        consulta_canonica += (consulta_canonica.empty() ? "" : "&") + parametro;
+    }
+
+    std::map<std::string, std::string> ordenados;
+    for (const auto& [nome, valor] : cabecalhos) {
+        ordenados[minusculas(nome)] = apara(valor);
+    }
+    std::string canonicos, assinados;
+    for (const auto& [nome, valor] : ordenados) {
+        canonicos += nome + ":" + valor + "\n";
+        assinados += (assinados.empty() ? "" : ";") + nome;
+    }
+
+    const std::string requisicao_canonica = metodo + "\n" + caminho + "\n" + consulta_canonica + "\n" + canonicos +
+                                            "\n" + assinados + "\n" + ordenados["x-amz-content-sha256"];
+    const std::string dia = instante.substr(0, 8);
+    const std::string escopo = dia + "/" + configuracao.regiao + "/s3/aws4_request";
+    const std::string texto_a_assinar =
+        "AWS4-HMAC-SHA256\n" + instante + "\n" + escopo + "\n" + para_hex(sha256(requisicao_canonica));
+
+    std::string chave = hmac_sha256("AWS4" + configuracao.chave_secreta, dia);
+    chave = hmac_sha256(chave, configuracao.regiao);
+    chave = hmac_sha256(chave, "s3");
+    chave = hmac_sha256(chave, "aws4_request");
+    return "AWS4-HMAC-SHA256 Credential=" + configuracao.chave_acesso + "/" + escopo + ",SignedHeaders=" + assinados +
+           ",Signature=" + para_hex(hmac_sha256(chave, texto_a_assinar));
+}
+
+// ==============================================================================
+// CLIENTE HTTP/1.1 DO S3
+// ==============================================================================
+
+namespace {
+
+struct RespostaHttp {
+    int status = 0;
+    std::map<std::string, std::string> cabecalhos;  ///< Nomes em minusculas.
+    std::string corpo;
+
+    std::string cabecalho(const std::string& nome) const {
+        auto it = cabecalhos.find(nome);
+        return (it == cabecalhos.end()) ? std::string() : it->second;
+    }
+    bool mantem_conexao() const { return minusculas(cabecalho("connection")) != "close"; }
+};
+
+}  // namespace
+
+/**
+ * @brief Estado compartilhado entre o ArmazenamentoObjetos e seus leitores e escritores:
+ * conexoes ociosas (keep-alive), contadores e o lote de consultas antecipadas.
+ */
+class ClienteS3 {
+ public:
+    explicit ClienteS3(const ConfiguracaoS3& configuracao) : configuracao_(configuracao) {}
+
+    const ConfiguracaoS3& configuracao() const { return configuracao_; }
+
+    /** @brief Texto da requisicao (linha inicial e cabecalhos), ja assinado. */
+    std::string monta(const std::string& metodo, const std::string& chave, const std::string& consulta,
+                      const Cabecalhos& extras, std::size_t tamanho_corpo) const {
+        const std::string caminho = "/" + codifica_uri(chave, true);
+        Cabecalhos cabecalhos = {
+            {"host", configuracao_.host + (configuracao_.porta == 80 ? "" : ":" + std::to_string(configuracao_.porta))},
+            {"x-amz-content-sha256", "UNSIGNED-PAYLOAD"},
+            {"x-amz-date", instante_iso()},
+        };
+        if (metodo == "PUT" || metodo == "POST") {
+            cabecalhos.emplace_back("content-length", std::to_string(tamanho_corpo));
+        }
+        cabecalhos.insert(cabecalhos.end(), extras.begin(), extras.end());
+
+        std::string texto = metodo + " " + caminho + (consulta.empty() ? "" : "?" + consulta) + " HTTP/1.1\r\n";
+        for (const auto& [nome, valor] : cabecalhos) {
+            texto += nome + ": " + valor + "\r\n";
+        }
+        if (!configuracao_.chave_acesso.empty()) {
+            texto += "authorization: " +
+                     assina_requisicao_s3(metodo, caminho, consulta, cabecalhos, configuracao_, cabecalhos[2].second) +
+                     "\r\n";
+        }
+        return texto + "\r\n";
+    }
+
+    std::unique_ptr<ConexaoTcp> pega_conexao(bool& reutilizada) {
+        {
+            std::lock_guard<std::mutex> trava(mutex_conexoes_);
+            if (!livres_.empty()) {
+                std::unique_ptr<ConexaoTcp> conexao = std::move(livres_.back());
+                livres_.pop_back();
+                reutilizada = true;
+                return conexao;
+            }
+        }
+        reutilizada = false;
+        return std::make_unique<ConexaoTcp>(ConexaoTcp::conecta(configuracao_.host, configuracao_.porta));
+    }
+
+    void devolve_conexao(std::unique_ptr<ConexaoTcp> conexao) {
+        std::lock_guard<std::mutex> trava(mutex_conexoes_);
+        livres_.push_back(std::move(conexao));
+    }
+
+    static void le_cabecalhos(ConexaoTcp& conexao, RespostaHttp& resposta) {
+        std::string linha;
+        if (!conexao.le_linha(linha)) {
+            lanca_erro("s3", "resposta", ECONNRESET);
+        }
+        // HTTP/1.1 200 OK
+        std::size_t espaco = linha.find(' ');
+        resposta.status = (espaco == std::string::npos) ? 0 : std::atoi(linha.c_str() + espaco + 1);
+        if (resposta.status == 0) {
+            lanca_erro("s3", "resposta", EPROTO);
+        }
+        while (conexao.le_linha(linha) && !linha.empty()) {
+            std::size_t dois_pontos = linha.find(':');
+            if (dois_pontos != std::string::npos) {
+                resposta.cabecalhos[minusculas(linha.substr(0, dois_pontos))] = apara(linha.substr(dois_pontos + 1));
+            }
+        }
+    }
+
+    /** @return false se o corpo so termina com o fim da conexao (que nao pode ser reutilizada). */
+    static bool le_corpo(ConexaoTcp& conexao, RespostaHttp& resposta) {
+        if (resposta.status == 204 || resposta.status == 304) {
+            return true;
+        }
+        const std::string tamanho = resposta.cabecalho("content-length");
+        if (!tamanho.empty()) {
+            resposta.corpo.resize(std::strtoull(tamanho.c_str(), nullptr, 10));
+            conexao.le_exato(&resposta.corpo[0], resposta.corpo.size());
+            return true;
+        }
+        if (minusculas(resposta.cabecalho("transfer-encoding")) == "chunked") {
+            std::string linha;
+            for (;;) {
+                if (!conexao.le_linha(linha)) {
+                    lanca_erro("s3", "resposta", ECONNRESET);
+                }
+                std::size_t pedaco = std::strtoull(linha.c_str(), nullptr, 16);
+                if (pedaco == 0) {
+                    while (conexao.le_linha(linha) && !linha.empty()) {
+                    }
+                    return true;
+                }
+                std::size_t inicio = resposta.corpo.size();
+                resposta.corpo.resize(inicio + pedaco);
+                conexao.le_exato(&resposta.corpo[inicio], pedaco);
+                conexao.le_linha(linha);
+            }
+        }
+        char buffer[16 * 1024];
+        for (std::size_t lidos; (lidos = conexao.le_alguns(buffer, sizeof(buffer))) > 0;) {
+            resposta.corpo.append(buffer, lidos);
+        }
+        return false;
+    }
+
+    /**
+     * @brief Envia a requisicao e le a resposta completa.
+     * @details Uma conexao ociosa pode ter sido fechada pelo servidor; nesse caso a
+     * requisicao e repetida uma vez em uma conexao nova.
+     */
+    RespostaHttp executa(const std::string& metodo, const std::string& chave, const std::string& consulta,
+                         const Cabecalhos& extras, const char* corpo, std::size_t tamanho) {
+        const std::string cabecalho = monta(metodo, chave, consulta, extras, tamanho);
+        for (int tentativa = 0;; ++tentativa) {
+            bool reutilizada = false;
+            std::unique_ptr<ConexaoTcp> conexao = pega_conexao(reutilizada);
+            try {
+                conexao->envia(cabecalho);
+                if (tamanho > 0) {
+                    conexao->envia(corpo, tamanho);
+                }
+                ++requisicoes_;
+                ++idas_e_voltas_;
+                RespostaHttp resposta;
+                le_cabecalhos(*conexao, resposta);
+                bool reutilizavel = (metodo == "HEAD") || le_corpo(*conexao, resposta);
+                if (reutilizavel && resposta.mantem_conexao()) {
+                    devolve_conexao(std::move(conexao));
+                }
+                return resposta;
+            } catch (const fs::filesystem_error&) {
+                if (!reutilizada || tentativa > 0) {
+                    throw;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Envia varios HEADs de uma vez na mesma conexao (pipeline HTTP/1.1).
+     * @return Respostas na ordem das chaves (pode ter menos se o servidor fechou a conexao).
+     */
+    std::vector<RespostaHttp> consulta_em_pipeline(const std::vector<std::string>& chaves) {
+        std::string lote;
+        for (const auto& chave : chaves) {
+            lote += monta("HEAD", chave, "", {}, 0);
+        }
+        for (int tentativa = 0;; ++tentativa) {
+            bool reutilizada = false;
+            std::unique_ptr<ConexaoTcp> conexao = pega_conexao(reutilizada);
+            std::vector<RespostaHttp> respostas;
+            try {
+                conexao->envia(lote);
+                requisicoes_ += chaves.size();
+                ++idas_e_voltas_;
+                bool mantem = true;
+                while (respostas.size() < chaves.size() && mantem) {
+                    respostas.emplace_back();
+                    le_cabecalhos(*conexao, respostas.back());
+                    mantem = respostas.back().mantem_conexao();
+                }
+                if (mantem) {
+                    devolve_conexao(std::move(conexao));
+                }
+                return respostas;
+            } catch (const fs::filesystem_error&) {
+                if (!reutilizada || tentativa > 0) {
+                    if (!respostas.empty()) {
+                        respostas.pop_back();  // Resposta incompleta
+                    }
+                    return respostas;
+                }
+            }
+        }
+    }
+
+    /** @brief Estado de um objeto a partir da resposta do HEAD. */
+    static EstadoArquivo estado_de(const RespostaHttp& resposta, const std::string& chave) {
+        EstadoArquivo estado;
+        if (resposta.status == 404) {
+            return estado;
+        }
+        if (resposta.status != 200) {
+            lanca_erro_http("s3 HEAD", chave, resposta.status);
+        }
+        estado.existe = true;
+        estado.tamanho = std::strtoull(resposta.cabecalho("content-length").c_str(), nullptr, 10);
+        const std::string data = resposta.cabecalho(META_DATA);
+        if (!data.empty()) {
+            estado.modificacao = data_de_nanos(std::strtoll(data.c_str(), nullptr, 10));
+        } else if (!interpreta_data_http(resposta.cabecalho("last-modified"), estado.modificacao)) {
+            estado.modificacao = data_de_nanos(0);
+        }
+        return estado;
+    }
+
+    /** @brief Atualiza a consulta antecipada de 'chave', se ela faz parte do lote atual. */
+    void atualiza_consulta(const std::string& chave, const EstadoArquivo* estado) {
+        std::lock_guard<std::mutex> trava(mutex_);
+        auto it = consultas_.find(chave);
+        if (it == consultas_.end()) {
+            return;
+        }
+        if (estado != nullptr) {
+            it->second = *estado;
+        } else {
+            consultas_.erase(it);
+        }
+    }
+
+    std::atomic<std::uint64_t> requisicoes_{0};
+    std::atomic<std::uint64_t> idas_e_voltas_{0};
+
+    std::mutex mutex_;
+    std::unordered_map<std::string, EstadoArquivo> consultas_;  ///< Lote antecipado atual.
+    std::unordered_set<std::string> diretorios_;                ///< Prefixos "criados".
+
+ private:
+    const ConfiguracaoS3 configuracao_;
+    std::mutex mutex_conexoes_;
+    std::vector<std::unique_ptr<ConexaoTcp>> livres_;
+};
+
+namespace {
+
+/** @brief Corpo de um GET lido direto da conexao, sem copia intermediaria. */
+class LeitorObjeto : public LeitorArquivo {
+ public:
+    LeitorObjeto(std::shared_ptr<ClienteS3> cliente, std::unique_ptr<ConexaoTcp> conexao, std::uintmax_t tamanho,
+                 bool reutilizavel, std::string chave)
+        : cliente_(std::move(cliente)), conexao_(std::move(conexao)), restante_(tamanho),
+          reutilizavel_(reutilizavel), chave_(std::move(chave)) {
+        devolve_se_terminou();
+    }
+
+    std::size_t le(char* buffer, std::size_t tamanho) override {
+        if (restante_ == 0) {
+            return 0;
+        }
+        std::size_t pedido = static_cast<std::size_t>(std::min<std::uintmax_t>(tamanho, restante_));
+        std::size_t lidos = conexao_->le_alguns(buffer, pedido);
+        if (lidos == 0) {
+            lanca_erro("s3 GET", chave_, ECONNRESET);
+        }
+        restante_ -= lidos;
+        devolve_se_terminou();
+        return lidos;
+    }
+
+ private:
+    void devolve_se_terminou() {
+        if (restante_ == 0 && conexao_ && reutilizavel_) {
+            cliente_->devolve_conexao(std::move(conexao_));
+        }
+    }
+
+    std::shared_ptr<ClienteS3> cliente_;
+    std::unique_ptr<ConexaoTcp> conexao_;  ///< Descartada (fechada) se a leitura parar no meio.
+    std::uintmax_t restante_;
+    bool reutilizavel_;
+    std::string chave_;
+};
+
+/** @brief Corpo ja lido por inteiro (respostas sem Content-Length). */
+class LeitorTexto : public LeitorArquivo {
+ public:
+    explicit LeitorTexto(std::string texto) : texto_(std::move(texto)) {}
+
+    std::size_t le(char* buffer, std::size_t tamanho) override {
+        std::size_t copiados = std::min(tamanho, texto_.size() - posicao_);
+        std::memcpy(buffer, texto_.data() + posicao_, copiados);
+        posicao_ += copiados;
+        return copiados;
+    }
+
+ private:
+    std::string texto_;
+    std::size_t posicao_ = 0;
+};
+
+/**
+ * @brief Envia o objeto com um PUT ou, a partir da primeira parte completa, em upload
+ * multipart com ate ConfiguracaoS3::partes_simultaneas partes em voo.
+ */
+class EscritorObjeto : public EscritorArquivo {
+ public:
+    EscritorObjeto(std::shared_ptr<ClienteS3> cliente, std::string chave)
+        : cliente_(std::move(cliente)), chave_(std::move(chave)),
+          tamanho_parte_(std::max<std::size_t>(cliente_->configuracao().tamanho_parte, 1)) {}
+
+    ~EscritorObjeto() override {
+        if (concluido_ || upload_.empty()) {
+            return;
+        }
+        // Escrita abandonada: espera as partes em voo e descarta o upload no servidor
+        for (auto& parte : pendentes_) {
+            parte.wait();
+        }
+        try {
+            cliente_->executa("DELETE", chave_, "uploadId=" + codifica_uri(upload_, false), {}, nullptr, 0);
+        } catch (const fs::filesystem_error&) {
+        }
+    }
+
+    bool define_data(fs::file_time_type data) override {
+        if (!upload_.empty()) {
+            return false;  // Metadados ja enviados no inicio do multipart
+        }
+        data_ = nanos_desde_epoca(data);
+        tem_data_ = true;
+        return true;
+    }
+
+    void escreve(const char* dados, std::size_t tamanho) override {
+        while (tamanho > 0) {
+            std::size_t cabe = std::min(tamanho, tamanho_parte_ - buffer_.size());
+            buffer_.insert(buffer_.end(), dados, dados + cabe);
+            dados += cabe;
+            tamanho -= cabe;
+            total_ += cabe;
+            if (buffer_.size() == tamanho_parte_) {
+                envia_parte();
+            }
+        }
+    }
+
+    void fecha() override {
+        if (upload_.empty()) {
+            RespostaHttp resposta = cliente_->executa("PUT", chave_, "", metadados(), buffer_.data(), buffer_.size());
+            if (resposta.status != 200) {
+                lanca_erro_http("s3 PUT", chave_, resposta.status);
+            }
+        } else {
+            if (!buffer_.empty()) {
+                envia_parte();
+            }
+            while (!pendentes_.empty()) {
+                etags_.push_back(pendentes_.front().get());
+                pendentes_.pop_front();
+            }
+            std::string xml = "<CompleteMultipartUpload>";
+            for (std::size_t i = 0; i < etags_.size(); ++i) {
+                xml += "<Part><PartNumber>" + std::to_string(i + 1) + "</PartNumber><ETag>" + etags_[i] +
+                       "</ETag></Part>";
+            }
+            xml += "</CompleteMultipartUpload>";
+            RespostaHttp resposta = cliente_->executa("POST", chave_, "uploadId=" + codifica_uri(upload_, false), {},
+                                                      xml.data(), xml.size());
+            // O S3 pode responder 200 e reportar a falha no corpo
+            if (resposta.status != 200 || resposta.corpo.find("<Error>") != std::string::npos) {
+                lanca_erro_http("s3 CompleteMultipartUpload", chave_, resposta.status == 200 ? 500 : resposta.status);
+            }
+        }
+        concluido_ = true;
+
+        EstadoArquivo estado;
+        estado.existe = true;
+        estado.tamanho = total_;
+        estado.modificacao = data_de_nanos(data_);
+        cliente_->atualiza_consulta(chave_, tem_data_ ? &estado : nullptr);
+    }
+
+ private:
+    Cabecalhos metadados() const {
+        return tem_data_ ? Cabecalhos{{META_DATA, std::to_string(data_)}} : Cabecalhos{};
+    }
+
+    void envia_parte() {
+        if (upload_.empty()) {
+            RespostaHttp resposta = cliente_->executa("POST", chave_, "uploads", metadados(), nullptr, 0);
+            upload_ = valor_xml(resposta.corpo, "UploadId");
+            if (resposta.status != 200 || upload_.empty()) {
+                lanca_erro_http("s3 CreateMultipartUpload", chave_, resposta.status == 200 ? 500 : resposta.status);
+            }
+        }
+        // Limita as partes em voo (e a memoria: uma parte por envio)
+        const std::size_t limite = std::max(1u, cliente_->configuracao().partes_simultaneas);
+        while (pendentes_.size() >= limite) {
+            etags_.push_back(pendentes_.front().get());
+            pendentes_.pop_front();
+        }
+
+        auto dados = std::make_shared<std::vector<char>>(std::move(buffer_));
+        buffer_.clear();
+        const std::string consulta =
+            "partNumber=" + std::to_string(++partes_) + "&uploadId=" + codifica_uri(upload_, false);
+        std::shared_ptr<ClienteS3> cliente = cliente_;
+        std::string chave = chave_;
+        pendentes_.push_back(std::async(std::launch::async, [cliente, chave, consulta, dados] {
+            RespostaHttp resposta = cliente->executa("PUT", chave, consulta, {}, dados->data(), dados->size());
+            if (resposta.status != 200) {
+                lanca_erro_http("s3 UploadPart", chave, resposta.status);
+            }
+            return resposta.cabecalho("etag");
+        }));
+    }
+
+    std::shared_ptr<ClienteS3> cliente_;
+    std::string chave_;
+    std::size_t tamanho_parte_;
+    std::vector<char> buffer_;
+    std::uintmax_t total_ = 0;
+    std::int64_t data_ = 0;
+    bool tem_data_ = false;
+    bool concluido_ = false;
+    std::string upload_;
+    int partes_ = 0;
+    std::deque<std::future<std::string>> pendentes_;
+    std::vector<std::string> etags_;
+};
+
+}  // namespace
+
+// ==============================================================================
+// ARMAZENAMENTO EM OBJETOS
+// ==============================================================================
+
+ArmazenamentoObjetos::ArmazenamentoObjetos(const ConfiguracaoS3& configuracao)
+    : cliente_(std::make_shared<ClienteS3>(configuracao)) {}
+
+ArmazenamentoObjetos::~ArmazenamentoObjetos() = default;
+
+EstadoArquivo ArmazenamentoObjetos::consulta(const std::string& caminho) {
+    const std::string chave = chave_de(caminho);
+    EstadoArquivo estado;
+    if (chave.find('/') == std::string::npos) {
+        // O proprio bucket
+        estado.existe = estado.diretorio = !chave.empty();
+        return estado;
+    }
+    {
+        std::lock_guard<std::mutex> trava(cliente_->mutex_);
+        if (cliente_->diretorios_.count(chave) != 0) {
+            estado.existe = estado.diretorio = true;
+            return estado;
+        }
+        auto antecipada = cliente_->consultas_.find(chave);
+        if (antecipada != cliente_->consultas_.end()) {
+            return antecipada->second;
+        }
+    }
+    return ClienteS3::estado_de(cliente_->executa("HEAD", chave, "", {}, nullptr, 0), chave);
+}
+
+void ArmazenamentoObjetos::antecipa_consultas(const std::vector<std::string>& caminhos) {
+    std::vector<std::string> chaves;
+    chaves.reserve(caminhos.size());
+    {
+        std::lock_guard<std::mutex> trava(cliente_->mutex_);
+        cliente_->consultas_.clear();
+        for (const auto& caminho : caminhos) {
+            std::string chave = chave_de(caminho);
+            if (chave.find('/') != std::string::npos && cliente_->diretorios_.count(chave) == 0) {
+                chaves.push_back(std::move(chave));
+            }
+        }
+    }
+    if (chaves.empty()) {
+        return;
+    }
+
+    std::vector<RespostaHttp> respostas;
+    try {
+        respostas = cliente_->consulta_em_pipeline(chaves);
+    } catch (const fs::filesystem_error&) {
+        return;  // A consulta individual reporta a falha
+    }
+    std::lock_guard<std::mutex> trava(cliente_->mutex_);
+    for (std::size_t i = 0; i < respostas.size(); ++i) {
+        if (respostas[i].status == 200 || respostas[i].status == 404) {
+            cliente_->consultas_[chaves[i]] = ClienteS3::estado_de(respostas[i], chaves[i]);
+        }
+    }
+}
+
+std::unique_ptr<LeitorArquivo> ArmazenamentoObjetos::abre_leitura(const std::string& caminho) {
+    const std::string chave = chave_de(caminho);
+    const std::string requisicao = cliente_->monta("GET", chave, "", {}, 0);
+    for (int tentativa = 0;; ++tentativa) {
+        bool reutilizada = false;
+        std::unique_ptr<ConexaoTcp> conexao = cliente_->pega_conexao(reutilizada);
+        try {
+            conexao->envia(requisicao);
+            ++cliente_->requisicoes_;
+            ++cliente_->idas_e_voltas_;
+            RespostaHttp resposta;
+            ClienteS3::le_cabecalhos(*conexao, resposta);
+            const std::string tamanho = resposta.cabecalho("content-length");
+            if (resposta.status == 200 && !tamanho.empty()) {
+                return std::make_unique<LeitorObjeto>(cliente_, std::move(conexao),
+                                                      std::strtoull(tamanho.c_str(), nullptr, 10),
+                                                      resposta.mantem_conexao(), chave);
+            }
+            ClienteS3::le_corpo(*conexao, resposta);
+            if (resposta.status != 200) {
+                lanca_erro_http("s3 GET", chave, resposta.status);
+            }
+            return std::make_unique<LeitorTexto>(std::move(resposta.corpo));
+        } catch (const fs::filesystem_error& erro) {
+            if (!reutilizada || tentativa > 0 || erro.code().value() == ENOENT || erro.code().value() == EACCES) {
+                throw;
+            }
+        }
+    }
+}
+
+std::unique_ptr<EscritorArquivo> ArmazenamentoObjetos::abre_escrita(const std::string& caminho) {
+    return std::make_unique<EscritorObjeto>(cliente_, chave_de(caminho));
+}
+
+void ArmazenamentoObjetos::cria_diretorios(const std::string& caminho) {
+    std::string chave = chave_de(caminho);
+    std::lock_guard<std::mutex> trava(cliente_->mutex_);
+    while (chave.find('/') != std::string::npos && cliente_->diretorios_.insert(chave).second) {
+        chave.erase(chave.rfind('/'));
+    }
+}
+
+void ArmazenamentoObjetos::renomeia(const std::string& de, const std::string& para) {
+    const std::string origem = chave_de(de);
+    const std::string destino = chave_de(para);
+    RespostaHttp copia = cliente_->executa("PUT", destino, "", {{"x-amz-copy-source", "/" + codifica_uri(origem, true)}},
+                                           nullptr, 0);
+    if (copia.status != 200 || copia.corpo.find("<Error>") != std::string::npos) {
+        lanca_erro_http("s3 CopyObject", origem, copia.status == 200 ? 500 : copia.status);
+    }
+    RespostaHttp remocao = cliente_->executa("DELETE", origem, "", {}, nullptr, 0);
+    if (remocao.status != 204 && remocao.status != 200) {
+        lanca_erro_http("s3 DELETE", origem, remocao.status);
+    }
+    cliente_->atualiza_consulta(origem, nullptr);
+    cliente_->atualiza_consulta(destino, nullptr);
+}
+
+void ArmazenamentoObjetos::define_data(const std::string& caminho, fs::file_time_type data) {
+    const std::string chave = chave_de(caminho);
+    const Cabecalhos cabecalhos = {
+        {"x-amz-copy-source", "/" + codifica_uri(chave, true)},
+        {"x-amz-metadata-directive", "REPLACE"},
+        {META_DATA, std::to_string(nanos_desde_epoca(data))},
+    };
+    RespostaHttp resposta = cliente_->executa("PUT", chave, "", cabecalhos, nullptr, 0);
+    if (resposta.status != 200 || resposta.corpo.find("<Error>") != std::string::npos) {
+        lanca_erro_http("s3 CopyObject", chave, resposta.status == 200 ? 500 : resposta.status);
+    }
+    cliente_->atualiza_consulta(chave, nullptr);
+}
+
+std::uint64_t ArmazenamentoObjetos::requisicoes() const {
+    return cliente_->requisicoes_;
+}
+
+std::uint64_t ArmazenamentoObjetos::idas_e_voltas() const {
+    return cliente_->idas_e_voltas_;
+}
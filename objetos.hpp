@@ -0,0 +1,92 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef OBJETOS_HPP
+#define OBJETOS_HPP
+
+#include "armazenamento.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Endereco e credenciais de um servico compativel com S3 (MinIO, Ceph RGW, AWS).
+ * @details Os caminhos do ArmazenamentoObjetos sao "bucket/chave" (enderecamento por
+ * caminho, sem TLS: use um proxy local para HTTPS).
+ */
+struct ConfiguracaoS3 {
+    std::string host = "127.0.0.1";
+    std::uint16_t porta = 9000;
+    std::string chave_acesso;   ///< Vazia: requisicoes anonimas (sem assinatura).
+    std::string chave_secreta;
+    std::string regiao = "us-east-1";
+    std::size_t tamanho_parte = 8 * 1024 * 1024;  ///< Parte do upload multipart (minimo do S3: 5 MiB).
+    unsigned partes_simultaneas = 4;              ///< Partes enviadas em paralelo por arquivo.
+};
+
+/**
+ * @brief Interpreta "http://host:porta" (porta padrao 80) em configuracao.host/porta.
+ * @return false se a URL nao e http:// ou a porta e invalida.
+ */
+bool interpreta_endpoint(const std::string& url, ConfiguracaoS3& configuracao);
+
+/**
+ * @brief Le o endpoint de SYSBACKUP_S3_ENDPOINT e as credenciais de AWS_ACCESS_KEY_ID,
+ * AWS_SECRET_ACCESS_KEY e AWS_REGION, quando definidos.
+ */
+ConfiguracaoS3 configuracao_s3_do_ambiente();
+
+/** @brief Codifica um caminho para URL (RFC 3986); as barras sao mantidas se pedido. */
+std::string codifica_uri(const std::string& texto, bool mantem_barras);
+std::string decodifica_uri(const std::string& texto);
+
+/**
+ * @brief Valor do cabecalho Authorization (AWS Signature Version 4).
+ * @param caminho Caminho ja codificado (ex: "/bucket/pasta/a.txt").
+ * @param consulta Query string ja codificada, sem "?" (ex: "partNumber=1&uploadId=x").
+ * @param cabecalhos Todos os cabecalhos enviados (todos sao assinados); deve conter host,
+ * x-amz-date e x-amz-content-sha256, cujo valor e usado como hash do corpo.
+ * @param instante Data da requisicao no formato AAAAMMDDTHHMMSSZ (igual a x-amz-date).
+ */
+std::string assina_requisicao_s3(const std::string& metodo, const std::string& caminho, const std::string& consulta,
+                                 const std::vector<std::pair<std::string, std::string>>& cabecalhos,
+                                 const ConfiguracaoS3& configuracao, const std::string& instante);
+
+class ClienteS3;
+
+/**
+ * @brief Destino (ou origem) de backup em um bucket compativel com S3.
+ * @details A data de modificacao de cada arquivo vai no metadado x-amz-meta-mtime, entao
+ * a tabela de decisao compara datas com um HEAD, sem baixar o objeto. As consultas de
+ * um lote (antecipa_consultas) seguem em pipeline HTTP/1.1 na mesma conexao: uma ida e
+ * volta por lote em vez de uma por arquivo. Arquivos maiores que uma parte usam upload
+ * multipart com partes em paralelo. Diretorios nao existem no S3: cria_diretorios so
+ * registra o prefixo localmente.
+ */
+class ArmazenamentoObjetos : public Armazenamento {
+ public:
+    explicit ArmazenamentoObjetos(const ConfiguracaoS3& configuracao);
+    ~ArmazenamentoObjetos() override;
+
+    EstadoArquivo consulta(const std::string& caminho) override;
+    std::unique_ptr<LeitorArquivo> abre_leitura(const std::string& caminho) override;
+    std::unique_ptr<EscritorArquivo> abre_escrita(const std::string& caminho) override;
+    void cria_diretorios(const std::string& caminho) override;
+    /** @brief Copia no servidor seguida de DELETE da origem (nao e atomico). */
+    void renomeia(const std::string& de, const std::string& para) override;
+    /** @brief Reescreve os metadados com uma copia do objeto sobre ele mesmo. */
+    void define_data(const std::string& caminho, std::filesystem::file_time_type data) override;
+    void antecipa_consultas(const std::vector<std::string>& caminhos) override;
+
+    /** @brief Requisicoes HTTP enviadas. */
+    std::uint64_t requisicoes() const;
+    /** @brief Esperas por resposta do servidor (um lote em pipeline conta uma vez). */
+    std::uint64_t idas_e_voltas() const;
+
+ private:
+    std::shared_ptr<ClienteS3> cliente_;
+};
+
+#endif  // OBJETOS_HPP
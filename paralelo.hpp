@@ -0,0 +1,56 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef PARALELO_HPP
+#define PARALELO_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Executa tarefa(i) para i em [0, total) usando ate 'trabalhadores' threads.
+ * @details Os indices sao distribuidos dinamicamente por um contador atomico, de modo
+ * que arquivos grandes nao deixam as demais threads ociosas. O numero de threads e
+ * tambem o limite de operacoes de E/S simultaneas.
+ * @param total Quantidade de itens.
+ * @param trabalhadores Numero maximo de threads (0 e tratado como 1).
+ * @param tarefa Funcao chamada como tarefa(indice, numero_da_thread).
+ * @pre A tarefa deve ser segura para execucao concorrente em indices distintos.
+ */
+template <typename Tarefa>
+void executa_em_paralelo(std::size_t total, unsigned trabalhadores, Tarefa tarefa) {
+    unsigned n = std::max(1u, trabalhadores);
+    if (total < n) {
+        n = static_cast<unsigned>(std::max<std::size_t>(1, total));
+    }
+
+    std::atomic<std::size_t> proximo{0};
+    auto laco = [&](unsigned id) {
+        for (;;) {
+            std::size_t i = proximo.fetch_add(1, std::memory_order_relaxed);
+            if (i >= total) {
+                return;
+            }
+            tarefa(i, id);
+        }
+    };
+
+    if (n == 1) {
+        laco(0);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    threads.reserve(n - 1);
+    for (unsigned id = 1; id < n; ++id) {
+        threads.emplace_back(laco, id);
+    }
+    laco(0);  // A thread chamadora tambem trabalha
+    for (auto& t : threads) {
+        t.join();
+    }
+}
+
+#endif  // PARALELO_HPP
@@ -0,0 +1,303 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "poda.hpp"
+#include "catalogo.hpp"
+#include "paralelo.hpp"
+#include "snapshot.hpp"
+#include "verificacao.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <set>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Sufixo dado aos snapshots expirados enquanto seus arquivos sao removidos
+const char* const SUFIXO_PODANDO = ".podando";
+
+// Quantidade de arquivos desvinculados por tarefa da etapa de varredura
+constexpr std::size_t TAMANHO_LOTE = 256;
+
+inline std::uint64_t mistura(std::uint64_t x) {
+    x += 0x9E3779B97F4A7C15ULL;
+    x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+    return x ^ (x >> 31);
+}
+
+inline std::uint64_t chave_inode(const struct stat& st) {
+    return mistura(static_cast<std::uint64_t>(st.st_dev)) ^ static_cast<std::uint64_t>(st.st_ino);
+}
+
+/** @brief Lista os arquivos (nao diretorios) de uma arvore. */
+std::vector<std::string> lista_arquivos(const std::string& raiz) {
+    std::vector<std::string> arquivos;
+    std::error_code erro;
+    for (fs::recursive_directory_iterator it(raiz, erro), fim; !erro && it != fim; it.increment(erro)) {
+        if (!it->is_directory(erro)) {
+            arquivos.push_back(it->path().string());
+        }
+    }
+    return arquivos;
+}
+
+/**
+ * @brief Diretorios "<snapshot>.podando" deixados por uma poda interrompida.
+ * @details Ja nao sao snapshots (nem estao no catalogo), entao nenhuma outra etapa os
+ * enxerga: sem isso o espaco deles nunca seria devolvido.
+ */
+std::vector<std::string> lista_podas_interrompidas(const std::string& caminho_destino_base) {
+    const std::string sufixo = SUFIXO_PODANDO;
+    std::vector<std::string> interrompidas;
+    std::error_code erro;
+    for (fs::directory_iterator it(caminho_destino_base, erro), fim; !erro && it != fim; it.increment(erro)) {
+        std::string nome = it->path().filename().string();
+        if (nome.size() > sufixo.size() && nome.compare(nome.size() - sufixo.size(), sufixo.size(), sufixo) == 0 &&
+            eh_nome_snapshot(nome.substr(0, nome.size() - sufixo.size())) && it->is_directory(erro)) {
+            interrompidas.push_back(it->path().string());
+        }
+    }
+    return interrompidas;
+}
+
+/**
+ * @brief Reescreve o catalogo sem referencias aos snapshots que serao apagados.
+ * @details Uma versao gravada em um snapshot expirado continua existindo nos snapshots
+ * seguintes enquanto o arquivo nao mudou; o primeiro snapshot mantido que ainda tem o
+ * mesmo checksum passa a ser a sua localizacao.
+ */
+ResultadoBackup poda_catalogo(const std::string& caminho_destino_base,
+                              const std::set<std::string>& expirados,
+                              const std::vector<std::string>& mantidos, RelatorioPoda& relatorio) {
+    Catalogo catalogo(caminho_destino_base);
+    if (catalogo.segmentos() == 0) {
+        return SUCESSO;
+    }
+    std::vector<VersaoCatalogo> versoes = catalogo.todas_as_versoes();
+
+    // Versoes pendentes e o limite (versao seguinte do mesmo arquivo) de cada uma
+    std::vector<std::size_t> pendentes;
+    std::vector<std::int64_t> limites(versoes.size(), std::numeric_limits<std::int64_t>::max());
+    for (std::size_t i = 0; i < versoes.size(); ++i) {
+        if (i + 1 < versoes.size() && versoes[i + 1].caminho == versoes[i].caminho) {
+            limites[i] = versoes[i + 1].versao;
+        }
+        if (expirados.count(versoes[i].snapshot) > 0) {
+            pendentes.push_back(i);
+        }
+    }
+    if (pendentes.empty()) {
+        return SUCESSO;
+    }
+
+    std::vector<bool> resolvida(versoes.size(), false);
+    for (const auto& snapshot : mantidos) {
+        std::int64_t versao_snapshot = versao_do_snapshot(snapshot);
+        Manifesto manifesto;
+        le_manifesto(caminho_destino_base + "/" + snapshot + "/" + NOME_MANIFESTO, manifesto);
+        for (std::size_t i : pendentes) {
+            VersaoCatalogo& v = versoes[i];
+            if (resolvida[i] || versao_snapshot < v.versao || versao_snapshot >= limites[i]) {
+                continue;
+            }
+            auto entrada = manifesto.find(v.caminho);
+            if (entrada != manifesto.end() && entrada->second.checksum == v.checksum &&
+                entrada->second.bytes == v.bytes) {
+                v.snapshot = snapshot;
+                resolvida[i] = true;
+                ++relatorio.versoes_realocadas;
+            }
+        }
+    }
+
+    std::vector<VersaoCatalogo> restantes;
+    restantes.reserve(versoes.size());
+    for (std::size_t i = 0; i < versoes.size(); ++i) {
+        if (expirados.count(versoes[i].snapshot) == 0) {
+            restantes.push_back(std::move(versoes[i]));
+        } else {
+            ++relatorio.versoes_descartadas;
+        }
+    }
+    return catalogo.reescreve(std::move(restantes));
+}
+
+}  // namespace
+
+// ==============================================================================
+// FILTRO DE BLOOM
+// ==============================================================================
+
+FiltroBloom::FiltroBloom(std::size_t elementos_esperados) {
+    // ~10 bits por elemento, arredondado para potencia de 2 (minimo 64 Kbit)
+    std::size_t bits = 1 << 16;
+    while (bits < elementos_esperados * 10) {
+        bits <<= 1;
+    }
+    bits_.assign(bits / 64, 0);
+    mascara_ = bits - 1;
+}
+
+void FiltroBloom::insere(std::uint64_t chave) {
+    insere_e_testa(chave);
+}
+
+bool FiltroBloom::insere_e_testa(std::uint64_t chave) {
+    std::uint64_t h1 = mistura(chave);
+    std::uint64_t h2 = mistura(h1) | 1;
+    bool presente = true;
+    for (int i = 0; i < 4; ++i) {
+        std::uint64_t bit = (h1 + static_cast<std::uint64_t>(i) * h2) & mascara_;
+        std::uint64_t marca = 1ULL << (bit & 63);
+        // std::atomic_ref so existe a partir do C++20: usa o builtin do GCC
+        std::uint64_t anterior = __atomic_fetch_or(&bits_[bit >> 6], marca, __ATOMIC_RELAXED);
+        presente = presente && (anterior & marca) != 0;
+    }
+    return presente;
+}
+
+bool FiltroBloom::pode_conter(std::uint64_t chave) const {
+    std::uint64_t h1 = mistura(chave);
+    std::uint64_t h2 = mistura(h1) | 1;
+    for (int i = 0; i < 4; ++i) {
+        std::uint64_t bit = (h1 + static_cast<std::uint64_t>(i) * h2) & mascara_;
+        std::uint64_t palavra = __atomic_load_n(&bits_[bit >> 6], __ATOMIC_RELAXED);
+        if ((palavra & (1ULL << (bit & 63))) == 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::size_t FiltroBloom::bytes_de_memoria() const {
+    return bits_.size() * sizeof(std::uint64_t);
+}
+
+// ==============================================================================
+// PODA (MARCACAO E VARREDURA)
+// ==============================================================================
+
+ResultadoBackup executa_poda(const std::string& caminho_destino_base, std::size_t manter,
+                             unsigned trabalhadores, RelatorioPoda& relatorio) {
+    // Assertiva de entrada
+    assert(!caminho_destino_base.empty());
+    assert(manter >= 1 && "Ao menos um snapshot deve ser mantido.");
+
+    auto inicio = std::chrono::steady_clock::now();
+
+    std::vector<std::string> snapshots = lista_snapshots(caminho_destino_base);
+    // Uma poda interrompida (queda no meio da varredura) e terminada por esta
+    std::vector<std::string> interrompidas = lista_podas_interrompidas(caminho_destino_base);
+    if (snapshots.size() <= manter && interrompidas.empty()) {
+        return SUCESSO;
+    }
+    const auto quantidade_mantida = static_cast<std::ptrdiff_t>(std::min(manter, snapshots.size()));
+    std::vector<std::string> mantidos(snapshots.end() - quantidade_mantida, snapshots.end());
+    std::set<std::string> expirados(snapshots.begin(), snapshots.end() - quantidade_mantida);
+
+    // 1. Catalogo primeiro: se o processo cair depois, ele ja nao aponta para o que sera apagado
+    if (!expirados.empty()) {
+        ResultadoBackup resultado = poda_catalogo(caminho_destino_base, expirados, mantidos, relatorio);
+        if (resultado != SUCESSO) {
+            return resultado;
+        }
+    }
+
+    // 2. Marcacao: inodes vivos dos snapshots mantidos (um snapshot por tarefa)
+    Manifesto mais_recente;
+    if (!mantidos.empty()) {
+        le_manifesto(caminho_destino_base + "/" + mantidos.back() + "/" + NOME_MANIFESTO, mais_recente);
+    }
+    FiltroBloom vivos(2 * mais_recente.size() + 1024);
+
+    executa_em_paralelo(mantidos.size(), trabalhadores, [&](std::size_t i, unsigned) {
+        for (const auto& arquivo : lista_arquivos(caminho_destino_base + "/" + mantidos[i])) {
+            struct stat st;
+            if (::lstat(arquivo.c_str(), &st) == 0) {
+                vivos.insere(chave_inode(st));
+            }
+        }
+    });
+
+    // 3. Varredura: os expirados deixam de ser snapshots antes de qualquer remocao
+    std::vector<std::string> arquivos;
+    std::vector<std::string> diretorios;
+    for (const auto& podando : interrompidas) {
+        std::vector<std::string> deste = lista_arquivos(podando);
+        arquivos.insert(arquivos.end(), deste.begin(), deste.end());
+        diretorios.push_back(podando);
+    }
+    for (const auto& nome : expirados) {
+        const std::string podando = caminho_destino_base + "/" + nome + SUFIXO_PODANDO;
+        std::error_code erro;
+        fs::rename(caminho_destino_base + "/" + nome, podando, erro);
+        if (erro) {
+            std::cerr << "Erro ao podar snapshot " << nome << ": " << erro.message() << std::endl;
+            return ERRO_GERAL;
+        }
+        std::vector<std::string> deste = lista_arquivos(podando);
+        arquivos.insert(arquivos.end(), deste.begin(), deste.end());
+        diretorios.push_back(podando);
+        relatorio.removidos.push_back(nome);
+    }
+
+    FiltroBloom ja_contados(arquivos.size() + 1024);
+    std::atomic<std::uintmax_t> bytes_liberados{0};
+    std::atomic<std::size_t> removidos{0};
+    std::atomic<bool> falhou{false};
+    std::size_t lotes = (arquivos.size() + TAMANHO_LOTE - 1) / TAMANHO_LOTE;
+
+    executa_em_paralelo(lotes, trabalhadores, [&](std::size_t lote, unsigned) {
+        std::size_t fim = std::min(arquivos.size(), (lote + 1) * TAMANHO_LOTE);
+        std::uintmax_t bytes_lote = 0;
+        std::size_t removidos_lote = 0;
+        for (std::size_t i = lote * TAMANHO_LOTE; i < fim; ++i) {
+            struct stat st;
+            if (::lstat(arquivos[i].c_str(), &st) != 0) {
+                continue;
+            }
+            // Inode fora dos snapshots mantidos: os dados somem com o ultimo vinculo
+            std::uint64_t chave = chave_inode(st);
+            if (!vivos.pode_conter(chave) && !ja_contados.insere_e_testa(chave)) {
+                bytes_lote += static_cast<std::uintmax_t>(st.st_blocks) * 512;
+            }
+            if (::unlink(arquivos[i].c_str()) == 0) {
+                ++removidos_lote;
+            } else {
+                falhou.store(true, std::memory_order_relaxed);
+            }
+        }
+        bytes_liberados += bytes_lote;
+        removidos += removidos_lote;
+    });
+
+    // Restam apenas diretorios vazios
+    for (const auto& diretorio : diretorios) {
+        std::error_code erro;
+        fs::remove_all(diretorio, erro);
+        if (erro) {
+            falhou.store(true, std::memory_order_relaxed);
+        }
+    }
+
+    relatorio.arquivos_removidos = removidos.load();
+    relatorio.bytes_liberados = bytes_liberados.load();
+    relatorio.segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+
+    if (falhou.load()) {
+        std::cerr << "Alguns arquivos dos snapshots expirados nao puderam ser removidos." << std::endl;
+        return ERRO_GERAL;
+    }
+
+    // Assertiva de saida
+    assert(lista_snapshots(caminho_destino_base).size() == mantidos.size());
+    return SUCESSO;
+}
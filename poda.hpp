@@ -0,0 +1,62 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef PODA_HPP
+#define PODA_HPP
+
+#include "backup.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Resumo de uma poda (retencao) de snapshots.
+ */
+struct RelatorioPoda {
+    std::vector<std::string> removidos;     ///< Snapshots apagados.
+    std::size_t arquivos_removidos = 0;     ///< Entradas desvinculadas nos snapshots apagados.
+    std::uintmax_t bytes_liberados = 0;     ///< Estimativa do espaco devolvido ao dispositivo.
+    std::size_t versoes_realocadas = 0;     ///< Versoes do catalogo movidas para um snapshot mantido.
+    std::size_t versoes_descartadas = 0;    ///< Versoes cujo conteudo deixou de existir.
+    double segundos = 0.0;
+};
+
+/**
+ * @brief Filtro de Bloom concorrente para identificadores de 64 bits.
+ * @details Usa ~10 bits por elemento (~1% de falsos positivos). Insercoes de varias
+ * threads sao seguras (fetch_or atomico); nunca ha falso negativo.
+ */
+class FiltroBloom {
+ public:
+    explicit FiltroBloom(std::size_t elementos_esperados);
+    void insere(std::uint64_t chave);
+    bool pode_conter(std::uint64_t chave) const;
+    /** @brief Insere e informa se a chave (provavelmente) ja estava presente. */
+    bool insere_e_testa(std::uint64_t chave);
+    std::size_t bytes_de_memoria() const;
+
+ private:
+    std::vector<std::uint64_t> bits_;
+    std::uint64_t mascara_;
+};
+
+/**
+ * @brief Poda os snapshots antigos mantendo apenas os 'manter' mais recentes.
+ * @details Marcacao: as arvores dos snapshots mantidos sao percorridas em paralelo e
+ * cada inode vivo e marcado em um FiltroBloom (memoria limitada, independente do
+ * tamanho dos nomes). Varredura: os snapshots expirados sao renomeados (deixam de
+ * ser snapshots imediatamente) e seus arquivos sao desvinculados em lotes por
+ * 'trabalhadores' threads; inodes nao marcados contam como espaco liberado. Antes de
+ * apagar, o catalogo e reescrito: versoes cujo snapshot sera apagado passam a apontar
+ * para o primeiro snapshot mantido com o mesmo conteudo, ou sao descartadas. Diretorios
+ * ".podando" de uma poda interrompida entram na varredura, mesmo sem snapshots a expirar.
+ * @param caminho_destino_base Raiz do backup em modo snapshot.
+ * @param manter Quantidade de snapshots mais recentes a preservar (>= 1).
+ * @param trabalhadores Numero de threads de marcacao e de remocao.
+ * @return SUCESSO ou ERRO_GERAL.
+ * @post Restam no maximo 'manter' snapshots e o catalogo so aponta para eles.
+ */
+ResultadoBackup executa_poda(const std::string& caminho_destino_base, std::size_t manter,
+                             unsigned trabalhadores, RelatorioPoda& relatorio);
+
+#endif  // PODA_HPP
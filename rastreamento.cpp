@@ -0,0 +1,181 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "rastreamento.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+/** @brief Um evento completo ("ph":"X"); 64 bytes, uma linha de cache. */
+struct EventoRastreamento {
+    std::int64_t inicio_ns;
+    std::int64_t duracao_ns;
+    std::uint8_t fase;
+    char detalhe[47];
+};
+static_assert(sizeof(EventoRastreamento) == 64, "Evento deve ocupar uma linha de cache");
+
+/**
+ * @brief Buffer circular de uma unica thread.
+ * @details So a thread dona escreve; 'escritos' e publicado com release para que a
+ * leitura final (apos o join dos trabalhadores) veja os eventos completos.
+ */
+struct BufferRastreamento {
+    explicit BufferRastreamento(unsigned id_thread, bool principal)
+        : eventos(new EventoRastreamento[CAPACIDADE_RASTREAMENTO]), id(id_thread), eh_principal(principal) {}
+
+    std::unique_ptr<EventoRastreamento[]> eventos;
+    std::atomic<std::uint64_t> escritos{0};
+    unsigned id;
+    bool eh_principal;
+};
+
+std::atomic<bool> g_ativo{false};
+std::atomic<std::uint64_t> g_geracao{0};
+std::int64_t g_inicio_ns = 0;
+std::thread::id g_thread_principal;
+
+// O registro so e tocado quando uma thread grava seu primeiro evento
+std::mutex g_mutex_buffers;
+std::vector<std::unique_ptr<BufferRastreamento>> g_buffers;
+
+thread_local BufferRastreamento* t_buffer = nullptr;
+thread_local std::uint64_t t_geracao = 0;
+
+std::int64_t agora_ns() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+BufferRastreamento* buffer_da_thread() {
+    std::uint64_t geracao = g_geracao.load(std::memory_order_acquire);
+    if (t_buffer == nullptr || t_geracao != geracao) {
+        std::lock_guard<std::mutex> trava(g_mutex_buffers);
+        g_buffers.push_back(std::make_unique<BufferRastreamento>(
+            static_cast<unsigned>(g_buffers.size()), std::this_thread::get_id() == g_thread_principal));
+        t_buffer = g_buffers.back().get();
+        t_geracao = geracao;
+    }
+    return t_buffer;
+}
+
+void escreve_json_escapado(std::ostream& saida, const char* texto) {
+    for (const char* c = texto; *c != '\0'; ++c) {
+        unsigned char u = static_cast<unsigned char>(*c);
+        if (*c == '"' || *c == '\\') {
+            saida << '\\' << *c;
+        } else if (u < 0x20) {
+            char escape[8];
+            std::snprintf(escape, sizeof(escape), "\\u%04x", u);
+            saida << escape;
+        } else {
+            saida << *c;
+        }
+    }
+}
+
+}  // namespace
+
+void ativa_rastreamento(bool ativa) {
+    if (ativa) {
+        std::lock_guard<std::mutex> trava(g_mutex_buffers);
+        g_buffers.clear();
+        g_inicio_ns = agora_ns();
+        g_thread_principal = std::this_thread::get_id();
+        g_geracao.fetch_add(1, std::memory_order_release);
+    }
+    g_ativo.store(ativa, std::memory_order_relaxed);
+}
+
+bool rastreamento_ativo() {
+    return g_ativo.load(std::memory_order_relaxed);
+}
+
+void registra_evento(FaseExecucao fase, std::int64_t inicio_ns, std::int64_t fim_ns,
+                     const char* detalhe) {
+    assert(fase >= 0 && fase < TOTAL_FASES);
+    BufferRastreamento* buffer = buffer_da_thread();
+    std::uint64_t indice = buffer->escritos.load(std::memory_order_relaxed);
+    EventoRastreamento& evento = buffer->eventos[indice & (CAPACIDADE_RASTREAMENTO - 1)];
+    evento.inicio_ns = inicio_ns - g_inicio_ns;
+    evento.duracao_ns = fim_ns - inicio_ns;
+    evento.fase = static_cast<std::uint8_t>(fase);
+    evento.detalhe[0] = '\0';
+    if (detalhe != nullptr) {
+        // Caminhos longos: o final (nome do arquivo) e o que identifica o evento
+        std::size_t tamanho = std::strlen(detalhe);
+        std::size_t limite = sizeof(evento.detalhe) - 1;
+        const char* inicio = detalhe + (tamanho > limite ? tamanho - limite : 0);
+        std::memcpy(evento.detalhe, inicio, std::min(tamanho, limite) + 1);
+    }
+    buffer->escritos.store(indice + 1, std::memory_order_release);
+}
+
+std::size_t eventos_registrados() {
+    std::lock_guard<std::mutex> trava(g_mutex_buffers);
+    std::size_t total = 0;
+    for (const auto& buffer : g_buffers) {
+        total += buffer->escritos.load(std::memory_order_acquire);
+    }
+    return total;
+}
+
+ResultadoBackup grava_rastreamento(const std::string& caminho) {
+    assert(!caminho.empty());
+
+    std::ofstream saida(caminho, std::ios::trunc);
+    if (!saida.is_open()) {
+        std::cerr << "Erro ao gravar o rastreamento em " << caminho << std::endl;
+        return ERRO_GERAL;
+    }
+
+    std::lock_guard<std::mutex> trava(g_mutex_buffers);
+    std::uint64_t descartados = 0;
+    char numero[64];
+    saida << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    saida << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"SysBackup\"}}";
+    for (const auto& buffer : g_buffers) {
+        const std::string nome = buffer->eh_principal ? "principal" : "trabalhador " + std::to_string(buffer->id);
+        saida << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->id
+              << ",\"args\":{\"name\":\"" << nome << "\"}}";
+
+        std::uint64_t escritos = buffer->escritos.load(std::memory_order_acquire);
+        std::uint64_t primeiro = escritos > CAPACIDADE_RASTREAMENTO ? escritos - CAPACIDADE_RASTREAMENTO : 0;
+        descartados += primeiro;
+        for (std::uint64_t i = primeiro; i < escritos; ++i) {
+            const EventoRastreamento& evento = buffer->eventos[i & (CAPACIDADE_RASTREAMENTO - 1)];
+            // Trace events usam microssegundos; tres casas preservam a resolucao em ns
+            std::snprintf(numero, sizeof(numero), "\"ts\":%.3f,\"dur\":%.3f",
+                          evento.inicio_ns / 1e3, evento.duracao_ns / 1e3);
+            saida << ",\n{\"name\":\"" << nome_fase(static_cast<FaseExecucao>(evento.fase))
+                  << "\",\"cat\":\"sysbackup\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->id
+                  << ',' << numero;
+            if (evento.detalhe[0] != '\0') {
+                saida << ",\"args\":{\"arquivo\":\"";
+                escreve_json_escapado(saida, evento.detalhe);
+                saida << "\"}";
+            }
+            saida << '}';
+        }
+    }
+    saida << "\n],\"otherData\":{\"eventos_descartados\":" << descartados << "}}\n";
+
+    saida.flush();
+    if (!saida) {
+        return ERRO_GERAL;
+    }
+    if (descartados > 0) {
+        std::cerr << "Aviso: " << descartados << " eventos antigos foram sobrescritos no rastreamento." << std::endl;
+    }
+    return SUCESSO;
+}
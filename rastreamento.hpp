@@ -0,0 +1,48 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef RASTREAMENTO_HPP
+#define RASTREAMENTO_HPP
+
+#include "backup.hpp"
+#include "estatisticas.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Linha do tempo da execucao no formato Chrome Trace Event (--trace).
+ * @details Cada thread grava seus eventos em um buffer circular proprio, sem trava
+ * nem alocacao no caminho critico: o unico custo e ler o relogio e escrever 64 bytes.
+ * O arquivo JSON e gerado ao final, quando os trabalhadores ja terminaram, e pode ser
+ * aberto em chrome://tracing ou no Perfetto (ui.perfetto.dev). As fases medidas sao as
+ * mesmas de --stats (MEDE_FASE / MEDE_FASE_DE).
+ */
+
+// Eventos por thread; alem disso o buffer circular sobrescreve os mais antigos
+constexpr std::size_t CAPACIDADE_RASTREAMENTO = 1 << 18;
+
+/**
+ * @brief Liga (zerando os buffers e o relogio) ou desliga a gravacao de eventos.
+ * @pre Nenhuma thread de trabalho em execucao.
+ */
+void ativa_rastreamento(bool ativa);
+bool rastreamento_ativo();
+
+/**
+ * @brief Registra um evento completo da thread atual.
+ * @param inicio_ns Instante de inicio (steady_clock, em ns).
+ * @param detalhe Texto opcional (ex: caminho do arquivo); so o final e guardado.
+ */
+void registra_evento(FaseExecucao fase, std::int64_t inicio_ns, std::int64_t fim_ns,
+                     const char* detalhe);
+
+/** @brief Eventos registrados desde a ativacao (inclusive os ja sobrescritos). */
+std::size_t eventos_registrados();
+
+/**
+ * @brief Grava todos os buffers em 'caminho' como JSON de trace events.
+ * @return SUCESSO ou ERRO_GERAL se o arquivo nao puder ser escrito.
+ */
+ResultadoBackup grava_rastreamento(const std::string& caminho);
+
+#endif  // RASTREAMENTO_HPP
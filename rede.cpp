@@ -0,0 +1,229 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "rede.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr std::size_t TAMANHO_BUFFER = 64 * 1024;
+
+[[noreturn]] void lanca_erro(const char* operacao, const std::string& par, int erro) {
+    throw fs::filesystem_error(operacao, par, std::error_code(erro, std::generic_category()));
+}
+
+void configura_socket(int fd) {
+    // Pedidos pequenos seguidos (cabecalhos, lotes) nao devem esperar pelo algoritmo de Nagle
+    int ligado = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &ligado, sizeof(ligado));
+}
+
+}  // namespace
+
+// ==============================================================================
+// CONEXAO
+// ==============================================================================
+
+ConexaoTcp::ConexaoTcp(int fd, std::string par) : fd_(fd), par_(std::move(par)), buffer_(TAMANHO_BUFFER) {
+    configura_socket(fd_);
+}
+
+ConexaoTcp::ConexaoTcp(ConexaoTcp&& outra) noexcept
+    : fd_(outra.fd_), par_(std::move(outra.par_)), buffer_(std::move(outra.buffer_)),
+      inicio_(outra.inicio_), fim_(outra.fim_) {
+    outra.fd_ = -1;
+}
+
+ConexaoTcp::~ConexaoTcp() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+ConexaoTcp ConexaoTcp::conecta(const std::string& host, std::uint16_t porta) {
+    const std::string par = host + ":" + std::to_string(porta);
+    addrinfo dicas{};
+    dicas.ai_family = AF_UNSPEC;
+    dicas.ai_socktype = SOCK_STREAM;
+    addrinfo* enderecos = nullptr;
+    if (::getaddrinfo(host.c_str(), std::to_string(porta).c_str(), &dicas, &enderecos) != 0) {
+        lanca_erro("conecta", par, EHOSTUNREACH);
+    }
+
+    int erro = ECONNREFUSED;
+    for (addrinfo* endereco = enderecos; endereco != nullptr; endereco = endereco->ai_next) {
+        int fd = ::socket(endereco->ai_family, endereco->ai_socktype | SOCK_CLOEXEC, endereco->ai_protocol);
+        if (fd < 0) {
+            erro = errno;
+            continue;
+        }
+        if (::connect(fd, endereco->ai_addr, endereco->ai_addrlen) == 0) {
+            ::freeaddrinfo(enderecos);
+            return ConexaoTcp(fd, par);
+        }
+        erro = errno;
+        ::close(fd);
+    }
+    ::freeaddrinfo(enderecos);
+    lanca_erro("conecta", par, erro);
+}
+
+void ConexaoTcp::envia(const char* dados, std::size_t tamanho) {
+    while (tamanho > 0) {
+        ssize_t enviados = ::send(fd_, dados, tamanho, MSG_NOSIGNAL);
+        if (enviados < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            lanca_erro("envia", par_, errno);
+        }
+        dados += enviados;
+        tamanho -= static_cast<std::size_t>(enviados);
+    }
+}
+
+bool ConexaoTcp::enche_buffer() {
+    inicio_ = 0;
+    fim_ = 0;
+    for (;;) {
+        ssize_t recebidos = ::recv(fd_, buffer_.data(), buffer_.size(), 0);
+        if (recebidos >= 0) {
+            fim_ = static_cast<std::size_t>(recebidos);
+            return recebidos > 0;
+        }
+        if (errno != EINTR) {
+            lanca_erro("recebe", par_, errno);
+        }
+    }
+}
+
+bool ConexaoTcp::le_linha(std::string& linha) {
+    linha.clear();
+    for (;;) {
+        if (inicio_ == fim_ && !enche_buffer()) {
+            if (linha.empty()) {
+                return false;
+            }
+            lanca_erro("recebe", par_, ECONNRESET);
+        }
+        const char* comeco = buffer_.data() + inicio_;
+        const char* quebra = static_cast<const char*>(std::memchr(comeco, '\n', fim_ - inicio_));
+        if (quebra == nullptr) {
+            linha.append(comeco, fim_ - inicio_);
+            inicio_ = fim_;
+            continue;
+        }
+        linha.append(comeco, static_cast<std::size_t>(quebra - comeco));
+        inicio_ += static_cast<std::size_t>(quebra - comeco) + 1;
+        if (!linha.empty() && linha.back() == '\r') {
+            linha.pop_back();
+        }
+        return true;
+    }
+}
+
+void ConexaoTcp::le_exato(char* destino, std::size_t tamanho) {
+    while (tamanho > 0) {
+        std::size_t lidos = le_alguns(destino, tamanho);
+        if (lidos == 0) {
+            lanca_erro("recebe", par_, ECONNRESET);
+        }
+        destino += lidos;
+        tamanho -= lidos;
+    }
+}
+
+std::size_t ConexaoTcp::le_alguns(char* destino, std::size_t tamanho) {
+    if (inicio_ == fim_) {
+        // Blocos grandes vao direto para o destino, sem passar pelo buffer
+        if (tamanho >= buffer_.size()) {
+            for (;;) {
+                ssize_t recebidos = ::recv(fd_, destino, tamanho, 0);
+                if (recebidos >= 0) {
+                    return static_cast<std::size_t>(recebidos);
+                }
+                if (errno != EINTR) {
+                    lanca_erro("recebe", par_, errno);
+                }
+            }
+        }
+        if (!enche_buffer()) {
+            return 0;
+        }
+    }
+    std::size_t copiados = std::min(tamanho, fim_ - inicio_);
+    std::memcpy(destino, buffer_.data() + inicio_, copiados);
+    inicio_ += copiados;
+    return copiados;
+}
+
+void ConexaoTcp::interrompe() {
+    ::shutdown(fd_, SHUT_RDWR);
+}
+
+// ==============================================================================
+// ESCUTA
+// ==============================================================================
+
+EscutaTcp::EscutaTcp(const std::string& host, std::uint16_t porta) {
+    const std::string par = host + ":" + std::to_string(porta);
+    addrinfo dicas{};
+    dicas.ai_family = AF_UNSPEC;
+    dicas.ai_socktype = SOCK_STREAM;
+    dicas.ai_flags = AI_PASSIVE;
+    addrinfo* enderecos = nullptr;
+    if (::getaddrinfo(host.empty() ? nullptr : host.c_str(), std::to_string(porta).c_str(), &dicas,
+                      &enderecos) != 0) {
+        lanca_erro("escuta", par, EADDRNOTAVAIL);
+    }
+
+    fd_ = ::socket(enderecos->ai_family, enderecos->ai_socktype | SOCK_CLOEXEC, enderecos->ai_protocol);
+    int reutiliza = 1;
+    if (fd_ < 0 || ::setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &reutiliza, sizeof(reutiliza)) != 0 ||
+        ::bind(fd_, enderecos->ai_addr, enderecos->ai_addrlen) != 0 || ::listen(fd_, SOMAXCONN) != 0) {
+        int erro = errno;
+        ::freeaddrinfo(enderecos);
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+        lanca_erro("escuta", par, erro);
+    }
+    ::freeaddrinfo(enderecos);
+
+    sockaddr_storage local{};
+    socklen_t tamanho = sizeof(local);
+    ::getsockname(fd_, reinterpret_cast<sockaddr*>(&local), &tamanho);
+    porta_ = ntohs(local.ss_family == AF_INET6 ? reinterpret_cast<sockaddr_in6*>(&local)->sin6_port
+                                               : reinterpret_cast<sockaddr_in*>(&local)->sin_port);
+}
+
+EscutaTcp::~EscutaTcp() {
+    ::close(fd_);
+}
+
+int EscutaTcp::aceita() {
+    for (;;) {
+        int fd = ::accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC);
+        if (fd >= 0) {
+            return fd;
+        }
+        if (errno != EINTR && errno != ECONNABORTED) {
+            return -1;
+        }
+    }
+}
+
+void EscutaTcp::interrompe() {
+    // Em Linux, shutdown no socket de escuta faz o accept bloqueado retornar EINVAL
+    ::shutdown(fd_, SHUT_RDWR);
+}
@@ -0,0 +1,79 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef REDE_HPP
+#define REDE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Conexao TCP com leitura bufferizada (linhas e blocos de tamanho conhecido).
+ * @details As falhas sao lancadas como std::filesystem::filesystem_error, como as do
+ * Armazenamento, para que a tabela de decisao as trate da mesma forma. O fim da
+ * conexao no meio de uma leitura e reportado como ECONNRESET.
+ */
+class ConexaoTcp {
+ public:
+    explicit ConexaoTcp(int fd, std::string par = std::string());
+    ~ConexaoTcp();
+    ConexaoTcp(const ConexaoTcp&) = delete;
+    ConexaoTcp& operator=(const ConexaoTcp&) = delete;
+
+    /** @brief Conecta a host:porta (nome ou endereco IPv4/IPv6). */
+    static ConexaoTcp conecta(const std::string& host, std::uint16_t porta);
+    ConexaoTcp(ConexaoTcp&& outra) noexcept;
+
+    void envia(const char* dados, std::size_t tamanho);
+    void envia(const std::string& dados) { envia(dados.data(), dados.size()); }
+
+    /**
+     * @brief Le uma linha terminada em "\n" (o "\r" final tambem e removido).
+     * @return false se a conexao terminou antes de qualquer byte da linha.
+     */
+    bool le_linha(std::string& linha);
+    /** @brief Le exatamente 'tamanho' bytes. */
+    void le_exato(char* destino, std::size_t tamanho);
+    /** @brief Le o que estiver disponivel, ate 'tamanho' bytes (0 no fim da conexao). */
+    std::size_t le_alguns(char* destino, std::size_t tamanho);
+
+    /** @brief Encerra os dois sentidos; leituras bloqueadas em outra thread retornam. */
+    void interrompe();
+    int descritor() const { return fd_; }
+
+ private:
+    bool enche_buffer();
+
+    int fd_;
+    std::string par_;
+    std::vector<char> buffer_;
+    std::size_t inicio_ = 0;
+    std::size_t fim_ = 0;
+};
+
+/**
+ * @brief Socket de escuta TCP.
+ */
+class EscutaTcp {
+ public:
+    /** @param porta 0 escolhe uma porta livre (consulte porta()). */
+    EscutaTcp(const std::string& host, std::uint16_t porta);
+    ~EscutaTcp();
+    EscutaTcp(const EscutaTcp&) = delete;
+    EscutaTcp& operator=(const EscutaTcp&) = delete;
+
+    /**
+     * @brief Aguarda a proxima conexao.
+     * @return Descritor da conexao ou -1 depois de interrompe().
+     */
+    int aceita();
+    void interrompe();
+    std::uint16_t porta() const { return porta_; }
+
+ private:
+    int fd_;
+    std::uint16_t porta_ = 0;
+};
+
+#endif  // REDE_HPP
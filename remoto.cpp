@@ -0,0 +1,598 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "remoto.hpp"
+#include "armazenamento.hpp"
+#include "buffers.hpp"
+#include "checksum.hpp"
+#include "estatisticas.hpp"
+#include "paralelo.hpp"
+#include "rede.hpp"
+#include "verificacao.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <iostream>
+#include <sstream>
+#include <system_error>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Arquivos por lote de decisao e lotes em voo na conexao de controle: com 4 x 256
+// arquivos pendentes a latencia da rede fica escondida atras do stat do receptor
+const std::size_t LOTE_REMOTO = 256;
+const std::size_t LOTES_EM_VOO = 4;
+
+const std::size_t TAMANHO_BLOCO_REDE = TAMANHO_BUFFER_POOL;
+
+const char* const SAUDACAO = "SYSBACKUP 1";
+const char* const SUFIXO_RECEBENDO = ".recebendo";
+
+// Decisoes do receptor (um caractere por arquivo): '2'..'5' sao os casos da tabela
+// de BACKUP; 'X' e caminho recusado. O cliente marca localmente os ausentes na origem.
+const char DECISAO_RECUSADA = 'X';
+const char DECISAO_AUSENTE = '6';
+
+[[noreturn]] void lanca_erro_protocolo(const std::string& detalhe) {
+    throw fs::filesystem_error("protocolo remoto", detalhe, std::error_code(EPROTO, std::generic_category()));
+}
+
+/** @brief Recusa caminhos que escapariam do destino (absolutos ou com ".."). */
+bool caminho_seguro(const std::string& relativo) {
+    if (relativo.empty() || relativo[0] == '/') {
+        return false;
+    }
+    std::size_t inicio = 0;
+    while (inicio <= relativo.size()) {
+        std::size_t fim = relativo.find('/', inicio);
+        if (fim == std::string::npos) {
+            fim = relativo.size();
+        }
+        if (relativo.compare(inicio, fim - inicio, "..") == 0) {
+            return false;
+        }
+        inicio = fim + 1;
+    }
+    return true;
+}
+
+}  // namespace
+
+bool interpreta_destino_remoto(const std::string& url, std::string& host, std::uint16_t& porta) {
+    const std::string prefixo = "tcp://";
+    if (url.compare(0, prefixo.size(), prefixo) != 0) {
+        return false;
+    }
+    std::string resto = url.substr(prefixo.size());
+    resto = resto.substr(0, resto.find('/'));
+    porta = PORTA_REMOTA_PADRAO;
+    std::size_t dois_pontos = resto.rfind(':');
+    if (dois_pontos != std::string::npos && resto.find(']', dois_pontos) == std::string::npos) {
+        char* fim = nullptr;
+        unsigned long numero = std::strtoul(resto.c_str() + dois_pontos + 1, &fim, 10);
+        if (*fim != '\0' || numero == 0 || numero > 65535) {
+            return false;
+        }
+        porta = static_cast<std::uint16_t>(numero);
+        resto.erase(dois_pontos);
+    }
+    if (resto.size() > 2 && resto.front() == '[' && resto.back() == ']') {
+        resto = resto.substr(1, resto.size() - 2);
+    }
+    host = resto;
+    return !host.empty();
+}
+
+// ==============================================================================
+// CLIENTE
+// ==============================================================================
+
+ResultadoBackup executa_backup_remoto(const std::string& nome_arquivo_parm,
+                                      const std::string& caminho_origem_base,
+                                      const std::string& host, std::uint16_t porta,
+                                      unsigned fluxos, RelatorioRemoto& relatorio) {
+    // Assertiva de entrada
+    assert(!nome_arquivo_parm.empty());
+    assert(!caminho_origem_base.empty());
+    assert(!host.empty());
+
+    const auto inicio = std::chrono::steady_clock::now();
+    relatorio = RelatorioRemoto();
+
+    std::vector<std::string> arquivos;
+    ResultadoBackup leitura = le_arquivo_parametros(nome_arquivo_parm, arquivos);
+    if (leitura != SUCESSO) {
+        return leitura;
+    }
+
+    // O primeiro erro (na ordem de Backup.parm) interrompe o backup: nada depois dele
+    // e transferido, como na execucao local
+    std::mutex trava;
+    std::size_t limite = arquivos.size();
+    ResultadoBackup erro_item = SUCESSO;
+    auto registra_erro = [&](std::size_t i, ResultadoBackup codigo) {
+        std::lock_guard<std::mutex> guarda(trava);
+        if (i < limite) {
+            limite = i;
+            erro_item = codigo;
+        }
+    };
+
+    ResultadoBackup resultado = SUCESSO;
+    try {
+        ConexaoTcp controle = ConexaoTcp::conecta(host, porta);
+        controle.envia(std::string(SAUDACAO) + "\n");
+        std::string linha;
+        ++relatorio.idas_e_voltas;
+        if (!controle.le_linha(linha) || linha.compare(0, 3, "OK ") != 0) {
+            lanca_erro_protocolo("saudacao: " + linha);
+        }
+        const std::string sessao = linha.substr(3);
+
+        // 1. DECISOES EM LOTES: o receptor aplica a tabela de decisao do lado dele
+        std::vector<char> decisoes(arquivos.size(), DECISAO_AUSENTE);
+        std::deque<std::vector<std::size_t>> em_voo;
+        std::size_t proximo = 0;
+        while (proximo < arquivos.size() || !em_voo.empty()) {
+            while (proximo < arquivos.size() && em_voo.size() < LOTES_EM_VOO && limite == arquivos.size()) {
+                const std::size_t fim = std::min(proximo + LOTE_REMOTO, arquivos.size());
+                std::vector<std::size_t> indices;
+                std::string lote;
+                for (std::size_t i = proximo; i < fim; ++i) {
+                    EstadoArquivo estado;
+                    try {
+                        MEDE_FASE(FASE_METADADOS);
+                        estado = armazenamento_posix().consulta(caminho_origem_base + "/" + arquivos[i]);
+                    } catch (const fs::filesystem_error& e) {
+                        std::cerr << "Erro ao consultar origem: " << e.what() << std::endl;
+                        registra_erro(i, ERRO_GERAL);
+                        break;
+                    }
+                    if (!estado.existe) {
+                        continue;  // Casos 6 e 7: nada a enviar
+                    }
+                    indices.push_back(i);
+                    lote += std::to_string(estado.tamanho) + " " + std::to_string(nanos_desde_epoca(estado.modificacao)) +
+                            " " + arquivos[i] + "\n";
+                }
+                proximo = fim;
+                if (!indices.empty()) {
+                    controle.envia("LOTE " + std::to_string(indices.size()) + "\n" + lote);
+                    em_voo.push_back(std::move(indices));
+                }
+            }
+            if (em_voo.empty()) {
+                break;
+            }
+
+            {
+                MEDE_FASE(FASE_METADADOS);
+                ++relatorio.idas_e_voltas;
+                if (!controle.le_linha(linha) || linha.compare(0, 9, "DECISOES ") != 0 ||
+                    linha.size() - 9 != em_voo.front().size()) {
+                    lanca_erro_protocolo("decisoes: " + linha);
+                }
+            }
+            const std::vector<std::size_t>& indices = em_voo.front();
+            for (std::size_t k = 0; k < indices.size(); ++k) {
+                const char decisao = linha[9 + k];
+                decisoes[indices[k]] = decisao;
+                if (decisao >= '2' && decisao <= '5') {
+                    CONTA_CASO(decisao - '0');
+                }
+                if (decisao == '5') {
+                    registra_erro(indices[k], ERRO_ARQUIVO_DESTINO_MAIS_NOVO);
+                } else if (decisao == DECISAO_RECUSADA) {
+                    std::cerr << "Receptor recusou o caminho: " << arquivos[indices[k]] << std::endl;
+                    registra_erro(indices[k], ERRO_GERAL);
+                }
+            }
+            em_voo.pop_front();
+        }
+
+        // 2. TRANSFERENCIA por conexoes de dados paralelas, sem confirmacao por arquivo
+        std::vector<std::size_t> envios;
+        for (std::size_t i = 0; i < limite; ++i) {
+            if (decisoes[i] == '2' || decisoes[i] == '3') {
+                envios.push_back(i);
+            } else if (decisoes[i] == '4') {
+                ++relatorio.inalterados;
+            } else if (decisoes[i] == DECISAO_AUSENTE) {
+                ++relatorio.ausentes;
+            }
+        }
+        const unsigned n_fluxos = std::max(1u, fluxos);
+        std::vector<std::unique_ptr<ConexaoTcp>> conexoes(n_fluxos);
+        std::vector<std::vector<std::size_t>> enviados(n_fluxos);
+        std::vector<char> fluxo_falhou(n_fluxos, 0);
+        std::vector<std::uint64_t> checksums(arquivos.size(), 0);
+
+        executa_em_paralelo(envios.size(), n_fluxos, [&](std::size_t k, unsigned id) {
+            const std::size_t i = envios[k];
+            if (fluxo_falhou[id]) {
+                registra_erro(i, ERRO_GERAL);
+                return;
+            }
+            const std::string origem = caminho_origem_base + "/" + arquivos[i];
+            MEDE_FASE_DE(FASE_COPIA, origem.c_str());
+
+            EstadoArquivo estado;
+            std::unique_ptr<LeitorArquivo> leitor;
+            try {
+                estado = armazenamento_posix().consulta(origem);
+                leitor = armazenamento_posix().abre_leitura(origem);
+            } catch (const fs::filesystem_error& e) {
+                std::cerr << "Erro de copia: " << e.what() << std::endl;
+                registra_erro(i, ERRO_GERAL);
+                return;
+            }
+
+            // Depois do cabecalho, qualquer falha deixa a conexao inutilizavel
+            try {
+                if (!conexoes[id]) {
+                    conexoes[id] = std::make_unique<ConexaoTcp>(ConexaoTcp::conecta(host, porta));
+                    conexoes[id]->envia("DADOS " + sessao + "\n");
+                }
+                ConexaoTcp& conexao = *conexoes[id];
+                conexao.envia("ARQUIVO " + std::to_string(estado.tamanho) + " " +
+                              std::to_string(nanos_desde_epoca(estado.modificacao)) + " " + arquivos[i] + "\n");
+                PoolBuffers::Emprestimo buffer = pool_blocos().empresta();
+                HashXXH64 hash;
+                for (std::uintmax_t restante = estado.tamanho; restante > 0;) {
+                    std::size_t lidos = leitor->le(
+                        buffer.get(), static_cast<std::size_t>(std::min<std::uintmax_t>(restante, TAMANHO_BLOCO_REDE)));
+                    if (lidos == 0) {
+                        throw fs::filesystem_error("arquivo encolheu durante o envio", origem,
+                                                   std::error_code(EIO, std::generic_category()));
+                    }
+                    hash.atualiza(buffer.get(), lidos);
+                    conexao.envia(buffer.get(), lidos);
+                    restante -= lidos;
+                }
+                checksums[i] = hash.finaliza();
+                enviados[id].push_back(i);
+                CONTA_BYTES(estado.tamanho);
+            } catch (const fs::filesystem_error& e) {
+                std::cerr << "Erro de envio: " << e.what() << std::endl;
+                fluxo_falhou[id] = 1;
+                registra_erro(i, ERRO_GERAL);
+            }
+        });
+
+        // 3. CONFIRMACOES: o receptor devolve o checksum de cada arquivo gravado
+        for (unsigned id = 0; id < n_fluxos; ++id) {
+            if (!conexoes[id] || fluxo_falhou[id]) {
+                continue;
+            }
+            conexoes[id]->envia("FIM\n");
+            ++relatorio.idas_e_voltas;
+            for (std::size_t i : enviados[id]) {
+                if (!conexoes[id]->le_linha(linha)) {
+                    lanca_erro_protocolo("confirmacao ausente");
+                }
+                std::istringstream campos(linha);
+                std::string estado, hex;
+                std::uintmax_t bytes = 0;
+                std::uint64_t checksum = 0;
+                if (!(campos >> estado >> hex >> bytes) || estado != "OK" || !hex_para_checksum(hex, checksum)) {
+                    std::cerr << "Receptor falhou em " << arquivos[i] << ": " << linha << std::endl;
+                    registra_erro(i, ERRO_GERAL);
+                } else if (checksum != checksums[i]) {
+                    std::cerr << "Checksum divergente apos envio: " << arquivos[i] << std::endl;
+                    registra_erro(i, ERRO_CHECKSUM_DIVERGENTE);
+                } else {
+                    ++relatorio.enviados;
+                    relatorio.bytes += bytes;
+                }
+            }
+        }
+
+        // 4. ENCERRAMENTO: o receptor grava o manifesto
+        controle.envia("FIM\n");
+        ++relatorio.idas_e_voltas;
+        if (!controle.le_linha(linha) || linha != "OK") {
+            std::cerr << "Receptor falhou ao concluir: " << linha << std::endl;
+            resultado = ERRO_GERAL;
+        }
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Erro de rede: " << e.what() << std::endl;
+        resultado = ERRO_GERAL;
+    }
+
+    relatorio.segundos = std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+    return (erro_item != SUCESSO) ? erro_item : resultado;
+}
+
+// ==============================================================================
+// RECEPTOR
+// ==============================================================================
+
+struct ReceptorBackup::Sessao {
+    std::mutex mutex;
+    Manifesto recebidos;  ///< Checksums dos arquivos gravados nesta sessao.
+    std::uintmax_t bytes = 0;
+};
+
+ReceptorBackup::ReceptorBackup(const std::string& caminho_destino_base, const std::string& endereco,
+                               std::uint16_t porta)
+    : destino_(caminho_destino_base), escuta_(std::make_unique<EscutaTcp>(endereco, porta)),
+      aceitacao_(&ReceptorBackup::aceita_conexoes, this) {}
+
+ReceptorBackup::~ReceptorBackup() {
+    encerra();
+}
+
+std::uint16_t ReceptorBackup::porta() const {
+    return escuta_->porta();
+}
+
+void ReceptorBackup::aguarda() {
+    std::unique_lock<std::mutex> trava(mutex_);
+    encerramento_.wait(trava, [this] { return encerrado_; });
+}
+
+void ReceptorBackup::encerra() {
+    {
+        std::lock_guard<std::mutex> trava(mutex_);
+        if (encerrado_) {
+            return;
+        }
+        encerrado_ = true;
+    }
+    encerramento_.notify_all();
+    escuta_->interrompe();
+    aceitacao_.join();
+    std::map<std::thread::id, std::thread> atendentes;
+    {
+        std::lock_guard<std::mutex> trava(mutex_);
+        for (ConexaoTcp* conexao : conexoes_) {
+            conexao->interrompe();
+        }
+        atendentes.swap(atendentes_);
+        terminados_.clear();
+    }
+    for (auto& [id, atendente] : atendentes) {
+        atendente.join();
+    }
+}
+
+void ReceptorBackup::aceita_conexoes() {
+    for (int fd; (fd = escuta_->aceita()) >= 0;) {
+        auto* conexao = new ConexaoTcp(fd, "cliente");
+        std::vector<std::thread> terminados;
+        {
+            std::lock_guard<std::mutex> trava(mutex_);
+            // Recolhe os atendentes de conexoes ja encerradas: um receptor de longa duracao
+            // nao acumula uma thread por conexao atendida
+            for (std::thread::id id : terminados_) {
+                auto it = atendentes_.find(id);
+                terminados.push_back(std::move(it->second));
+                atendentes_.erase(it);
+            }
+            terminados_.clear();
+            conexoes_.insert(conexao);
+            std::thread atendente(&ReceptorBackup::atende, this, conexao);
+            atendentes_.emplace(atendente.get_id(), std::move(atendente));
+        }
+        for (auto& atendente : terminados) {
+            atendente.join();
+        }
+    }
+}
+
+void ReceptorBackup::atende(ConexaoTcp* conexao) {
+    try {
+        std::string linha;
+        if (conexao->le_linha(linha)) {
+            if (linha == SAUDACAO) {
+                atende_controle(*conexao);
+            } else if (linha.compare(0, 6, "DADOS ") == 0) {
+                std::shared_ptr<Sessao> sessao;
+                {
+                    std::lock_guard<std::mutex> trava(mutex_);
+                    auto it = sessoes_.find(std::strtoull(linha.c_str() + 6, nullptr, 10));
+                    if (it != sessoes_.end()) {
+                        sessao = it->second;
+                    }
+                }
+                if (sessao) {
+                    atende_dados(*conexao, sessao);
+                }
+            }
+        }
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Conexao encerrada: " << e.what() << std::endl;
+    }
+
+    std::lock_guard<std::mutex> trava(mutex_);
+    conexoes_.erase(conexao);
+    delete conexao;
+    terminados_.push_back(std::this_thread::get_id());
+}
+
+char ReceptorBackup::decide(const std::string& linha) const {
+    // <tamanho> <data em ns> <caminho relativo>
+    std::istringstream campos(linha);
+    std::uintmax_t tamanho = 0;
+    std::int64_t data = 0;
+    if (!(campos >> tamanho >> data)) {
+        return DECISAO_RECUSADA;
+    }
+    campos.get();
+    std::string relativo;
+    std::getline(campos, relativo);
+    if (!caminho_seguro(relativo)) {
+        return DECISAO_RECUSADA;
+    }
+
+    EstadoArquivo destino;
+    try {
+        destino = armazenamento_posix().consulta(destino_ + "/" + relativo);
+    } catch (const fs::filesystem_error&) {
+        return DECISAO_RECUSADA;
+    }
+    const fs::file_time_type tempo_origem = data_de_nanos(data);
+    if (!destino.existe) {
+        return '2';  // CASO 2: copiar
+    }
+    if (destino.modificacao < tempo_origem) {
+        return '3';  // CASO 3: copiar (destino mais antigo)
+    }
+    return (destino.modificacao == tempo_origem) ? '4' : '5';  // CASO 4: ignorar / CASO 5: erro
+}
+
+void ReceptorBackup::atende_controle(ConexaoTcp& conexao) {
+    auto sessao = std::make_shared<Sessao>();
+    std::uint64_t id;
+    {
+        std::lock_guard<std::mutex> trava(mutex_);
+        id = proxima_sessao_++;
+        sessoes_[id] = sessao;
+    }
+    conexao.envia("OK " + std::to_string(id) + "\n");
+
+    std::string linha;
+    while (conexao.le_linha(linha)) {
+        if (linha.compare(0, 5, "LOTE ") == 0) {
+            std::size_t quantidade = std::strtoull(linha.c_str() + 5, nullptr, 10);
+            std::string resposta = "DECISOES ";
+            resposta.reserve(resposta.size() + quantidade + 1);
+            for (std::size_t i = 0; i < quantidade; ++i) {
+                if (!conexao.le_linha(linha)) {
+                    lanca_erro_protocolo("lote incompleto");
+                }
+                resposta += decide(linha);
+            }
+            conexao.envia(resposta + "\n");
+        } else if (linha == "FIM") {
+            ResultadoBackup resultado = conclui(*sessao);
+            conexao.envia(resultado == SUCESSO ? std::string("OK\n") : "ERRO " + resultado_para_string(resultado) + "\n");
+            std::cout << "Sessao " << id << ": " << sessao->recebidos.size() << " arquivos recebidos ("
+                      << static_cast<double>(sessao->bytes) / (1024.0 * 1024.0) << " MB)" << std::endl;
+            break;
+        } else {
+            break;
+        }
+    }
+
+    std::lock_guard<std::mutex> trava(mutex_);
+    sessoes_.erase(id);
+}
+
+void ReceptorBackup::atende_dados(ConexaoTcp& conexao, const std::shared_ptr<Sessao>& sessao) {
+    // As confirmacoes ficam em memoria ate o FIM: o cliente so as le depois de enviar tudo
+    std::string confirmacoes;
+    PoolBuffers::Emprestimo buffer = pool_blocos().empresta();
+    std::string linha;
+    while (conexao.le_linha(linha)) {
+        if (linha == "FIM") {
+            conexao.envia(confirmacoes);
+            return;
+        }
+        // ARQUIVO <tamanho> <data em ns> <caminho relativo>
+        std::istringstream campos(linha);
+        std::string comando;
+        std::uintmax_t tamanho = 0;
+        std::int64_t data = 0;
+        if (!(campos >> comando >> tamanho >> data) || comando != "ARQUIVO") {
+            lanca_erro_protocolo(linha);
+        }
+        campos.get();
+        std::string relativo;
+        std::getline(campos, relativo);
+
+        const std::string destino = destino_ + "/" + relativo;
+        const std::string temporario = destino + SUFIXO_RECEBENDO;
+        std::string erro = caminho_seguro(relativo) ? std::string() : "caminho recusado";
+        std::unique_ptr<EscritorArquivo> escritor;
+        if (erro.empty()) {
+            try {
+                fs::create_directories(fs::path(destino).parent_path());
+                escritor = armazenamento_posix().abre_escrita(temporario);
+            } catch (const fs::filesystem_error& e) {
+                erro = e.what();
+            }
+        }
+
+        // Os dados sao sempre consumidos, mesmo apos uma falha, para manter o fluxo alinhado
+        const bool temporario_criado = escritor != nullptr;
+        HashXXH64 hash;
+        try {
+            for (std::uintmax_t restante = tamanho; restante > 0;) {
+                std::size_t bloco = static_cast<std::size_t>(std::min<std::uintmax_t>(restante, TAMANHO_BLOCO_REDE));
+                conexao.le_exato(buffer.get(), bloco);
+                hash.atualiza(buffer.get(), bloco);
+                if (escritor) {
+                    try {
+                        escritor->escreve(buffer.get(), bloco);
+                    } catch (const fs::filesystem_error& e) {
+                        erro = e.what();
+                        escritor.reset();
+                    }
+                }
+                restante -= bloco;
+            }
+        } catch (const fs::filesystem_error&) {
+            // Conexao caiu no meio do arquivo: o temporario nao fica para tras
+            escritor.reset();
+            if (temporario_criado) {
+                std::error_code ignora;
+                fs::remove(temporario, ignora);
+            }
+            throw;
+        }
+        if (escritor) {
+            try {
+                escritor->fecha();
+                armazenamento_posix().define_data(temporario, data_de_nanos(data));
+                prepara_publicacao(temporario);
+                publica_copia(temporario, destino);
+            } catch (const fs::filesystem_error& e) {
+                erro = e.what();
+            }
+        }
+
+        if (!erro.empty()) {
+            std::error_code ignora;
+            fs::remove(temporario, ignora);
+            confirmacoes += "ERRO " + erro + "\n";
+            continue;
+        }
+        const std::uint64_t checksum = hash.finaliza();
+        {
+            std::lock_guard<std::mutex> trava(sessao->mutex);
+            sessao->recebidos[relativo] = EntradaManifesto{checksum, tamanho};
+            sessao->bytes += tamanho;
+        }
+        confirmacoes += "OK " + checksum_para_hex(checksum) + " " + std::to_string(tamanho) + "\n";
+    }
+}
+
+ResultadoBackup ReceptorBackup::conclui(Sessao& sessao) {
+    std::lock_guard<std::mutex> trava_sessao(sessao.mutex);
+    if (sessao.recebidos.empty()) {
+        return SUCESSO;
+    }
+    // O manifesto so registra o que ja esta duravel no disco
+    if (!confirma_copias()) {
+        return ERRO_GERAL;
+    }
+    // Relido sob trava: outra sessao pode ter atualizado o manifesto nesse meio tempo
+    std::lock_guard<std::mutex> trava(mutex_manifesto_);
+    const std::string caminho = destino_ + "/" + NOME_MANIFESTO;
+    Manifesto manifesto;
+    ResultadoBackup leitura = le_manifesto(caminho, manifesto);
+    if (leitura != SUCESSO && leitura != ERRO_MANIFESTO_AUSENTE) {
+        return leitura;
+    }
+    for (const auto& [relativo, entrada] : sessao.recebidos) {
+        manifesto[relativo] = entrada;
+    }
+    return grava_manifesto(caminho, manifesto);
+}
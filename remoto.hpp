@@ -0,0 +1,108 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef REMOTO_HPP
+#define REMOTO_HPP
+
+#include "backup.hpp"
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ConexaoTcp;
+class EscutaTcp;
+
+/** Porta padrao do receptor (backup_app -d). */
+const std::uint16_t PORTA_REMOTA_PADRAO = 7070;
+
+/** Conexoes de dados paralelas padrao do cliente remoto. */
+const unsigned FLUXOS_REMOTOS_PADRAO = 4;
+
+/**
+ * @brief Resumo de um backup remoto.
+ */
+struct RelatorioRemoto {
+    std::size_t enviados = 0;       ///< Arquivos transferidos (Casos 2 e 3).
+    std::size_t inalterados = 0;    ///< Datas iguais no receptor (Caso 4).
+    std::size_t ausentes = 0;       ///< Ausentes na origem (Casos 6 e 7).
+    std::uintmax_t bytes = 0;       ///< Bytes de dados transferidos.
+    std::uint64_t idas_e_voltas = 0;  ///< Esperas por resposta do receptor.
+    double segundos = 0.0;
+};
+
+/**
+ * @brief Interpreta "tcp://host[:porta]" (porta padrao PORTA_REMOTA_PADRAO).
+ * @return false se o texto nao comeca com tcp:// ou a porta e invalida.
+ */
+bool interpreta_destino_remoto(const std::string& url, std::string& host, std::uint16_t& porta);
+
+/**
+ * @brief Backup para um receptor remoto (backup_app -d) por TCP.
+ * @details Em vez de um stat remoto por arquivo, o cliente envia lotes de
+ * (tamanho, data, caminho) e o receptor responde, para o lote inteiro, o caso da
+ * tabela de decisao de cada arquivo (2, 3, 4 ou 5); varios lotes ficam em voo na
+ * mesma conexao. Os arquivos a transferir seguem depois por 'fluxos' conexoes de
+ * dados em paralelo, sem esperar confirmacao arquivo a arquivo: o receptor devolve
+ * os checksums (XXH64) ao final de cada conexao e o cliente os confere com os que
+ * calculou na leitura. O receptor atualiza o manifesto do destino.
+ * @return SUCESSO ou o erro do primeiro arquivo (na ordem de Backup.parm) que falhou;
+ * ERRO_GERAL em falha de rede.
+ */
+ResultadoBackup executa_backup_remoto(const std::string& nome_arquivo_parm,
+                                      const std::string& caminho_origem_base,
+                                      const std::string& host, std::uint16_t porta,
+                                      unsigned fluxos, RelatorioRemoto& relatorio);
+
+/**
+ * @brief Receptor de backups remotos: aplica no destino local a tabela de decisao do
+ * BACKUP para os lotes recebidos e grava os arquivos transferidos.
+ * @details Cada arquivo e recebido em "<caminho>.recebendo" e renomeado ao final, de
+ * modo que uma conexao interrompida nao deixa arquivo parcial com data nova (o que
+ * cairia no Caso 5 na proxima execucao). Caminhos absolutos ou com ".." sao recusados.
+ * Nao ha autenticacao nem criptografia: use em rede confiavel ou por um tunel SSH.
+ */
+class ReceptorBackup {
+ public:
+    /** @param porta 0 escolhe uma porta livre (consulte porta()). */
+    ReceptorBackup(const std::string& caminho_destino_base, const std::string& endereco, std::uint16_t porta);
+    ~ReceptorBackup();
+    ReceptorBackup(const ReceptorBackup&) = delete;
+    ReceptorBackup& operator=(const ReceptorBackup&) = delete;
+
+    std::uint16_t porta() const;
+    /** @brief Bloqueia ate encerra() ser chamado por outra thread. */
+    void aguarda();
+    void encerra();
+
+ private:
+    struct Sessao;
+
+    void aceita_conexoes();
+    void atende(ConexaoTcp* conexao);
+    void atende_controle(ConexaoTcp& conexao);
+    void atende_dados(ConexaoTcp& conexao, const std::shared_ptr<Sessao>& sessao);
+    char decide(const std::string& linha) const;
+    ResultadoBackup conclui(Sessao& sessao);
+
+    const std::string destino_;
+    std::unique_ptr<EscutaTcp> escuta_;
+    std::thread aceitacao_;
+
+    std::mutex mutex_;
+    std::map<std::uint64_t, std::shared_ptr<Sessao>> sessoes_;
+    std::uint64_t proxima_sessao_ = 1;
+    std::set<ConexaoTcp*> conexoes_;
+    std::map<std::thread::id, std::thread> atendentes_;
+    std::vector<std::thread::id> terminados_;  ///< Atendentes ja encerrados, a recolher.
+    std::condition_variable encerramento_;
+    std::mutex mutex_manifesto_;  ///< Serializa a atualizacao do manifesto entre sessoes.
+    bool encerrado_ = false;
+};
+
+#endif  // REMOTO_HPP
@@ -0,0 +1,333 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "servidor_objetos.hpp"
+#include "objetos.hpp"
+#include "rede.hpp"
+#include <cctype>
+#include <cstdlib>
+#include <ctime>
+#include <filesystem>
+#include <functional>
+#include <utility>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+using Cabecalhos = std::vector<std::pair<std::string, std::string>>;
+
+std::string minusculas(std::string texto) {
+    for (char& c : texto) {
+        c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+    }
+    return texto;
+}
+
+std::string data_http(std::time_t instante) {
+    std::tm utc{};
+    ::gmtime_r(&instante, &utc);
+    char texto[64];
+    std::strftime(texto, sizeof(texto), "%a, %d %b %Y %H:%M:%S GMT", &utc);
+    return texto;
+}
+
+std::string etag_de(const std::string& dados) {
+    return "\"" + std::to_string(std::hash<std::string>()(dados)) + "\"";
+}
+
+const char* texto_status(int status) {
+    switch (status) {
+        case 200: return "OK";
+        case 204: return "No Content";
+        case 400: return "Bad Request";
+        case 404: return "Not Found";
+        default: return "Method Not Allowed";
+    }
+}
+
+void envia_resposta(ConexaoTcp& conexao, int status, const Cabecalhos& cabecalhos, const std::string& corpo,
+                    bool com_corpo = true) {
+    std::string texto = "HTTP/1.1 " + std::to_string(status) + " " + texto_status(status) + "\r\n";
+    bool tem_tamanho = false;
+    for (const auto& [nome, valor] : cabecalhos) {
+        texto += nome + ": " + valor + "\r\n";
+        tem_tamanho = tem_tamanho || nome == "Content-Length";
+    }
+    if (!tem_tamanho && status != 204) {
+        texto += "Content-Length: " + std::to_string(corpo.size()) + "\r\n";
+    }
+    texto += "\r\n";
+    if (com_corpo) {
+        texto += corpo;
+    }
+    conexao.envia(texto);
+}
+
+std::string erro_xml(const std::string& codigo) {
+    return "<?xml version=\"1.0\" encoding=\"UTF-8\"?><Error><Code>" + codigo + "</Code></Error>";
+}
+
+}  // namespace
+
+struct ServidorObjetosLocal::Requisicao {
+    std::string metodo;
+    std::string chave;
+    std::map<std::string, std::string> parametros;
+    std::map<std::string, std::string> cabecalhos;  ///< Nomes em minusculas.
+    std::string corpo;
+
+    std::map<std::string, std::string> metadados() const {
+        std::map<std::string, std::string> resultado;
+        for (const auto& [nome, valor] : cabecalhos) {
+            if (nome.compare(0, 11, "x-amz-meta-") == 0) {
+                resultado[nome] = valor;
+            }
+        }
+        return resultado;
+    }
+};
+
+// ==============================================================================
+// CICLO DE VIDA
+// ==============================================================================
+
+ServidorObjetosLocal::ServidorObjetosLocal(std::uint16_t porta)
+    : escuta_(std::make_unique<EscutaTcp>("127.0.0.1", porta)),
+      aceitacao_(&ServidorObjetosLocal::aceita_conexoes, this) {}
+
+ServidorObjetosLocal::~ServidorObjetosLocal() {
+    escuta_->interrompe();
+    aceitacao_.join();
+    {
+        std::lock_guard<std::mutex> trava(mutex_);
+        encerrando_ = true;
+        for (ConexaoTcp* conexao : conexoes_) {
+            conexao->interrompe();
+        }
+    }
+    for (auto& atendente : atendentes_) {
+        atendente.join();
+    }
+}
+
+std::uint16_t ServidorObjetosLocal::porta() const {
+    return escuta_->porta();
+}
+
+void ServidorObjetosLocal::aceita_conexoes() {
+    for (int fd; (fd = escuta_->aceita()) >= 0;) {
+        auto* conexao = new ConexaoTcp(fd, "cliente");
+        std::lock_guard<std::mutex> trava(mutex_);
+        conexoes_.insert(conexao);
+        atendentes_.emplace_back(&ServidorObjetosLocal::atende, this, conexao);
+    }
+}
+
+void ServidorObjetosLocal::atende(ConexaoTcp* conexao) {
+    try {
+        std::string linha;
+        while (conexao->le_linha(linha)) {
+            // GET /bucket/chave?parametros HTTP/1.1
+            Requisicao requisicao;
+            std::size_t espaco = linha.find(' ');
+            std::size_t fim_alvo = linha.find(' ', espaco + 1);
+            if (espaco == std::string::npos || fim_alvo == std::string::npos) {
+                break;
+            }
+            requisicao.metodo = linha.substr(0, espaco);
+            std::string alvo = linha.substr(espaco + 1, fim_alvo - espaco - 1);
+            std::size_t interrogacao = alvo.find('?');
+            if (interrogacao != std::string::npos) {
+                std::string consulta = alvo.substr(interrogacao + 1);
+                alvo.erase(interrogacao);
+                for (std::size_t i = 0; i < consulta.size();) {
+                    std::size_t fim = consulta.find('&', i);
+                    if (fim == std::string::npos) {
+                        fim = consulta.size();
+                    }
+                    std::string parametro = consulta.substr(i, fim - i);
+                    std::size_t igual = parametro.find('=');
+                    requisicao.parametros[decodifica_uri(parametro.substr(0, igual))] =
+                        (igual == std::string::npos) ? std::string() : decodifica_uri(parametro.substr(igual + 1));
+                    i = fim + 1;
+                }
+            }
+            requisicao.chave = decodifica_uri(alvo.substr(alvo.find_first_not_of('/') == std::string::npos
+                                                              ? alvo.size()
+                                                              : alvo.find_first_not_of('/')));
+
+            while (conexao->le_linha(linha) && !linha.empty()) {
+                std::size_t dois_pontos = linha.find(':');
+                if (dois_pontos != std::string::npos) {
+                    std::size_t valor = linha.find_first_not_of(' ', dois_pontos + 1);
+                    requisicao.cabecalhos[minusculas(linha.substr(0, dois_pontos))] =
+                        (valor == std::string::npos) ? std::string() : linha.substr(valor);
+                }
+            }
+            auto tamanho = requisicao.cabecalhos.find("content-length");
+            if (tamanho != requisicao.cabecalhos.end()) {
+                requisicao.corpo.resize(std::strtoull(tamanho->second.c_str(), nullptr, 10));
+                conexao->le_exato(&requisicao.corpo[0], requisicao.corpo.size());
+            }
+            responde(*conexao, requisicao);
+        }
+    } catch (const fs::filesystem_error&) {
+        // Cliente desconectou ou o servidor esta encerrando
+    }
+
+    std::lock_guard<std::mutex> trava(mutex_);
+    conexoes_.erase(conexao);
+    delete conexao;
+}
+
+// ==============================================================================
+// API S3
+// ==============================================================================
+
+void ServidorObjetosLocal::responde(ConexaoTcp& conexao, const Requisicao& requisicao) {
+    const std::string& metodo = requisicao.metodo;
+    const auto& parametros = requisicao.parametros;
+    int status = 200;
+    Cabecalhos cabecalhos;
+    std::string corpo;
+    bool com_corpo = true;
+    {
+        std::lock_guard<std::mutex> trava(mutex_);
+        ++contagem_[metodo];
+
+        if (metodo == "HEAD" || metodo == "GET") {
+            auto it = objetos_.find(requisicao.chave);
+            com_corpo = (metodo == "GET");
+            if (it == objetos_.end()) {
+                status = 404;
+                corpo = erro_xml("NoSuchKey");
+            } else {
+                cabecalhos.emplace_back("Content-Length", std::to_string(it->second.dados.size()));
+                cabecalhos.emplace_back("ETag", etag_de(it->second.dados));
+                cabecalhos.emplace_back("Last-Modified", data_http(std::time(nullptr)));
+                for (const auto& [nome, valor] : it->second.metadados) {
+                    cabecalhos.emplace_back(nome, valor);
+                }
+                if (com_corpo) {
+                    corpo = it->second.dados;
+                }
+            }
+        } else if (metodo == "PUT" && parametros.count("partNumber") != 0) {
+            auto upload = uploads_.find(parametros.count("uploadId") ? parametros.at("uploadId") : "");
+            if (upload == uploads_.end()) {
+                status = 404;
+                corpo = erro_xml("NoSuchUpload");
+            } else {
+                upload->second.partes[std::atoi(parametros.at("partNumber").c_str())] = requisicao.corpo;
+                cabecalhos.emplace_back("ETag", etag_de(requisicao.corpo));
+            }
+        } else if (metodo == "PUT" && requisicao.cabecalhos.count("x-amz-copy-source") != 0) {
+            std::string origem = decodifica_uri(requisicao.cabecalhos.at("x-amz-copy-source"));
+            origem.erase(0, origem.find_first_not_of('/'));
+            auto it = objetos_.find(origem);
+            if (it == objetos_.end()) {
+                status = 404;
+                corpo = erro_xml("NoSuchKey");
+            } else {
+                Objeto copia = it->second;
+                auto diretiva = requisicao.cabecalhos.find("x-amz-metadata-directive");
+                if (diretiva != requisicao.cabecalhos.end() && diretiva->second == "REPLACE") {
+                    copia.metadados = requisicao.metadados();
+                }
+                corpo = "<CopyObjectResult><ETag>" + etag_de(copia.dados) + "</ETag></CopyObjectResult>";
+                objetos_[requisicao.chave] = std::move(copia);
+            }
+        } else if (metodo == "PUT") {
+            objetos_[requisicao.chave] = Objeto{requisicao.corpo, requisicao.metadados()};
+            cabecalhos.emplace_back("ETag", etag_de(requisicao.corpo));
+        } else if (metodo == "POST" && parametros.count("uploads") != 0) {
+            const std::string id = "upload-" + std::to_string(proximo_upload_++);
+            uploads_[id] = Upload{requisicao.chave, requisicao.metadados(), {}};
+            corpo = "<InitiateMultipartUploadResult><Key>" + requisicao.chave + "</Key><UploadId>" + id +
+                    "</UploadId></InitiateMultipartUploadResult>";
+        } else if (metodo == "POST" && parametros.count("uploadId") != 0) {
+            auto upload = uploads_.find(parametros.at("uploadId"));
+            if (upload == uploads_.end()) {
+                status = 404;
+                corpo = erro_xml("NoSuchUpload");
+            } else {
+                // Junta as partes na ordem listada pelo cliente
+                Objeto objeto{std::string(), upload->second.metadados};
+                const std::string marca = "<PartNumber>";
+                for (std::size_t pos = requisicao.corpo.find(marca); pos != std::string::npos;
+                     pos = requisicao.corpo.find(marca, pos + 1)) {
+                    auto parte = upload->second.partes.find(std::atoi(requisicao.corpo.c_str() + pos + marca.size()));
+                    if (parte == upload->second.partes.end()) {
+                        status = 400;
+                        break;
+                    }
+                    objeto.dados += parte->second;
+                }
+                if (status == 200) {
+                    corpo = "<CompleteMultipartUploadResult><Key>" + requisicao.chave + "</Key><ETag>" +
+                            etag_de(objeto.dados) + "</ETag></CompleteMultipartUploadResult>";
+                    objetos_[upload->second.chave] = std::move(objeto);
+                    uploads_.erase(upload);
+                    ++multipart_concluidos_;
+                } else {
+                    corpo = erro_xml("InvalidPart");
+                }
+            }
+        } else if (metodo == "DELETE") {
+            if (parametros.count("uploadId") != 0) {
+                uploads_.erase(parametros.at("uploadId"));
+            } else {
+                objetos_.erase(requisicao.chave);
+            }
+            status = 204;
+        } else {
+            status = 405;
+            corpo = erro_xml("MethodNotAllowed");
+        }
+    }
+    if (!com_corpo && status == 404) {
+        corpo.clear();
+    }
+    envia_resposta(conexao, status, cabecalhos, corpo, com_corpo);
+}
+
+// ==============================================================================
+// INSPECAO (TESTES)
+// ==============================================================================
+
+bool ServidorObjetosLocal::existe(const std::string& chave) const {
+    std::lock_guard<std::mutex> trava(mutex_);
+    return objetos_.count(chave) != 0;
+}
+
+std::string ServidorObjetosLocal::conteudo(const std::string& chave) const {
+    std::lock_guard<std::mutex> trava(mutex_);
+    auto it = objetos_.find(chave);
+    return (it == objetos_.end()) ? std::string() : it->second.dados;
+}
+
+std::string ServidorObjetosLocal::metadado(const std::string& chave, const std::string& nome) const {
+    std::lock_guard<std::mutex> trava(mutex_);
+    auto it = objetos_.find(chave);
+    if (it == objetos_.end()) {
+        return std::string();
+    }
+    auto valor = it->second.metadados.find("x-amz-meta-" + nome);
+    return (valor == it->second.metadados.end()) ? std::string() : valor->second;
+}
+
+std::size_t ServidorObjetosLocal::total_objetos() const {
+    std::lock_guard<std::mutex> trava(mutex_);
+    return objetos_.size();
+}
+
+std::uint64_t ServidorObjetosLocal::requisicoes(const std::string& metodo) const {
+    std::lock_guard<std::mutex> trava(mutex_);
+    auto it = contagem_.find(metodo);
+    return (it == contagem_.end()) ? 0 : it->second;
+}
+
+std::uint64_t ServidorObjetosLocal::uploads_multipart() const {
+    std::lock_guard<std::mutex> trava(mutex_);
+    return multipart_concluidos_;
+}
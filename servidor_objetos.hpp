@@ -0,0 +1,76 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef SERVIDOR_OBJETOS_HPP
+#define SERVIDOR_OBJETOS_HPP
+
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+class ConexaoTcp;
+class EscutaTcp;
+
+/**
+ * @brief Servidor S3 minimo em memoria, no proprio processo, para testes e benchmarks.
+ * @details Escuta em 127.0.0.1 e atende o subconjunto da API usado pelo
+ * ArmazenamentoObjetos: HEAD, GET, PUT (inclusive copia com x-amz-copy-source), DELETE
+ * e upload multipart. As chaves sao o caminho completo ("bucket/objeto"); assinaturas
+ * nao sao conferidas. Cada conexao e atendida por uma thread, em ordem, o que aceita
+ * requisicoes em pipeline.
+ */
+class ServidorObjetosLocal {
+ public:
+    /** @param porta 0 escolhe uma porta livre (consulte porta()). */
+    explicit ServidorObjetosLocal(std::uint16_t porta = 0);
+    ~ServidorObjetosLocal();
+    ServidorObjetosLocal(const ServidorObjetosLocal&) = delete;
+    ServidorObjetosLocal& operator=(const ServidorObjetosLocal&) = delete;
+
+    std::uint16_t porta() const;
+
+    bool existe(const std::string& chave) const;
+    std::string conteudo(const std::string& chave) const;
+    /** @return Valor de x-amz-meta-<nome> ("" se ausente). */
+    std::string metadado(const std::string& chave, const std::string& nome) const;
+    std::size_t total_objetos() const;
+    /** @brief Requisicoes recebidas com o metodo (ex: "HEAD"). */
+    std::uint64_t requisicoes(const std::string& metodo) const;
+    /** @brief Uploads multipart concluidos. */
+    std::uint64_t uploads_multipart() const;
+
+ private:
+    struct Objeto {
+        std::string dados;
+        std::map<std::string, std::string> metadados;  ///< Nome completo (x-amz-meta-...).
+    };
+    struct Upload {
+        std::string chave;
+        std::map<std::string, std::string> metadados;
+        std::map<int, std::string> partes;
+    };
+    struct Requisicao;
+
+    void aceita_conexoes();
+    void atende(ConexaoTcp* conexao);
+    void responde(ConexaoTcp& conexao, const Requisicao& requisicao);
+
+    std::unique_ptr<EscutaTcp> escuta_;
+    std::thread aceitacao_;
+
+    mutable std::mutex mutex_;
+    std::map<std::string, Objeto> objetos_;
+    std::map<std::string, Upload> uploads_;
+    std::uint64_t proximo_upload_ = 1;
+    std::uint64_t multipart_concluidos_ = 0;
+    std::map<std::string, std::uint64_t> contagem_;
+    std::set<ConexaoTcp*> conexoes_;
+    std::vector<std::thread> atendentes_;
+    bool encerrando_ = false;
+};
+
+#endif  // SERVIDOR_OBJETOS_HPP
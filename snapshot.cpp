@@ -0,0 +1,595 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "snapshot.hpp"
+#include "catalogo.hpp"
+#include "concorrencia.hpp"
+#include "copia.hpp"
+#include "estatisticas.hpp"
+#include "limites.hpp"
+#include "paralelo.hpp"
+#include "verificacao.hpp"
+#include "vinculos.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+// Sufixo do diretorio enquanto o snapshot ainda esta sendo montado
+const char* const SUFIXO_PARCIAL = ".parcial";
+// Sufixo do arquivo de trava do snapshot em montagem, ao lado do ".parcial"
+const char* const SUFIXO_TRAVA = ".trava";
+
+/** Acao tomada para cada arquivo do snapshot. */
+enum AcaoSnapshot {
+    ACAO_NENHUMA = 0,
+    ACAO_COPIADO = 1,
+    ACAO_VINCULADO = 2,
+    ACAO_IGNORADO = 3
+};
+
+bool sem_suporte_a_hardlink(const std::error_code& erro) {
+    return erro == std::errc::operation_not_permitted ||
+           erro == std::errc::operation_not_supported ||
+           erro == std::errc::cross_device_link ||
+           erro == std::errc::too_many_links;
+}
+
+/**
+ * @brief Trava exclusiva (flock) do arquivo "<snapshot>.trava" enquanto o snapshot e montado.
+ * @details Separa a montagem em andamento de outra execucao, que mantem a trava, da sobra
+ * de uma execucao interrompida, cuja trava o kernel ja liberou. A trava e tomada antes de
+ * o ".parcial" existir, entao a varredura de outra execucao nunca encontra um ".parcial"
+ * recem-criado destravado. O arquivo so e removido por quem detem a trava; por isso,
+ * depois do flock, confere que o caminho ainda e o arquivo travado (senao a trava e de um
+ * arquivo ja desvinculado e nao protege nada).
+ */
+class TravaParcial {
+ public:
+    /** @param reserva Cria o arquivo com O_EXCL: falha se o nome ja esta reservado. */
+    TravaParcial(const std::string& caminho, bool reserva)
+        : caminho_(caminho),
+          fd_(::open(caminho.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | (reserva ? O_EXCL : 0), 0644)) {
+        erro_ = fd_ < 0 ? errno : 0;
+        struct stat travado, atual;
+        if (fd_ >= 0 && (::flock(fd_, LOCK_EX | LOCK_NB) != 0 || ::fstat(fd_, &travado) != 0 ||
+                         ::stat(caminho.c_str(), &atual) != 0 || travado.st_dev != atual.st_dev ||
+                         travado.st_ino != atual.st_ino)) {
+            ::close(fd_);
+            fd_ = -1;
+        }
+    }
+    /** @brief Remove o arquivo de trava, ainda travado, e so entao a libera. */
+    ~TravaParcial() {
+        if (fd_ >= 0) {
+            ::unlink(caminho_.c_str());
+            ::close(fd_);
+        }
+    }
+    TravaParcial(const TravaParcial&) = delete;
+    TravaParcial& operator=(const TravaParcial&) = delete;
+
+    bool obtida() const { return fd_ >= 0; }
+    /** @brief errno da abertura (EEXIST: nome ja reservado); 0 se abriu. */
+    int erro() const { return erro_; }
+
+ private:
+    std::string caminho_;
+    int fd_;
+    int erro_ = 0;
+};
+
+/**
+ * @brief Ordem cronologica de nomes de snapshot.
+ * @details Sufixos ".N" so aparecem dentro do mesmo segundo, entao a ordem lexica do
+ * instante decide e o sufixo desempata numericamente.
+ */
+bool snapshot_anterior_a(const std::string& a, const std::string& b) {
+    std::string base_a = a.substr(0, 17), base_b = b.substr(0, 17);
+    if (base_a != base_b) {
+        return base_a < base_b;
+    }
+    auto sufixo = [](const std::string& s) {
+        return s.size() > 17 ? std::stoul(s.substr(18)) : 0UL;
+    };
+    return sufixo(a) < sufixo(b);
+}
+
+/**
+ * @brief Remove os ".parcial" deixados por execucoes interrompidas (queda, kill -9, erro).
+ * @details Ninguem mais os publicaria: sem a varredura cada interrupcao deixaria uma copia
+ * inteira ocupando o destino. Os que ainda estao travados pertencem a uma execucao viva.
+ * Arquivos de trava sem ".parcial" (queda logo apos a reserva do nome) saem junto.
+ * @param retomar Preserva o ".parcial" abandonado mais recente (--resume) em vez de remove-lo.
+ * @param preservado Recebe o nome do snapshot preservado ("" se nenhum).
+ * @return A trava do preservado, mantida ate que ele seja aproveitado.
+ */
+std::unique_ptr<TravaParcial> remove_parciais_abandonados(const std::string& caminho_destino_base, bool retomar,
+                                                          std::string& preservado) {
+    std::set<std::string> abandonados, diretorios;
+    std::error_code erro;
+    for (fs::directory_iterator it(caminho_destino_base, erro), fim; !erro && it != fim; it.increment(erro)) {
+        std::string nome = it->path().filename().string();
+        for (const std::string sufixo : {SUFIXO_PARCIAL, SUFIXO_TRAVA}) {
+            if (nome.size() > sufixo.size() && nome.compare(nome.size() - sufixo.size(), sufixo.size(), sufixo) == 0 &&
+                eh_nome_snapshot(nome.substr(0, nome.size() - sufixo.size()))) {
+                abandonados.insert(nome.substr(0, nome.size() - sufixo.size()));
+                if (sufixo == SUFIXO_PARCIAL && it->is_directory(erro)) {
+                    diretorios.insert(nome.substr(0, nome.size() - sufixo.size()));
+                }
+            }
+        }
+    }
+
+    std::vector<std::string> nomes(abandonados.begin(), abandonados.end());
+    std::sort(nomes.begin(), nomes.end(), snapshot_anterior_a);
+    std::unique_ptr<TravaParcial> trava_preservado;
+    preservado.clear();
+    for (auto it = nomes.rbegin(); it != nomes.rend(); ++it) {
+        auto trava = std::make_unique<TravaParcial>(caminho_destino_base + "/" + *it + SUFIXO_TRAVA, false);
+        if (!trava->obtida()) {
+            continue;
+        }
+        if (retomar && preservado.empty() && diretorios.count(*it) > 0) {
+            preservado = *it;
+            trava_preservado = std::move(trava);
+            continue;
+        }
+        std::error_code ignora;
+        fs::remove_all(caminho_destino_base + "/" + *it + SUFIXO_PARCIAL, ignora);
+    }
+    return trava_preservado;
+}
+
+/**
+ * @brief Reaproveita o arquivo do snapshot anterior no novo snapshot.
+ * @details Em sistemas sem hardlink (FAT/exFAT) ou com o limite de links atingido,
+ * recorre a uma copia do snapshot anterior, que preserva a data de modificacao.
+ */
+ResultadoBackup vincula_arquivo(const std::string& anterior, const std::string& novo) {
+    MEDE_FASE_DE(FASE_VINCULO, novo.c_str());
+    limita_metadados();
+    std::error_code erro;
+    fs::create_hard_link(anterior, novo, erro);
+    if (!erro) {
+        return SUCESSO;
+    }
+    if (!sem_suporte_a_hardlink(erro)) {
+        std::cerr << "Erro ao vincular " << novo << ": " << erro.message() << std::endl;
+        return ERRO_GERAL;
+    }
+    try {
+        InfoCopia info;
+        copia_arquivo(anterior, novo, info);
+        return SUCESSO;
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Erro de copia (snapshot sem hardlink): " << e.what() << std::endl;
+        return ERRO_GERAL;
+    }
+}
+
+/**
+ * @brief Reconstroi o catalogo a partir dos manifestos de snapshots ja existentes.
+ * @details Cobre destinos criados antes do catalogo: cada mudanca de checksum entre
+ * snapshots consecutivos vira uma versao, localizada no snapshot onde apareceu.
+ */
+ResultadoBackup reconstroi_catalogo(const std::string& caminho_destino_base,
+                                    const std::vector<std::string>& snapshots, Catalogo& catalogo) {
+    std::vector<VersaoCatalogo> versoes;
+    Manifesto vigente;
+    for (const auto& snapshot : snapshots) {
+        Manifesto manifesto;
+        le_manifesto(caminho_destino_base + "/" + snapshot + "/" + NOME_MANIFESTO, manifesto);
+        for (const auto& [caminho, entrada] : manifesto) {
+            auto atual = vigente.find(caminho);
+            if (atual == vigente.end() || atual->second.checksum != entrada.checksum ||
+                atual->second.bytes != entrada.bytes) {
+                versoes.push_back(VersaoCatalogo{caminho, versao_do_snapshot(snapshot), snapshot,
+                                                 entrada.checksum, entrada.bytes});
+                vigente[caminho] = entrada;
+            }
+        }
+    }
+    return catalogo.reescreve(std::move(versoes));
+}
+
+}  // namespace
+
+// ==============================================================================
+// NOMES E LISTAGEM DE SNAPSHOTS
+// ==============================================================================
+
+std::string nome_snapshot_para(std::time_t instante) {
+    std::tm partes{};
+    gmtime_r(&instante, &partes);
+    char buffer[32];
+    std::strftime(buffer, sizeof(buffer), "%Y-%m-%d_%H%M%S", &partes);
+    return buffer;
+}
+
+bool eh_nome_snapshot(const std::string& nome) {
+    // Formato: AAAA-MM-DD_HHMMSS[.N]
+    static const std::string modelo = "dddd-dd-dd_dddddd";
+    if (nome.size() < modelo.size()) {
+        return false;
+    }
+    for (std::size_t i = 0; i < modelo.size(); ++i) {
+        bool digito = std::isdigit(static_cast<unsigned char>(nome[i])) != 0;
+        if ((modelo[i] == 'd') != digito || (modelo[i] != 'd' && nome[i] != modelo[i])) {
+            return false;
+        }
+    }
+    if (nome.size() == modelo.size()) {
+        return true;
+    }
+    if (nome[modelo.size()] != '.' || nome.size() == modelo.size() + 1) {
+        return false;
+    }
+    return std::all_of(nome.begin() + modelo.size() + 1, nome.end(),
+                       [](char c) { return std::isdigit(static_cast<unsigned char>(c)) != 0; });
+}
+
+std::vector<std::string> lista_snapshots(const std::string& caminho_destino_base) {
+    std::vector<std::string> snapshots;
+    std::error_code erro;
+    for (fs::directory_iterator it(caminho_destino_base, erro), fim; !erro && it != fim; it.increment(erro)) {
+        std::string nome = it->path().filename().string();
+        if (it->is_directory(erro) && eh_nome_snapshot(nome)) {
+            snapshots.push_back(nome);
+        }
+    }
+    std::sort(snapshots.begin(), snapshots.end(), snapshot_anterior_a);
+    return snapshots;
+}
+
+// ==============================================================================
+// BACKUP EM MODO SNAPSHOT
+// ==============================================================================
+
+ResultadoBackup executa_backup_snapshot(const std::string& nome_arquivo_parm,
+                                        const std::string& caminho_origem_base,
+                                        const std::string& caminho_destino_base,
+                                        unsigned trabalhadores,
+                                        RelatorioSnapshot& relatorio,
+                                        bool retomar) {
+    // Assertiva de entrada
+    assert(!nome_arquivo_parm.empty());
+    assert(!caminho_origem_base.empty());
+    assert(!caminho_destino_base.empty());
+
+    std::vector<std::string> arquivos;
+    ResultadoBackup resultado = le_arquivo_parametros(nome_arquivo_parm, arquivos);
+    if (resultado != SUCESSO) {
+        return resultado;
+    }
+    SessaoVinculos vinculos;  // Nomes do mesmo inode viram hardlinks dentro do snapshot
+
+    std::error_code erro_base;
+    fs::create_directories(caminho_destino_base, erro_base);
+    if (erro_base) {
+        std::cerr << "Erro ao criar " << caminho_destino_base << ": " << erro_base.message() << std::endl;
+        return ERRO_GERAL;
+    }
+    std::unique_ptr<TravaParcial> trava_retomado =
+        remove_parciais_abandonados(caminho_destino_base, retomar, relatorio.retomado);
+    std::vector<std::string> existentes = lista_snapshots(caminho_destino_base);
+    relatorio.anterior = existentes.empty() ? "" : existentes.back();
+
+    // Nome do novo snapshot (com sufixo se ja houver um no mesmo segundo), reservado pela
+    // trava antes de o ".parcial" existir
+    const std::string instante = nome_snapshot_para(std::time(nullptr));
+    std::string nome = instante;
+    std::unique_ptr<TravaParcial> trava_parcial;
+    for (int n = 1;; nome = instante + "." + std::to_string(n++)) {
+        std::error_code erro;
+        const bool ocupado = fs::exists(caminho_destino_base + "/" + nome, erro) ||
+                             (!erro && fs::exists(caminho_destino_base + "/" + nome + SUFIXO_PARCIAL, erro));
+        if (erro) {
+            std::cerr << "Erro ao consultar " << caminho_destino_base << ": " << erro.message() << std::endl;
+            return ERRO_GERAL;
+        }
+        if (ocupado) {
+            continue;
+        }
+        trava_parcial = std::make_unique<TravaParcial>(caminho_destino_base + "/" + nome + SUFIXO_TRAVA, true);
+        if (trava_parcial->obtida()) {
+            break;
+        }
+        if (trava_parcial->erro() != 0 && trava_parcial->erro() != EEXIST) {
+            std::cerr << "Erro ao travar o snapshot " << nome << ": " << std::strerror(trava_parcial->erro())
+                      << std::endl;
+            return ERRO_GERAL;
+        }
+    }
+    relatorio.nome = nome;
+
+    const std::string base_anterior = caminho_destino_base + "/" + relatorio.anterior;
+    const std::string base_parcial = caminho_destino_base + "/" + nome + SUFIXO_PARCIAL;
+
+    // Cria toda a arvore de diretorios antes da etapa paralela (cada pasta uma unica vez).
+    // Na retomada o ".parcial" interrompido passa a ser o deste snapshot: copias grandes
+    // continuam dos checkpoints "<arquivo>.retomada" que ficaram nele
+    try {
+        MEDE_FASE(FASE_DIRETORIOS);
+        if (trava_retomado) {
+            fs::rename(caminho_destino_base + "/" + relatorio.retomado + SUFIXO_PARCIAL, base_parcial);
+            trava_retomado.reset();
+        }
+        fs::create_directories(base_parcial);
+        std::set<fs::path> diretorios;
+        for (const auto& arquivo : arquivos) {
+            diretorios.insert(fs::path(base_parcial + "/" + arquivo).parent_path());
+        }
+        for (const auto& diretorio : diretorios) {
+            fs::create_directories(diretorio);
+        }
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Erro ao criar diretorios: " << e.what() << std::endl;
+        return ERRO_GERAL;
+    }
+
+    // Com concorrencia adaptativa todas as threads sobem e os controles de cada dispositivo
+    // decidem quantas operam ao mesmo tempo
+    const unsigned maximo_adaptativo = concorrencia_adaptativa();
+    if (maximo_adaptativo > 0) {
+        trabalhadores = maximo_adaptativo;
+    }
+    struct stat st_destino;
+    const dev_t dispositivo_destino = ::stat(base_parcial.c_str(), &st_destino) == 0 ? st_destino.st_dev : 0;
+
+    std::vector<AcaoSnapshot> acoes(arquivos.size(), ACAO_NENHUMA);
+    std::vector<InfoCopia> infos(arquivos.size());
+    std::atomic<bool> abortar{false};
+    std::mutex trava;
+    std::size_t indice_erro = arquivos.size();
+    ResultadoBackup erro_item = SUCESSO;
+
+    executa_em_paralelo(arquivos.size(), trabalhadores, [&](std::size_t i, unsigned) {
+        if (abortar.load(std::memory_order_relaxed)) {
+            return;
+        }
+        const std::string origem = caminho_origem_base + "/" + arquivos[i];
+        const std::string anterior = base_anterior + "/" + arquivos[i];
+        const std::string novo = base_parcial + "/" + arquivos[i];
+
+        std::error_code erro, erro_sobra;
+        if (!relatorio.retomado.empty()) {
+            // Sobra da execucao interrompida: o vinculo falharia com EEXIST e a copia a
+            // substituiria de qualquer forma (o checkpoint fica em "<novo>.retomada")
+            limita_metadados();
+            fs::remove(novo, erro_sobra);
+        }
+        limita_metadados(2);  // stat da origem e do anterior
+        struct stat st_origem;
+        bool origem_existe = ::stat(origem.c_str(), &st_origem) == 0;
+        // So "nao existe" conta como ausente: EACCES, EIO etc. nao podem virar Caso 6/7
+        const int erro_origem = origem_existe ? 0 : errno;
+        const bool origem_ilegivel = !origem_existe && erro_origem != ENOENT && erro_origem != ENOTDIR;
+        bool anterior_existe = !relatorio.anterior.empty() && fs::exists(anterior, erro);
+        PermissoesDispositivos permissoes =
+            adquire_dispositivos(origem_existe ? st_origem.st_dev : dispositivo_destino, dispositivo_destino);
+
+        ResultadoBackup item = SUCESSO;
+        if (erro_sobra) {
+            std::cerr << "Erro ao remover " << novo << ": " << erro_sobra.message() << std::endl;
+            item = ERRO_GERAL;
+        } else if (origem_ilegivel || erro) {
+            std::cerr << "Erro ao consultar " << (origem_ilegivel ? origem : anterior) << ": "
+                      << (origem_ilegivel ? std::strerror(erro_origem) : erro.message()) << std::endl;
+            item = ERRO_GERAL;
+        } else if (!origem_existe) {
+            // CASO 7: mantem no snapshot o que ja estava no backup. CASO 6: nada a fazer.
+            if (anterior_existe) {
+                CONTA_CASO(7);
+                item = vincula_arquivo(anterior, novo);
+                acoes[i] = ACAO_VINCULADO;
+            } else {
+                CONTA_CASO(6);
+                acoes[i] = ACAO_IGNORADO;
+            }
+        } else if (!anterior_existe) {
+            // CASO 2: arquivo novo
+            CONTA_CASO(2);
+            item = copia_arquivo_decidido(origem, novo, &infos[i]);
+            acoes[i] = ACAO_COPIADO;
+        } else {
+            std::error_code erro_anterior;
+            auto tempo_origem = fs::last_write_time(origem, erro);
+            auto tempo_anterior = fs::last_write_time(anterior, erro_anterior);
+            if (erro || erro_anterior) {
+                std::cerr << "Erro ao consultar " << (erro ? origem : anterior) << ": "
+                          << (erro ? erro : erro_anterior).message() << std::endl;
+                item = ERRO_GERAL;
+            } else if (tempo_anterior < tempo_origem) {
+                // CASO 3: versao nova e escrita em arquivo proprio; a antiga fica no snapshot anterior
+                CONTA_CASO(3);
+                item = copia_arquivo_decidido(origem, novo, &infos[i]);
+                acoes[i] = ACAO_COPIADO;
+            } else if (tempo_anterior == tempo_origem) {
+                // CASO 4: inalterado, so metadados
+                CONTA_CASO(4);
+                item = vincula_arquivo(anterior, novo);
+                acoes[i] = ACAO_VINCULADO;
+            } else {
+                // CASO 5: backup mais novo que a origem
+                CONTA_CASO(5);
+                item = ERRO_ARQUIVO_DESTINO_MAIS_NOVO;
+            }
+        }
+
+        permissoes.conclui(infos[i].bytes);
+        if (item != SUCESSO && item != IGNORAR) {
+            abortar.store(true, std::memory_order_relaxed);
+            std::lock_guard<std::mutex> guarda(trava);
+            if (i < indice_erro) {
+                indice_erro = i;
+                erro_item = item;
+            }
+        }
+    });
+
+    // Em caso de erro o ".parcial" fica, destravado: a execucao seguinte o remove ou, com
+    // --resume, continua nele
+    if (erro_item != SUCESSO) {
+        return erro_item;
+    }
+
+    // Manifesto do snapshot: herda os checksums dos arquivos vinculados
+    Manifesto manifesto_anterior, manifesto;
+    if (!relatorio.anterior.empty()) {
+        MEDE_FASE(FASE_MANIFESTO);
+        le_manifesto(base_anterior + "/" + NOME_MANIFESTO, manifesto_anterior);
+    }
+    for (std::size_t i = 0; i < arquivos.size(); ++i) {
+        if (acoes[i] == ACAO_COPIADO) {
+            manifesto[arquivos[i]] = EntradaManifesto{infos[i].checksum, infos[i].bytes};
+            ++relatorio.copiados;
+        } else if (acoes[i] == ACAO_VINCULADO) {
+            auto herdada = manifesto_anterior.find(arquivos[i]);
+            if (herdada != manifesto_anterior.end()) {
+                manifesto[arquivos[i]] = herdada->second;
+            }
+            ++relatorio.vinculados;
+        } else {
+            ++relatorio.ignorados;
+        }
+    }
+
+    // O snapshot so e publicado com as copias ja duraveis
+    if (!confirma_copias()) {
+        return ERRO_GERAL;
+    }
+    {
+        MEDE_FASE(FASE_MANIFESTO);
+        resultado = grava_manifesto(base_parcial + "/" + NOME_MANIFESTO, manifesto);
+    }
+
+    // Registra no catalogo as versoes gravadas neste snapshot ANTES de publica-lo: uma
+    // queda entre os dois deixa no catalogo versoes de um snapshot que nunca apareceu, e a
+    // restauracao as ignora; na ordem inversa o snapshot ficaria visivel fora do catalogo
+    if (resultado == SUCESSO) {
+        std::vector<VersaoCatalogo> versoes;
+        const std::int64_t versao = versao_do_snapshot(nome);
+        for (std::size_t i = 0; i < arquivos.size(); ++i) {
+            if (acoes[i] == ACAO_COPIADO) {
+                versoes.push_back(VersaoCatalogo{arquivos[i], versao, nome, infos[i].checksum, infos[i].bytes});
+            }
+        }
+        Catalogo catalogo(caminho_destino_base);
+        if (catalogo.segmentos() == 0 && !existentes.empty()) {
+            resultado = reconstroi_catalogo(caminho_destino_base, existentes, catalogo);
+        }
+        if (resultado == SUCESSO) {
+            MEDE_FASE(FASE_MANIFESTO);
+            resultado = catalogo.adiciona(std::move(versoes));
+        }
+        // Manifesto e segmento duraveis antes da renomeacao que publica o snapshot
+        if (resultado == SUCESSO && !confirma_diretorio_publicado(caminho_destino_base)) {
+            resultado = ERRO_GERAL;
+        }
+    }
+    if (resultado == SUCESSO) {
+        std::error_code erro;
+        fs::rename(base_parcial, caminho_destino_base + "/" + nome, erro);
+        if (erro) {
+            std::cerr << "Erro ao publicar snapshot: " << erro.message() << std::endl;
+            resultado = ERRO_GERAL;
+        } else if (!confirma_diretorio_publicado(caminho_destino_base)) {
+            return ERRO_GERAL;  // Publicado, mas sem garantia de sobreviver a uma queda
+        }
+    }
+    if (resultado != SUCESSO) {
+        return resultado;
+    }
+
+    // Assertiva de saida
+    assert(relatorio.copiados + relatorio.vinculados + relatorio.ignorados == arquivos.size());
+    return SUCESSO;
+}
+
+// ==============================================================================
+// RESTAURACAO PONTUAL (--as-of)
+// ==============================================================================
+
+ResultadoBackup executa_restauracao_snapshot(const std::string& nome_arquivo_parm,
+                                             const std::string& caminho_backup_base,
+                                             const std::string& caminho_destino_base,
+                                             std::time_t instante) {
+    // Assertiva de entrada
+    assert(!nome_arquivo_parm.empty());
+    assert(!caminho_backup_base.empty());
+    assert(!caminho_destino_base.empty());
+
+    std::vector<std::string> arquivos;
+    ResultadoBackup resultado = le_arquivo_parametros(nome_arquivo_parm, arquivos);
+    if (resultado != SUCESSO) {
+        return resultado;
+    }
+
+    Catalogo catalogo(caminho_backup_base);
+    const std::vector<std::string> snapshots = lista_snapshots(caminho_backup_base);
+    const std::set<std::string> publicados(snapshots.begin(), snapshots.end());
+    if (catalogo.segmentos() == 0) {
+        if (!snapshots.empty()) {
+            resultado = reconstroi_catalogo(caminho_backup_base, snapshots, catalogo);
+            if (resultado != SUCESSO) {
+                return resultado;
+            }
+        }
+    }
+    const std::int64_t versao_maxima = versao_limite(instante);
+    SessaoVinculos vinculos;  // Nomes que eram hardlinks no snapshot voltam a ser no HD
+
+    for (const auto& arquivo : arquivos) {
+        // Versoes de um snapshot que nao chegou a ser publicado (queda entre o catalogo e a
+        // renomeacao) nunca existiram: vale a anterior
+        VersaoCatalogo versao;
+        bool encontrada = catalogo.busca(arquivo, versao_maxima, versao);
+        while (encontrada && publicados.count(versao.snapshot) == 0) {
+            const std::int64_t limite = versao.versao - 1;
+            versao = VersaoCatalogo{};
+            encontrada = catalogo.busca(arquivo, limite, versao);
+        }
+        if (!encontrada) {
+            std::cerr << "Sem versao ate o instante pedido: " << arquivo << std::endl;
+            return ERRO_ARQUIVO_ORIGEM_NAO_EXISTE;
+        }
+
+        const std::string origem = caminho_backup_base + "/" + versao.snapshot + "/" + arquivo;
+        const std::string destino = caminho_destino_base + "/" + arquivo;
+        try {
+            fs::path destino_dir = fs::path(destino).parent_path();
+            if (!fs::exists(destino_dir)) {
+                fs::create_directories(destino_dir);
+            }
+        } catch (const fs::filesystem_error& e) {
+            std::cerr << "Erro ao criar diretorios: " << e.what() << std::endl;
+            return ERRO_GERAL;
+        }
+
+        InfoCopia info;
+        ResultadoBackup item = faz_backup_arquivo(origem, destino, RESTAURACAO, &info);
+        if (item == SUCESSO && (info.checksum != versao.checksum || info.bytes != versao.bytes)) {
+            std::cerr << "Checksum divergente do catalogo: " << origem << std::endl;
+            item = ERRO_CHECKSUM_DIVERGENTE;
+        }
+        if (item != SUCESSO && item != IGNORAR) {
+            return item;
+        }
+    }
+    return confirma_copias() ? SUCESSO : ERRO_GERAL;
+}
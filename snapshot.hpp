@@ -0,0 +1,82 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef SNAPSHOT_HPP
+#define SNAPSHOT_HPP
+
+#include "backup.hpp"
+#include <cstddef>
+#include <ctime>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Resumo de uma execucao do backup em modo snapshot.
+ */
+struct RelatorioSnapshot {
+    std::string nome;            ///< Nome do diretorio criado (ex: "2025-10-19_031500").
+    std::string anterior;        ///< Snapshot usado como base ("" no primeiro).
+    std::size_t copiados = 0;    ///< Arquivos escritos de novo (Casos 2 e 3).
+    std::size_t vinculados = 0;  ///< Arquivos inalterados reaproveitados por hardlink.
+    std::size_t ignorados = 0;   ///< Arquivos ausentes na origem e no snapshot anterior.
+    std::string retomado;        ///< ".parcial" interrompido aproveitado com retomar ("" se nenhum).
+};
+
+/**
+ * @brief Gera o nome de snapshot (UTC, "AAAA-MM-DD_HHMMSS") correspondente a um instante.
+ */
+std::string nome_snapshot_para(std::time_t instante);
+
+/**
+ * @brief Indica se um nome de diretorio segue o formato de snapshot.
+ * @details Aceita o sufixo ".N" usado quando dois snapshots caem no mesmo segundo.
+ */
+bool eh_nome_snapshot(const std::string& nome);
+
+/**
+ * @brief Lista os snapshots completos existentes no destino, do mais antigo ao mais novo.
+ */
+std::vector<std::string> lista_snapshots(const std::string& caminho_destino_base);
+
+/**
+ * @brief Backup versionado: cria destino/<instante>/ com a arvore completa.
+ * @details Arquivos inalterados desde o snapshot anterior (Caso 4) e arquivos ja
+ * removidos da origem (Caso 7) sao hardlinks para o snapshot anterior, custando so
+ * operacoes de metadados; apenas os Casos 2 e 3 sao copiados de fato. O snapshot e
+ * montado em um diretorio ".parcial" e renomeado ao final, de modo que uma execucao
+ * interrompida nunca e tomada como base. Cada arquivo copiado gera uma nova versao
+ * no catalogo (Backup.catalogo). O ".parcial" de uma execucao interrompida (queda ou
+ * erro) e removido pela execucao seguinte, a menos que ela peca para retomar.
+ * @param trabalhadores Numero de threads para a etapa de vinculo/copia (com a concorrencia
+ * adaptativa ligada, o teto dela; as operacoes simultaneas seguem cada dispositivo).
+ * @param relatorio Recebe o nome do snapshot criado e as contagens.
+ * @param retomar Monta o novo snapshot sobre o ".parcial" interrompido mais recente
+ * (--resume): as copias grandes continuam dos seus checkpoints (ver
+ * define_intervalo_checkpoint); os demais arquivos sao decididos e gravados de novo.
+ * @return SUCESSO ou o erro do primeiro arquivo (na ordem de Backup.parm) que falhou.
+ * @post Em caso de erro nenhum snapshot novo fica visivel.
+ */
+ResultadoBackup executa_backup_snapshot(const std::string& nome_arquivo_parm,
+                                        const std::string& caminho_origem_base,
+                                        const std::string& caminho_destino_base,
+                                        unsigned trabalhadores,
+                                        RelatorioSnapshot& relatorio,
+                                        bool retomar = false);
+
+/**
+ * @brief Restauracao pontual: traz cada arquivo como estava em um instante.
+ * @details A versao de cada arquivo e localizada no catalogo, sem percorrer os
+ * diretorios de snapshot, e copiada pela tabela de decisao de RESTAURACAO (por isso
+ * um HD com versao mais nova que a pedida resulta no Caso 8). O checksum da copia e
+ * conferido com o registrado no catalogo.
+ * @param caminho_backup_base Raiz do backup (onde ficam os snapshots e o catalogo).
+ * @param caminho_destino_base Para onde os arquivos serao restaurados.
+ * @param instante Momento desejado (UTC).
+ * @return SUCESSO ou o primeiro erro; ERRO_ARQUIVO_ORIGEM_NAO_EXISTE se o arquivo nao
+ * tinha versao ate o instante.
+ */
+ResultadoBackup executa_restauracao_snapshot(const std::string& nome_arquivo_parm,
+                                             const std::string& caminho_backup_base,
+                                             const std::string& caminho_destino_base,
+                                             std::time_t instante);
+
+#endif  // SNAPSHOT_HPP
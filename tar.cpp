@@ -0,0 +1,753 @@
+// Copyright 2025 Guilherme Nonato
+
+#include "tar.hpp"
+#include "armazenamento.hpp"
+#include "buffers.hpp"
+#include "estatisticas.hpp"
+#include "limites.hpp"
+#include "vinculos.hpp"
+#include <algorithm>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <system_error>
+#include <unordered_map>
+#include <vector>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+const std::size_t BLOCO_TAR = 512;
+
+// Buffer de cabecalhos e da copia sem splice (do pool_blocos): multiplo de BLOCO_TAR, alinhado a
+// pagina, para que as escritas cheguem ao pipe/disco em pedacos grandes e alinhados
+const std::size_t TAMANHO_BUFFER_TAR = TAMANHO_BUFFER_POOL;
+
+// Maior valor de cada campo numerico do cabecalho ustar (digitos octais + NUL)
+const std::uintmax_t MAXIMO_TAMANHO_USTAR = 077777777777ULL;
+const std::uintmax_t MAXIMO_ID_USTAR = 07777777ULL;
+
+// Limite de cada chamada a splice(): o kernel move no maximo o que cabe no pipe
+const std::size_t MAXIMO_SPLICE = 1 << 30;
+
+// Arquivo restaurado do fluxo, antes de ser renomeado para o nome final
+const char* const SUFIXO_TEMPORARIO_TAR = ".restaurando";
+
+[[noreturn]] void lanca_erro(const std::string& operacao, const std::string& caminho, int erro) {
+    throw fs::filesystem_error(operacao, caminho, std::error_code(erro, std::system_category()));
+}
+
+bool eh_pipe(int fd) {
+    struct stat st;
+    return ::fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+}
+
+void escreve_tudo(int fd, const char* dados, std::size_t tamanho, const std::string& caminho) {
+    while (tamanho > 0) {
+        ssize_t n = ::write(fd, dados, tamanho);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            lanca_erro("escrita tar", caminho, errno);
+        }
+        dados += n;
+        tamanho -= static_cast<std::size_t>(n);
+    }
+}
+
+std::size_t preenchimento(std::uintmax_t tamanho) {
+    return static_cast<std::size_t>((BLOCO_TAR - tamanho % BLOCO_TAR) % BLOCO_TAR);
+}
+
+// ==============================================================================
+// CABECALHOS
+// ==============================================================================
+
+void escreve_octal(char* campo, std::size_t largura, std::uintmax_t valor) {
+    std::snprintf(campo, largura, "%0*jo", static_cast<int>(largura - 1), valor);
+}
+
+void copia_campo(char* campo, std::size_t largura, const std::string& texto) {
+    std::memcpy(campo, texto.data(), std::min(largura, texto.size()));
+}
+
+/** @brief Registro pax "<comprimento> chave=valor\n" (o comprimento inclui a si mesmo). */
+std::string registro_pax(const std::string& chave, const std::string& valor) {
+    const std::size_t base = chave.size() + valor.size() + 3;  // ' ', '=' e '\n'
+    std::size_t comprimento = base + std::to_string(base).size();
+    if (std::to_string(comprimento).size() != std::to_string(base).size()) {
+        comprimento = base + std::to_string(comprimento).size();
+    }
+    return std::to_string(comprimento) + " " + chave + "=" + valor + "\n";
+}
+
+void monta_cabecalho(char* bloco, const std::string& nome, std::uintmax_t tamanho, std::int64_t mtime,
+                     unsigned modo, std::uintmax_t uid, std::uintmax_t gid, char tipo,
+                     const std::string& vinculo = std::string()) {
+    std::memset(bloco, 0, BLOCO_TAR);
+    copia_campo(bloco, 100, nome);
+    copia_campo(bloco + 157, 100, vinculo);
+    escreve_octal(bloco + 100, 8, modo & 07777);
+    escreve_octal(bloco + 108, 8, std::min(uid, MAXIMO_ID_USTAR));
+    escreve_octal(bloco + 116, 8, std::min(gid, MAXIMO_ID_USTAR));
+    escreve_octal(bloco + 124, 12, std::min(tamanho, MAXIMO_TAMANHO_USTAR));
+    escreve_octal(bloco + 136, 12, static_cast<std::uintmax_t>(std::max<std::int64_t>(mtime, 0)));
+    bloco[156] = tipo;
+    std::memcpy(bloco + 257, "ustar", 6);
+    std::memcpy(bloco + 263, "00", 2);
+
+    // Soma de verificacao: bytes do cabecalho com o proprio campo preenchido por espacos
+    std::memset(bloco + 148, ' ', 8);
+    unsigned soma = 0;
+    for (std::size_t i = 0; i < BLOCO_TAR; ++i) {
+        soma += static_cast<unsigned char>(bloco[i]);
+    }
+    std::snprintf(bloco + 148, 7, "%06o", soma);
+    bloco[155] = ' ';
+}
+
+std::string campo_texto(const char* campo, std::size_t largura) {
+    return std::string(campo, strnlen(campo, largura));
+}
+
+std::uintmax_t le_numero(const char* campo, std::size_t largura) {
+    // Extensao GNU (base 256) para valores que nao cabem em octal
+    if (static_cast<unsigned char>(campo[0]) & 0x80) {
+        std::uintmax_t valor = static_cast<unsigned char>(campo[0]) & 0x7f;
+        for (std::size_t i = 1; i < largura; ++i) {
+            valor = (valor << 8) | static_cast<unsigned char>(campo[i]);
+        }
+        return valor;
+    }
+    std::uintmax_t valor = 0;
+    for (std::size_t i = 0; i < largura && campo[i] != '\0'; ++i) {
+        if (campo[i] >= '0' && campo[i] <= '7') {
+            valor = valor * 8 + static_cast<std::uintmax_t>(campo[i] - '0');
+        }
+    }
+    return valor;
+}
+
+bool cabecalho_valido(const char* bloco) {
+    unsigned soma = 0;
+    for (std::size_t i = 0; i < BLOCO_TAR; ++i) {
+        soma += (i >= 148 && i < 156) ? ' ' : static_cast<unsigned char>(bloco[i]);
+    }
+    return soma == le_numero(bloco + 148, 8);
+}
+
+/** @brief "segundos[.fracao]" do pax para nanossegundos. */
+std::int64_t nanos_de_pax(const std::string& texto) {
+    std::size_t ponto = texto.find('.');
+    std::int64_t segundos = std::strtoll(texto.substr(0, ponto).c_str(), nullptr, 10);
+    std::int64_t nanos = 0;
+    if (ponto != std::string::npos) {
+        std::string fracao = texto.substr(ponto + 1, 9);
+        fracao.append(9 - fracao.size(), '0');
+        nanos = std::strtoll(fracao.c_str(), nullptr, 10);
+    }
+    return segundos * 1000000000LL + (texto[0] == '-' ? -nanos : nanos);
+}
+
+void interpreta_pax(const std::string& dados, std::map<std::string, std::string>& registros) {
+    for (std::size_t i = 0; i < dados.size();) {
+        std::size_t espaco = dados.find(' ', i);
+        std::size_t comprimento = std::strtoul(dados.c_str() + i, nullptr, 10);
+        if (espaco == std::string::npos || comprimento == 0 || i + comprimento > dados.size()) {
+            break;
+        }
+        std::string registro = dados.substr(espaco + 1, i + comprimento - espaco - 2);  // Sem o '\n'
+        std::size_t igual = registro.find('=');
+        if (igual != std::string::npos) {
+            registros[registro.substr(0, igual)] = registro.substr(igual + 1);
+        }
+        i += comprimento;
+    }
+}
+
+// ==============================================================================
+// SAIDA
+// ==============================================================================
+
+/**
+ * @brief Escreve o fluxo tar em blocos grandes; o conteudo dos arquivos vai por splice()
+ * quando a saida e um pipe.
+ */
+class SaidaTar {
+ public:
+    explicit SaidaTar(int fd) : fd_(fd), splice_(eh_pipe(fd)), buffer_(pool_blocos().empresta()) {}
+
+    void acrescenta(const char* dados, std::size_t tamanho) {
+        while (tamanho > 0) {
+            std::size_t parte = std::min(tamanho, TAMANHO_BUFFER_TAR - usados_);
+            std::memcpy(buffer_.get() + usados_, dados, parte);
+            usados_ += parte;
+            dados += parte;
+            tamanho -= parte;
+            if (usados_ == TAMANHO_BUFFER_TAR) {
+                descarrega();
+            }
+        }
+    }
+
+    void acrescenta_zeros(std::size_t tamanho) {
+        static const char zeros[BLOCO_TAR] = {};
+        while (tamanho > 0) {
+            std::size_t parte = std::min(tamanho, BLOCO_TAR);
+            acrescenta(zeros, parte);
+            tamanho -= parte;
+        }
+    }
+
+    /** @brief Copia exatamente 'tamanho' bytes de fd_entrada para o fluxo. */
+    void copia_conteudo(int fd_entrada, std::uintmax_t tamanho, const std::string& caminho, RelatorioTar& relatorio) {
+        std::uintmax_t restante = tamanho;
+        if (splice_) {
+            descarrega();
+            loff_t deslocamento = 0;
+            while (restante > 0) {
+                ssize_t n = ::splice(fd_entrada, &deslocamento, fd_, nullptr,
+                                     static_cast<std::size_t>(std::min<std::uintmax_t>(restante, MAXIMO_SPLICE)),
+                                     SPLICE_F_MOVE | SPLICE_F_MORE);
+                if (n < 0) {
+                    if (errno == EINTR) {
+                        continue;
+                    }
+                    if ((errno == EINVAL || errno == ENOSYS) && deslocamento == 0) {
+                        splice_ = false;  // Sistema de arquivos sem splice: segue pelo buffer
+                        break;
+                    }
+                    lanca_erro("splice", caminho, errno);
+                }
+                if (n == 0) {
+                    lanca_erro("arquivo encolheu durante a leitura", caminho, EIO);
+                }
+                limita_leitura(static_cast<std::size_t>(n));
+                restante -= static_cast<std::uintmax_t>(n);
+                relatorio.bytes_splice += static_cast<std::uintmax_t>(n);
+            }
+        }
+        // Sem splice, le direto para o buffer de saida: nenhuma copia alem da do read()
+        while (restante > 0) {
+            std::size_t livre = TAMANHO_BUFFER_TAR - usados_;
+            ssize_t n = ::read(fd_entrada, buffer_.get() + usados_,
+                               static_cast<std::size_t>(std::min<std::uintmax_t>(restante, livre)));
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                lanca_erro("leitura", caminho, errno);
+            }
+            if (n == 0) {
+                lanca_erro("arquivo encolheu durante a leitura", caminho, EIO);
+            }
+            limita_leitura(static_cast<std::size_t>(n));
+            usados_ += static_cast<std::size_t>(n);
+            restante -= static_cast<std::uintmax_t>(n);
+            if (usados_ == TAMANHO_BUFFER_TAR) {
+                descarrega();
+            }
+        }
+        acrescenta_zeros(preenchimento(tamanho));
+    }
+
+    void descarrega() {
+        escreve_tudo(fd_, buffer_.get(), usados_, "saida");
+        usados_ = 0;
+    }
+
+ private:
+    int fd_;
+    bool splice_;
+    PoolBuffers::Emprestimo buffer_;
+    std::size_t usados_ = 0;
+};
+
+// ==============================================================================
+// ENTRADA
+// ==============================================================================
+
+/**
+ * @brief Le o fluxo tar em blocos grandes; o conteudo dos arquivos vem por splice()
+ * quando a entrada e um pipe.
+ */
+class EntradaTar {
+ public:
+    explicit EntradaTar(int fd) : fd_(fd), splice_(eh_pipe(fd)), buffer_(pool_blocos().empresta()) {}
+
+    /** @return false no fim do fluxo exatamente entre dois blocos. */
+    bool le_bloco(char* bloco) {
+        if (disponivel() == 0 && !enche()) {
+            return false;
+        }
+        le_exato(bloco, BLOCO_TAR);
+        return true;
+    }
+
+    void le_exato(char* destino, std::size_t tamanho) {
+        while (tamanho > 0) {
+            if (disponivel() == 0 && !enche()) {
+                lanca_erro("fluxo tar truncado", "entrada", EIO);
+            }
+            std::size_t parte = std::min(tamanho, disponivel());
+            std::memcpy(destino, buffer_.get() + inicio_, parte);
+            inicio_ += parte;
+            destino += parte;
+            tamanho -= parte;
+        }
+    }
+
+    void descarta(std::uintmax_t tamanho) {
+        while (tamanho > 0) {
+            if (disponivel() == 0 && !enche()) {
+                lanca_erro("fluxo tar truncado", "entrada", EIO);
+            }
+            std::size_t parte = static_cast<std::size_t>(std::min<std::uintmax_t>(tamanho, disponivel()));
+            inicio_ += parte;
+            tamanho -= parte;
+        }
+    }
+
+    /** @brief Move 'tamanho' bytes do fluxo para fd_saida. */
+    void copia_para(int fd_saida, std::uintmax_t tamanho, const std::string& caminho, RelatorioTar& relatorio) {
+        // Primeiro o que ja esta no buffer, depois direto do pipe para o arquivo
+        std::size_t parte = static_cast<std::size_t>(std::min<std::uintmax_t>(tamanho, disponivel()));
+        escreve_tudo(fd_saida, buffer_.get() + inicio_, parte, caminho);
+        limita_escrita(parte);
+        inicio_ += parte;
+        std::uintmax_t restante = tamanho - parte;
+        while (splice_ && restante > 0) {
+            ssize_t n = ::splice(fd_, nullptr, fd_saida, nullptr,
+                                 static_cast<std::size_t>(std::min<std::uintmax_t>(restante, MAXIMO_SPLICE)),
+                                 SPLICE_F_MOVE | SPLICE_F_MORE);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno == EINVAL || errno == ENOSYS) {
+                    splice_ = false;
+                    break;
+                }
+                lanca_erro("splice", caminho, errno);
+            }
+            if (n == 0) {
+                lanca_erro("fluxo tar truncado", caminho, EIO);
+            }
+            limita_escrita(static_cast<std::size_t>(n));
+            restante -= static_cast<std::uintmax_t>(n);
+            relatorio.bytes_splice += static_cast<std::uintmax_t>(n);
+        }
+        while (restante > 0) {
+            if (!enche()) {
+                lanca_erro("fluxo tar truncado", caminho, EIO);
+            }
+            parte = static_cast<std::size_t>(std::min<std::uintmax_t>(restante, disponivel()));
+            escreve_tudo(fd_saida, buffer_.get() + inicio_, parte, caminho);
+            limita_escrita(parte);
+            inicio_ += parte;
+            restante -= parte;
+        }
+    }
+
+ private:
+    std::size_t disponivel() const { return fim_ - inicio_; }
+
+    /** @brief Le mais dados para o buffer (so chamado com o buffer vazio). */
+    bool enche() {
+        assert(disponivel() == 0);
+        for (;;) {
+            ssize_t n = ::read(fd_, buffer_.get(), TAMANHO_BUFFER_TAR);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                lanca_erro("leitura do fluxo tar", "entrada", errno);
+            }
+            inicio_ = 0;
+            fim_ = static_cast<std::size_t>(n);
+            return n > 0;
+        }
+    }
+
+    int fd_;
+    bool splice_;
+    PoolBuffers::Emprestimo buffer_;
+    std::size_t inicio_ = 0;
+    std::size_t fim_ = 0;
+};
+
+/**
+ * @brief Fecha o descritor ao sair de escopo (inclusive quando uma excecao e lancada).
+ */
+class Descritor {
+ public:
+    explicit Descritor(int fd) : fd_(fd) {}
+    ~Descritor() {
+        if (fd_ >= 0) {
+            ::close(fd_);
+        }
+    }
+    Descritor(const Descritor&) = delete;
+    Descritor& operator=(const Descritor&) = delete;
+
+    int get() const { return fd_; }
+
+    /** @brief Fecha explicitamente, retornando o errno em caso de falha (0 se OK). */
+    int fecha() {
+        int fd = fd_;
+        fd_ = -1;
+        return (::close(fd) == 0) ? 0 : errno;
+    }
+
+ private:
+    int fd_;
+};
+
+double segundos_desde(std::chrono::steady_clock::time_point inicio) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - inicio).count();
+}
+
+}  // namespace
+
+// ==============================================================================
+// BACKUP (HD -> fluxo tar)
+// ==============================================================================
+
+ResultadoBackup executa_backup_tar(const std::string& nome_arquivo_parm,
+                                   const std::string& caminho_origem_base,
+                                   int fd_saida, RelatorioTar& relatorio) {
+    // Assertiva de entrada
+    assert(!nome_arquivo_parm.empty());
+    assert(!caminho_origem_base.empty());
+    assert(fd_saida >= 0);
+
+    const auto inicio = std::chrono::steady_clock::now();
+    relatorio = RelatorioTar();
+
+    std::vector<std::string> arquivos;
+    ResultadoBackup leitura = le_arquivo_parametros(nome_arquivo_parm, arquivos);
+    if (leitura != SUCESSO) {
+        return leitura;
+    }
+
+    try {
+        SaidaTar saida(fd_saida);
+        MapaInodes inodes;
+        char bloco[BLOCO_TAR];
+        for (const auto& arquivo : arquivos) {
+            const std::string origem = caminho_origem_base + "/" + arquivo;
+            MEDE_FASE_DE(FASE_ARQUIVO, origem.c_str());
+
+            Descritor entrada(::open(origem.c_str(), O_RDONLY | O_CLOEXEC));
+            if (entrada.get() < 0) {
+                if (errno == ENOENT) {
+                    // CASOS 6 e 7: ausente no HD, nada a gravar
+                    CONTA_CASO(6);
+                    ++relatorio.ignorados;
+                    continue;
+                }
+                lanca_erro("abertura", origem, errno);
+            }
+            struct stat st;
+            if (::fstat(entrada.get(), &st) != 0) {
+                lanca_erro("fstat", origem, errno);
+            }
+            CONTA_CASO(2);
+
+            // Outro nome de um inode ja gravado no fluxo: entrada de hardlink (tipo '1'), sem conteudo
+            const IdentidadeInode id{static_cast<std::uint64_t>(st.st_dev), static_cast<std::uint64_t>(st.st_ino)};
+            bool primeira = false;
+            std::string vinculo;
+            if (st.st_nlink > 1) {
+                std::shared_future<PrimeiraOcorrencia> anterior;
+                primeira = inodes.reserva(id, anterior);
+                if (!primeira) {
+                    vinculo = anterior.get().caminho;
+                }
+            }
+            if (vinculo.empty()) {
+                ::posix_fadvise(entrada.get(), 0, 0, POSIX_FADV_SEQUENTIAL);
+            }
+
+            // Registros pax: data com nanossegundos sempre; caminho, vinculo, tamanho e ids so
+            // quando nao cabem no cabecalho ustar
+            const std::uintmax_t tamanho = vinculo.empty() ? static_cast<std::uintmax_t>(st.st_size) : 0;
+            char fracao[16];
+            std::snprintf(fracao, sizeof(fracao), ".%09ld", static_cast<long>(st.st_mtim.tv_nsec));
+            std::string pax = registro_pax("mtime", std::to_string(st.st_mtim.tv_sec) + fracao);
+            if (arquivo.size() > 100) {
+                pax += registro_pax("path", arquivo);
+            }
+            if (vinculo.size() > 100) {
+                pax += registro_pax("linkpath", vinculo);
+            }
+            if (tamanho > MAXIMO_TAMANHO_USTAR) {
+                pax += registro_pax("size", std::to_string(tamanho));
+            }
+            if (st.st_uid > MAXIMO_ID_USTAR) {
+                pax += registro_pax("uid", std::to_string(st.st_uid));
+            }
+            if (st.st_gid > MAXIMO_ID_USTAR) {
+                pax += registro_pax("gid", std::to_string(st.st_gid));
+            }
+            const std::string base = fs::path(arquivo).filename().string();
+            monta_cabecalho(bloco, "PaxHeaders/" + base.substr(0, 88), pax.size(), st.st_mtim.tv_sec, 0644, 0, 0,
+                            'x');
+            saida.acrescenta(bloco, BLOCO_TAR);
+            saida.acrescenta(pax.data(), pax.size());
+            saida.acrescenta_zeros(preenchimento(pax.size()));
+
+            if (!vinculo.empty()) {
+                monta_cabecalho(bloco, arquivo, 0, st.st_mtim.tv_sec, st.st_mode, st.st_uid, st.st_gid, '1', vinculo);
+                saida.acrescenta(bloco, BLOCO_TAR);
+                conta_vinculo_recriado();
+                ++relatorio.vinculos;
+                continue;
+            }
+            monta_cabecalho(bloco, arquivo, tamanho, st.st_mtim.tv_sec, st.st_mode, st.st_uid, st.st_gid, '0');
+            saida.acrescenta(bloco, BLOCO_TAR);
+            {
+                MEDE_FASE_DE(FASE_COPIA, origem.c_str());
+                saida.copia_conteudo(entrada.get(), tamanho, origem, relatorio);
+            }
+            CONTA_BYTES(tamanho);
+            ++relatorio.arquivos;
+            relatorio.bytes += tamanho;
+            if (primeira) {
+                PrimeiraOcorrencia gravada;
+                gravada.valida = true;
+                gravada.caminho = arquivo;
+                inodes.publica(id, std::move(gravada));
+            }
+        }
+
+        // Fim do arquivo tar: dois blocos zerados
+        saida.acrescenta_zeros(2 * BLOCO_TAR);
+        saida.descarrega();
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Erro no fluxo tar: " << e.what() << std::endl;
+        relatorio.segundos = segundos_desde(inicio);
+        return ERRO_GERAL;
+    }
+
+    relatorio.segundos = segundos_desde(inicio);
+    return SUCESSO;
+}
+
+// ==============================================================================
+// RESTAURACAO (fluxo tar -> HD)
+// ==============================================================================
+
+ResultadoBackup executa_restauracao_tar(const std::string& nome_arquivo_parm, int fd_entrada,
+                                        const std::string& caminho_destino_base,
+                                        RelatorioTar& relatorio) {
+    // Assertiva de entrada
+    assert(!nome_arquivo_parm.empty());
+    assert(!caminho_destino_base.empty());
+    assert(fd_entrada >= 0);
+
+    const auto inicio = std::chrono::steady_clock::now();
+    relatorio = RelatorioTar();
+
+    std::vector<std::string> arquivos;
+    ResultadoBackup leitura = le_arquivo_parametros(nome_arquivo_parm, arquivos);
+    if (leitura != SUCESSO) {
+        return leitura;
+    }
+    std::unordered_map<std::string, std::size_t> indice;
+    for (std::size_t i = 0; i < arquivos.size(); ++i) {
+        indice.emplace(arquivos[i], i);
+    }
+    std::vector<char> presente(arquivos.size(), 0);
+
+    ResultadoBackup resultado = SUCESSO;
+    try {
+        EntradaTar entrada(fd_entrada);
+        char bloco[BLOCO_TAR];
+        std::map<std::string, std::string> pax;
+        std::string nome_longo;
+        while (resultado == SUCESSO && entrada.le_bloco(bloco)) {
+            if (std::all_of(bloco, bloco + BLOCO_TAR, [](char c) { return c == '\0'; })) {
+                break;  // Fim do arquivo tar
+            }
+            if (!cabecalho_valido(bloco)) {
+                lanca_erro("cabecalho tar corrompido", "entrada", EIO);
+            }
+
+            const char tipo = bloco[156];
+            std::uintmax_t tamanho = le_numero(bloco + 124, 12);
+            if (tipo == 'x' || tipo == 'g' || tipo == 'L') {
+                // Metadados da proxima entrada (pax local, pax global, nome longo GNU)
+                std::string dados(static_cast<std::size_t>(tamanho), '\0');
+                entrada.le_exato(&dados[0], dados.size());
+                entrada.descarta(preenchimento(tamanho));
+                if (tipo == 'x') {
+                    interpreta_pax(dados, pax);
+                } else if (tipo == 'L') {
+                    nome_longo = dados.c_str();
+                }
+                continue;
+            }
+
+            std::string nome = campo_texto(bloco, 100);
+            const std::string prefixo = campo_texto(bloco + 345, 155);
+            if (std::memcmp(bloco + 257, "ustar", 5) == 0 && !prefixo.empty()) {
+                nome = prefixo + "/" + nome;
+            }
+            if (!nome_longo.empty()) {
+                nome = nome_longo;
+            }
+            std::int64_t data = static_cast<std::int64_t>(le_numero(bloco + 136, 12)) * 1000000000LL;
+            if (pax.count("path")) {
+                nome = pax["path"];
+            }
+            if (pax.count("size")) {
+                tamanho = std::strtoull(pax["size"].c_str(), nullptr, 10);
+            }
+            if (pax.count("mtime")) {
+                data = nanos_de_pax(pax["mtime"]);
+            }
+            std::string vinculo = campo_texto(bloco + 157, 100);
+            if (pax.count("linkpath")) {
+                vinculo = pax["linkpath"];
+            }
+            pax.clear();
+            nome_longo.clear();
+            while (nome.compare(0, 2, "./") == 0) {
+                nome.erase(0, 2);
+            }
+            while (vinculo.compare(0, 2, "./") == 0) {
+                vinculo.erase(0, 2);
+            }
+
+            auto it = indice.find(nome);
+            if ((tipo != '0' && tipo != '\0' && tipo != '7' && tipo != '1') || it == indice.end()) {
+                entrada.descarta(tamanho + preenchimento(tamanho));
+                continue;
+            }
+            presente[it->second] = 1;
+
+            // Tabela de decisao da RESTAURACAO, com o fluxo no papel do Pen-drive
+            const std::string destino = caminho_destino_base + "/" + nome;
+            MEDE_FASE_DE(FASE_ARQUIVO, destino.c_str());
+            EstadoArquivo hd;
+            {
+                MEDE_FASE(FASE_METADADOS);
+                hd = armazenamento_posix().consulta(destino);
+            }
+            const fs::file_time_type tempo_pd = data_de_nanos(data);
+            if (hd.existe && tempo_pd < hd.modificacao) {
+                // CASO 8: PD mais antigo que o HD -> ERRO
+                CONTA_CASO(8);
+                resultado = ERRO_ARQUIVO_ORIGEM_MAIS_ANTIGO;
+                break;
+            }
+            if (hd.existe && tempo_pd == hd.modificacao) {
+                // CASO 10: datas iguais -> IGNORAR
+                CONTA_CASO(10);
+                ++relatorio.ignorados;
+                entrada.descarta(tamanho + preenchimento(tamanho));
+                continue;
+            }
+            // CASO 11 (HD ausente) ou CASO 9 (PD mais novo): COPIAR
+            CONTA_CASO(hd.existe ? 9 : 11);
+            if (tipo == '1') {
+                // Hardlink para uma entrada anterior do fluxo: o conteudo ja esta no HD
+                auto alvo = indice.find(vinculo);
+                if (alvo == indice.end() || !presente[alvo->second]) {
+                    std::cerr << "Hardlink no fluxo tar para entrada nao restaurada: " << nome << " -> " << vinculo
+                              << std::endl;
+                    resultado = ERRO_GERAL;
+                    break;
+                }
+                MEDE_FASE_DE(FASE_HARDLINK, destino.c_str());
+                fs::create_directories(fs::path(destino).parent_path());
+                const std::string existente = caminho_destino_base + "/" + vinculo;
+                if (!vincula_copia(existente, destino)) {
+                    InfoCopia info;
+                    copia_arquivo(existente, destino, info);  // Sistema de arquivos sem hardlinks
+                }
+                conta_vinculo_recriado();
+                ++relatorio.vinculos;
+                continue;
+            }
+            {
+                MEDE_FASE_DE(FASE_COPIA, destino.c_str());
+                fs::create_directories(fs::path(destino).parent_path());
+                const mode_t modo = static_cast<mode_t>(le_numero(bloco + 100, 8) & 07777);
+                // Grava num temporario: um fluxo truncado nao destroi o arquivo que ja estava no HD
+                const std::string temporario = destino + SUFIXO_TEMPORARIO_TAR;
+                Descritor saida(::open(temporario.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC,
+                                       modo != 0 ? modo : 0644));
+                if (saida.get() < 0) {
+                    lanca_erro("abertura", temporario, errno);
+                }
+                try {
+                    entrada.copia_para(saida.get(), tamanho, temporario, relatorio);
+
+                    // Data do fluxo no HD, para que a proxima restauracao caia no Caso 10
+                    std::int64_t segundos = data / 1000000000LL;
+                    std::int64_t nanos = data % 1000000000LL;
+                    if (nanos < 0) {
+                        nanos += 1000000000LL;
+                        --segundos;
+                    }
+                    struct timespec tempos[2];
+                    tempos[0].tv_sec = 0;
+                    tempos[0].tv_nsec = UTIME_OMIT;
+                    tempos[1].tv_sec = static_cast<time_t>(segundos);
+                    tempos[1].tv_nsec = static_cast<long>(nanos);
+                    if (::futimens(saida.get(), tempos) != 0) {
+                        lanca_erro("futimens", temporario, errno);
+                    }
+                    prepara_publicacao(saida.get(), temporario);
+                    int erro = saida.fecha();
+                    if (erro != 0) {
+                        lanca_erro("fechamento", temporario, erro);
+                    }
+                    publica_copia(temporario, destino);
+                } catch (const fs::filesystem_error&) {
+                    std::remove(temporario.c_str());
+                    throw;
+                }
+            }
+            entrada.descarta(preenchimento(tamanho));
+            CONTA_BYTES(tamanho);
+            ++relatorio.arquivos;
+            relatorio.bytes += tamanho;
+        }
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Erro no fluxo tar: " << e.what() << std::endl;
+        resultado = ERRO_GERAL;
+    }
+
+    // CASOS 12 e 13: arquivo do Backup.parm ausente no fluxo
+    if (resultado == SUCESSO) {
+        for (std::size_t i = 0; i < arquivos.size(); ++i) {
+            if (!presente[i]) {
+                CONTA_CASO(armazenamento_posix().existe(caminho_destino_base + "/" + arquivos[i]) ? 12 : 13);
+                std::cerr << "Ausente no fluxo tar: " << arquivos[i] << std::endl;
+                resultado = ERRO_ARQUIVO_ORIGEM_NAO_EXISTE;
+                break;
+            }
+        }
+    }
+    if (!confirma_copias() && resultado == SUCESSO) {
+        resultado = ERRO_GERAL;
+    }
+
+    relatorio.segundos = segundos_desde(inicio);
+    return resultado;
+}
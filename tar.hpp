@@ -0,0 +1,57 @@
+// Copyright 2025 Guilherme Nonato
+
+#ifndef TAR_HPP
+#define TAR_HPP
+
+#include "backup.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+/**
+ * @brief Resumo de um backup ou restauracao em fluxo tar.
+ */
+struct RelatorioTar {
+    std::size_t arquivos = 0;          ///< Arquivos escritos no fluxo (-b) ou no HD (-r).
+    std::size_t ignorados = 0;         ///< Ausentes na origem (-b) ou inalterados no HD (Caso 10).
+    std::size_t vinculos = 0;          ///< Outros nomes de um inode ja no fluxo, gravados como hardlink.
+    std::uintmax_t bytes = 0;          ///< Bytes de conteudo transferidos.
+    std::uintmax_t bytes_splice = 0;   ///< Parte de 'bytes' movida com splice(), sem passar pelo processo.
+    double segundos = 0.0;
+};
+
+/**
+ * @brief Backup em fluxo: escreve os arquivos do Backup.parm como um tar POSIX (pax) em fd_saida.
+ * @details Em vez de uma arvore de destino, produz um arquivo tar legivel por GNU tar,
+ * bsdtar e afins (ex: backup_app -b Backup.parm hd - | ssh host 'tar -x'). Cada entrada
+ * leva um cabecalho pax com a data em nanossegundos, para que a restauracao reconheca
+ * arquivos inalterados (Caso 10); caminhos longos e arquivos de 8 GiB ou mais tambem
+ * usam registros pax. Os cabecalhos vao em escritas grandes de um buffer alinhado; o
+ * conteudo, quando fd_saida e um pipe, e movido com splice() direto do cache de paginas
+ * para o pipe. Arquivos ausentes na origem (Casos 6 e 7) sao omitidos. Outros nomes de um
+ * inode ja gravado no fluxo vao como entradas de hardlink (tipo '1'), sem conteudo.
+ * @param fd_saida Descritor de escrita (pipe, arquivo ou socket); nao e fechado.
+ * @return SUCESSO ou o erro do primeiro arquivo que falhou. Em caso de erro o fluxo e
+ * interrompido sem os blocos de fim, para que o leitor perceba o arquivo truncado.
+ */
+ResultadoBackup executa_backup_tar(const std::string& nome_arquivo_parm,
+                                   const std::string& caminho_origem_base,
+                                   int fd_saida, RelatorioTar& relatorio);
+
+/**
+ * @brief Restauracao em fluxo: le um tar de fd_entrada e restaura no HD os arquivos do Backup.parm.
+ * @details O fluxo faz o papel do Pen-drive na tabela de decisao da RESTAURACAO (Casos
+ * 8 a 11). Entradas fora do Backup.parm e tipos que nao sao arquivo regular sao
+ * descartados. Quando fd_entrada e um pipe, o conteudo e movido com splice() do pipe
+ * para o arquivo. Como o fluxo e lido uma unica vez, arquivos do Backup.parm ausentes
+ * no tar (Casos 12 e 13) so sao detectados no fim, depois das demais restauracoes.
+ * Entradas de hardlink viram hardlinks no HD para a entrada anterior, que precisa estar
+ * no Backup.parm.
+ * @param fd_entrada Descritor de leitura; nao e fechado.
+ * @return SUCESSO ou o primeiro erro encontrado.
+ */
+ResultadoBackup executa_restauracao_tar(const std::string& nome_arquivo_parm, int fd_entrada,
+                                        const std::string& caminho_destino_base,
+                                        RelatorioTar& relatorio);
+
+#endif  // TAR_HPP